@@ -0,0 +1,144 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <utility>
+
+namespace plansys_interface
+{
+
+struct BearingControlConfig
+{
+  // Proportional gain on the bearing error (1/s)
+  double kp = 5.0;
+  // Angular speed limits (rad/s) and acceleration limit (rad/s^2)
+  double max_speed = 1.0;
+  double min_speed = 0.05;
+  double max_accel = 4.0;
+  // Bearing error (rad) under which the marker counts as centred
+  double tolerance = 0.02;
+  // Odometry history kept for latency compensation (s)
+  double history = 1.0;
+};
+
+// Turns the robot so that a marker seen by the camera ends up straight ahead.
+//
+// Bearings are measured on images that are already some time old when they
+// arrive. The rotation made since the image was taken is read back from the
+// odometry history and subtracted, so the controller acts on where the marker
+// is now rather than where it was, and can use a high gain without
+// overshooting.
+class BearingController
+{
+public:
+  explicit BearingController(const BearingControlConfig & config = BearingControlConfig())
+  : config_(config)
+  {
+    reset();
+  }
+
+  void reset()
+  {
+    have_bearing_ = false;
+    bearing_ = 0.0;
+    bearing_yaw_ = 0.0;
+    command_ = 0.0;
+    last_command_stamp_ = -1.0;
+  }
+
+  // Feeds the odometry yaw at time stamp (s)
+  void on_yaw(double stamp, double yaw)
+  {
+    if (!yaws_.empty()) {
+      // Keep the yaw continuous so that differences never wrap
+      yaw = yaws_.back().second + std::remainder(yaw - yaws_.back().second, 2.0 * M_PI);
+    }
+    yaws_.emplace_back(stamp, yaw);
+    while (yaws_.size() > 2 && yaws_.front().first < stamp - config_.history) {
+      yaws_.pop_front();
+    }
+  }
+
+  // Feeds the bearing of the marker (rad, positive to the left) measured on an
+  // image taken at stamp (s)
+  void on_bearing(double stamp, double bearing)
+  {
+    bearing_ = bearing;
+    bearing_yaw_ = yaw_at(stamp);
+    have_bearing_ = true;
+  }
+
+  // Bearing of the marker at the latest odometry time
+  double error() const
+  {
+    if (!have_bearing_) {
+      return 0.0;
+    }
+    return bearing_ - (current_yaw() - bearing_yaw_);
+  }
+
+  bool has_bearing() const {return have_bearing_;}
+  bool centred() const {return have_bearing_ && std::abs(error()) <= config_.tolerance;}
+
+  // Angular velocity command at time stamp (s)
+  double command(double stamp)
+  {
+    double target = 0.0;
+    if (have_bearing_ && !centred()) {
+      double e = error();
+      target = std::clamp(config_.kp * e, -config_.max_speed, config_.max_speed);
+      // Below min_speed the base does not move at all
+      if (std::abs(target) < config_.min_speed) {
+        target = std::copysign(config_.min_speed, e);
+      }
+    }
+
+    if (last_command_stamp_ >= 0.0) {
+      double max_step = config_.max_accel * std::max(0.0, stamp - last_command_stamp_);
+      // Stopping is never rate limited, the error is already compensated
+      if (target != 0.0) {
+        target = std::clamp(target, command_ - max_step, command_ + max_step);
+      }
+    }
+    command_ = target;
+    last_command_stamp_ = stamp;
+    return command_;
+  }
+
+private:
+  double current_yaw() const
+  {
+    return yaws_.empty() ? 0.0 : yaws_.back().second;
+  }
+
+  // Linearly interpolated yaw at stamp, clamped to the recorded history
+  double yaw_at(double stamp) const
+  {
+    if (yaws_.empty()) {
+      return 0.0;
+    }
+    if (stamp <= yaws_.front().first) {
+      return yaws_.front().second;
+    }
+    for (size_t i = 1; i < yaws_.size(); ++i) {
+      if (stamp <= yaws_[i].first) {
+        const auto & a = yaws_[i - 1];
+        const auto & b = yaws_[i];
+        double t = (stamp - a.first) / (b.first - a.first);
+        return a.second + t * (b.second - a.second);
+      }
+    }
+    return yaws_.back().second;
+  }
+
+  BearingControlConfig config_;
+  std::deque<std::pair<double, double>> yaws_;
+  bool have_bearing_;
+  double bearing_;
+  double bearing_yaw_;
+  double command_;
+  double last_command_stamp_;
+};
+
+}  // namespace plansys_interface
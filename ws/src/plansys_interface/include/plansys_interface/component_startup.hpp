@@ -0,0 +1,38 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include "lifecycle_msgs/msg/transition.hpp"
+#include "plansys2_executor/ActionExecutorClient.hpp"
+#include "rclcpp/rclcpp.hpp"
+
+namespace plansys_interface
+{
+
+// Action executors are lifecycle nodes, and a component container only constructs
+// them. This sets the action name right away and configures (and optionally
+// activates) the node on its first executor turn, as the standalone mains used to
+// do after make_shared. The returned timer has to be kept by the node.
+inline rclcpp::TimerBase::SharedPtr start_action_executor(
+  plansys2::ActionExecutorClient * node, const std::string & action_name, bool activate)
+{
+  node->set_parameter(rclcpp::Parameter("action_name", action_name));
+
+  auto self = std::make_shared<std::weak_ptr<rclcpp::TimerBase>>();
+  auto timer = node->create_wall_timer(std::chrono::nanoseconds(0),
+      [node, self, activate]() {
+        if (auto timer = self->lock()) {
+          timer->cancel();
+        }
+        node->trigger_transition(lifecycle_msgs::msg::Transition::TRANSITION_CONFIGURE);
+        if (activate) {
+          node->trigger_transition(lifecycle_msgs::msg::Transition::TRANSITION_ACTIVATE);
+        }
+      });
+  *self = timer;
+  return timer;
+}
+
+}  // namespace plansys_interface
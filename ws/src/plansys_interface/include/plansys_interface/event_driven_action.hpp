@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+
+#include "plansys2_executor/ActionExecutorClient.hpp"
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp_lifecycle/lifecycle_node.hpp"
+
+namespace plansys_interface
+{
+
+// Action executor whose state machine runs as soon as the data it waits for
+// arrives, instead of on the next do_work tick.
+//
+// PlanSys2 activates an executor when it is given an action and deactivates it
+// when the action finishes or is cancelled; that is the RUNNING phase. While
+// running, step() is called on every periodic tick and on every wake() from a
+// data callback, always with the state lock held. The tick also sends the
+// progress set with set_progress(), so feedback keeps its fixed rate.
+//
+// complete() only marks the action as finishing; finish(), a lifecycle
+// transition, runs once the thread releases its outermost state lock, so no
+// transition is ever started with the lock held.
+//
+// Every completion logs the reaction time, from the last wake() to finish().
+// With the event_driven parameter set to false, wake() only records the event
+// and steps wait for the tick, as in a polling executor, for comparison.
+class EventDrivenActionExecutor : public plansys2::ActionExecutorClient
+{
+public:
+  using CallbackReturn = rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface::CallbackReturn;
+
+  enum class Phase { IDLE, RUNNING, FINISHING };
+
+  EventDrivenActionExecutor(const std::string & action_name, std::chrono::nanoseconds tick_period);
+
+  CallbackReturn on_activate(const rclcpp_lifecycle::State & state) override;
+  CallbackReturn on_deactivate(const rclcpp_lifecycle::State & state) override;
+
+protected:
+  // Called before the first step of every action
+  virtual void on_start() {}
+  virtual void step() = 0;
+  // Called when the action ends, also when it is cancelled
+  virtual void on_stop() {}
+
+  // Runs step() now if an action is running. Safe from any callback and thread.
+  void wake();
+
+  // Holds the state lock; releasing the outermost one of a thread runs a pending finish()
+  class StateLock
+  {
+public:
+    explicit StateLock(EventDrivenActionExecutor & owner);
+    ~StateLock();
+    StateLock(const StateLock &) = delete;
+    StateLock & operator=(const StateLock &) = delete;
+
+private:
+    EventDrivenActionExecutor & owner_;
+  };
+
+  // Every piece of state shared between data callbacks and step() is guarded by this lock
+  StateLock lock_state() {return StateLock(*this);}
+
+  Phase phase() const {return phase_.load();}
+  bool running() const {return phase_.load() == Phase::RUNNING;}
+
+  void set_progress(float completion, const std::string & status);
+  // Ends the running action, only the first call per action has an effect
+  void complete(bool success, float completion, const std::string & status);
+
+private:
+  struct Completion
+  {
+    bool success;
+    float completion;
+    std::string status;
+  };
+
+  void do_work() final;
+  void run_step();
+
+  std::recursive_mutex state_mutex_;
+  // Nesting of the state lock in the thread holding it
+  int lock_depth_ = 0;
+  std::optional<Completion> pending_completion_;
+  std::atomic<Phase> phase_{Phase::IDLE};
+  bool event_driven_;
+  bool started_ = false;
+
+  float progress_ = 0.0f;
+  std::string status_;
+
+  bool woken_ = false;
+  std::chrono::steady_clock::time_point last_wake_;
+  uint64_t completions_ = 0;
+  double total_reaction_ms_ = 0.0;
+  double max_reaction_ms_ = 0.0;
+};
+
+}  // namespace plansys_interface
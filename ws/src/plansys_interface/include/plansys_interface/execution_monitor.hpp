@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace plansys_interface
+{
+
+enum class ActionState
+{
+  PENDING,
+  RUNNING,
+  SUCCEEDED,
+  FAILED,
+};
+
+struct ActionRecord
+{
+  std::string action;  // action type, e.g. "move"
+  ActionState state = ActionState::PENDING;
+  double start = 0.0;
+  double end = 0.0;
+  double duration() const {return end - start;}
+};
+
+struct ActionTypeStats
+{
+  std::string action;
+  size_t succeeded = 0;
+  size_t failed = 0;
+  double total_duration = 0.0;
+  double min_duration = 0.0;
+  double max_duration = 0.0;
+  double mean_duration() const
+  {
+    size_t n = succeeded + failed;
+    return n ? total_duration / n : 0.0;
+  }
+};
+
+struct ExecutionSummary
+{
+  bool success = false;
+  double plan_duration = 0.0;
+  size_t planned = 0;
+  size_t succeeded = 0;
+  size_t failed = 0;
+  std::vector<ActionTypeStats> stats;
+  std::string slowest_action;
+  double slowest_duration = 0.0;
+};
+
+// Follows the execution of a plan from the executor's per-action status
+// updates. Counters are updated on every state change, so finding out
+// whether the plan has ended does not depend on the number of actions.
+class ExecutionMonitor
+{
+public:
+  // Starts monitoring a plan of planned_actions actions
+  void reset(size_t planned_actions);
+
+  // Replaces the unfinished part of the plan by planned_actions new actions,
+  // at time stamp. Finished actions are kept. Updates for the dropped ones are
+  // ignored, while the new plan may reuse their names.
+  void replan(size_t planned_actions, double stamp);
+
+  // Feeds a status update, times in seconds. Returns true if the update
+  // changed the state of the action.
+  bool update(
+    const std::string & full_name, const std::string & action, ActionState state,
+    double start, double stamp);
+
+  size_t planned() const {return planned_;}
+  size_t pending() const {return pending_;}
+  size_t running() const {return running_;}
+  size_t succeeded() const {return succeeded_;}
+  size_t failed() const {return failed_;}
+
+  // Every planned action has finished, or one has failed
+  bool finished() const {return failed_ > 0 || (planned_ > 0 && succeeded_ >= planned_);}
+
+  const ActionRecord * find(const std::string & full_name) const;
+  ExecutionSummary summary() const;
+
+private:
+  size_t & counter(ActionState state);
+
+  size_t planned_ = 0;
+  size_t pending_ = 0;
+  size_t running_ = 0;
+  size_t succeeded_ = 0;
+  size_t failed_ = 0;
+  std::unordered_map<std::string, ActionRecord> records_;
+  std::vector<std::pair<std::string, ActionRecord>> archive_;
+  // Dropped action names, with the time of the replan that dropped them
+  std::unordered_map<std::string, double> dropped_;
+};
+
+const char * to_string(ActionState state);
+
+}  // namespace plansys_interface
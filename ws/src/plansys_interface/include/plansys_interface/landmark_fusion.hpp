@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace plansys_interface
+{
+
+struct Vec3
+{
+  double x = 0.0, y = 0.0, z = 0.0;
+
+  Vec3 operator+(const Vec3 & o) const {return {x + o.x, y + o.y, z + o.z};}
+  Vec3 operator-(const Vec3 & o) const {return {x - o.x, y - o.y, z - o.z};}
+  Vec3 operator*(double s) const {return {x * s, y * s, z * s};}
+  double dot(const Vec3 & o) const {return x * o.x + y * o.y + z * o.z;}
+  double norm() const {return std::sqrt(dot(*this));}
+};
+
+// Row-major 3x3 matrix, used for position covariances
+struct Mat3
+{
+  double m[3][3] = {{0, 0, 0}, {0, 0, 0}, {0, 0, 0}};
+
+  static Mat3 identity(double s = 1.0);
+  Mat3 operator+(const Mat3 & o) const;
+  Mat3 operator*(const Mat3 & o) const;
+  Vec3 operator*(const Vec3 & v) const;
+  Mat3 transposed() const;
+  double trace() const {return m[0][0] + m[1][1] + m[2][2];}
+  // false if the matrix is singular
+  bool inverse(Mat3 & out) const;
+};
+
+struct Quat
+{
+  double x = 0.0, y = 0.0, z = 0.0, w = 1.0;
+
+  Quat operator*(const Quat & o) const;
+  Vec3 rotate(const Vec3 & v) const;
+  Mat3 matrix() const;
+  Quat normalized() const;
+};
+
+struct Pose3
+{
+  Vec3 position;
+  Quat orientation;
+
+  // this * other, other given in the frame of this
+  Pose3 compose(const Pose3 & other) const;
+};
+
+struct FusionConfig
+{
+  double lateral_noise = 0.005;     // m of position std per m of range, across the ray
+  double depth_noise = 0.02;        // m of position std per m^2 of range, along the ray
+  // Floors of the fused landmark std, for localisation and calibration errors. These are
+  // shared by every frame of a visit, so they are not reduced by fusing more frames.
+  double min_position_std = 0.02;   // m
+  double orientation_noise = 0.05;  // rad of orientation std per m of range
+  double min_orientation_std = 0.02;
+  double max_range = 4.0;           // farther observations are ignored (m)
+  double gate = 11.34;              // chi-square, 3 dof, 99 %
+  double max_orientation_error = 0.5;
+  int reset_after_outliers = 5;     // consecutive outliers after which the landmark moved
+  int min_observations = 3;
+  double converged_std = 0.03;      // position std below which a landmark is converged (m)
+};
+
+struct LandmarkObservation
+{
+  Pose3 pose;         // map frame
+  Mat3 covariance;    // of the position from the detection noise alone, map frame
+  double orientation_std = 0.0;
+  double range = 0.0;  // from the camera (m)
+};
+
+struct Landmark
+{
+  Pose3 pose;
+  Mat3 covariance;                  // fused noise plus the min_position_std floor
+  Mat3 noise_covariance;            // fused detection noise alone
+  double orientation_weight = 0.0;  // sum of inverse orientation variances of the noise
+  double orientation_floor = 0.0;   // min_orientation_std
+  uint32_t observations = 0;
+  int outliers_in_row = 0;
+  bool converged = false;
+
+  double position_std() const {return std::sqrt(covariance.trace() / 3.0);}
+  double orientation_std() const
+  {
+    return orientation_weight > 0.0 ?
+           std::sqrt(1.0 / orientation_weight + orientation_floor * orientation_floor) : INFINITY;
+  }
+};
+
+// Fuses repeated observations of markers and boards into map-frame landmarks.
+//
+// Positions are fused in information form with an anisotropic noise model:
+// ArUco poses are much less certain along the camera ray than across it, and
+// both errors grow with range. Orientations are averaged with inverse-variance
+// weights. Only the per-frame detection noise shrinks with fusion; the
+// localisation floor is added to the fused result, so one long pass does not
+// make a landmark so certain that the next visit is gated out. Observations outside the Mahalanobis gate are rejected; a landmark
+// that keeps disagreeing with new observations is restarted from them.
+class LandmarkFuser
+{
+public:
+  enum class Result { ADDED, FUSED, OUTLIER, RESET, IGNORED };
+
+  explicit LandmarkFuser(const FusionConfig & config = FusionConfig());
+
+  // Builds an observation of a pose given in a detection frame, with map_from_frame
+  // the pose of that frame and camera_position the camera origin, both in the map
+  LandmarkObservation observe(
+    const Pose3 & in_frame, const Pose3 & map_from_frame, const Vec3 & camera_position) const;
+
+  Result add(const std::string & key, const LandmarkObservation & observation);
+
+  const std::map<std::string, Landmark> & landmarks() const {return landmarks_;}
+  // Increases with every change of the landmarks
+  uint64_t revision() const {return revision_;}
+  void clear();
+
+private:
+  FusionConfig config_;
+  std::map<std::string, Landmark> landmarks_;
+  uint64_t revision_ = 0;
+};
+
+}  // namespace plansys_interface
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "plansys_interface/marker_store.hpp"
+
+namespace plansys_interface
+{
+
+// On-disk header of the landmark log. The header is followed by fixed-size
+// records, each one a full upsert or a removal of a single marker.
+struct LandmarkLogHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t committed;   // number of records known to be complete
+  uint8_t reserved[40];
+};
+
+struct LandmarkRecord
+{
+  uint32_t crc;         // CRC-32 of the bytes following this field
+  uint16_t type;
+  uint16_t wp_length;
+  int32_t marker_id;
+  uint32_t reserved;
+  uint64_t sequence;    // 1-based position in the log
+  double position[3];
+  double orientation[4];
+  char wp[48];
+};
+
+static_assert(sizeof(LandmarkLogHeader) == 64, "LandmarkLogHeader must be 64 bytes");
+static_assert(sizeof(LandmarkRecord) == 128, "LandmarkRecord must be 128 bytes");
+
+// Append-only, memory-mapped log of marker changes.
+//
+// A record is written into the mapping and flushed before the header count is
+// advanced, so a crash can at worst lose the record being written. On open,
+// records are replayed until the first one whose checksum or sequence number
+// does not match, which also recovers records written after the last header
+// update. Logs with many superseded records are compacted on open.
+class LandmarkLog
+{
+public:
+  LandmarkLog() = default;
+  LandmarkLog(const LandmarkLog &) = delete;
+  LandmarkLog & operator=(const LandmarkLog &) = delete;
+  ~LandmarkLog();
+
+  // Opens or creates the log at path and replays it into store
+  bool open(
+    const std::string & path, bool sync_writes, MarkerStore & store,
+    std::string & error_message);
+  void close();
+
+  bool append_upsert(const MarkerInfo & info, std::string & error_message);
+  bool append_remove(int marker_id, std::string & error_message);
+
+  bool is_open() const {return header_ != nullptr;}
+  uint64_t record_count() const {return header_ ? header_->committed : 0;}
+
+private:
+  bool map_file(const std::string & path, std::string & error_message);
+  bool reserve(uint64_t records, std::string & error_message);
+  bool append(LandmarkRecord & record, std::string & error_message);
+  bool compact(const MarkerStore & store, std::string & error_message);
+  void flush(const void * addr, size_t len);
+
+  std::string path_;
+  bool sync_writes_ = true;
+  int fd_ = -1;
+  uint8_t * data_ = nullptr;
+  size_t mapped_size_ = 0;
+  LandmarkLogHeader * header_ = nullptr;
+};
+
+}  // namespace plansys_interface
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "geometry_msgs/msg/pose.hpp"
+
+namespace plansys_interface
+{
+
+struct MarkerInfo {
+  int marker_id;
+  std::string robot_wp;
+  geometry_msgs::msg::Pose robot_pose;
+  std::string robot;      // reporting robot, empty when not namespaced
+  int64_t stamp_ns = 0;   // detection time, 0 for markers restored from disk
+};
+
+// Markers kept sorted by ID in a flat vector: lookups are O(log n), the nth
+// lowest marker is O(1) and iteration is already in publishing order.
+class MarkerStore
+{
+public:
+  enum class Change { NONE, ADDED, UPDATED };
+
+  Change upsert(const MarkerInfo & info)
+  {
+    auto it = lower_bound(info.marker_id);
+    if (it != markers_.end() && it->marker_id == info.marker_id) {
+      if (it->robot_wp == info.robot_wp && it->robot_pose == info.robot_pose) {
+        return Change::NONE;
+      }
+      *it = info;
+      return Change::UPDATED;
+    }
+    markers_.insert(it, info);
+    return Change::ADDED;
+  }
+
+  bool remove(int marker_id)
+  {
+    auto it = lower_bound(marker_id);
+    if (it == markers_.end() || it->marker_id != marker_id) {
+      return false;
+    }
+    markers_.erase(it);
+    return true;
+  }
+
+  const MarkerInfo * find(int marker_id) const
+  {
+    auto it = lower_bound(marker_id);
+    if (it == markers_.end() || it->marker_id != marker_id) {
+      return nullptr;
+    }
+    return &*it;
+  }
+
+  // nth lowest marker by ID, nullptr if out of range
+  const MarkerInfo * nth(size_t n) const
+  {
+    return n < markers_.size() ? &markers_[n] : nullptr;
+  }
+
+  size_t size() const {return markers_.size();}
+  bool empty() const {return markers_.empty();}
+  std::vector<MarkerInfo>::const_iterator begin() const {return markers_.begin();}
+  std::vector<MarkerInfo>::const_iterator end() const {return markers_.end();}
+
+private:
+  std::vector<MarkerInfo>::iterator lower_bound(int marker_id)
+  {
+    return std::lower_bound(markers_.begin(), markers_.end(), marker_id,
+      [](const MarkerInfo & m, int id) {return m.marker_id < id;});
+  }
+
+  std::vector<MarkerInfo>::const_iterator lower_bound(int marker_id) const
+  {
+    return std::lower_bound(markers_.begin(), markers_.end(), marker_id,
+      [](const MarkerInfo & m, int id) {return m.marker_id < id;});
+  }
+
+  std::vector<MarkerInfo> markers_;
+};
+
+}  // namespace plansys_interface
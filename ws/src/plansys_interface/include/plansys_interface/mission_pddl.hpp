@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace plansys_interface
+{
+
+// Literal of a schema or a fact. Arguments starting with '?' are parameters.
+struct Atom
+{
+  std::string predicate;
+  std::vector<std::string> args;
+};
+
+struct ActionSchema
+{
+  std::string name;
+  std::vector<std::pair<std::string, std::string>> params;  // name, type
+  std::vector<Atom> pre;
+  std::vector<Atom> neg_pre;
+  std::vector<std::pair<std::string, std::string>> distinct;  // (not (= a b))
+  std::vector<Atom> add;
+  std::vector<Atom> del;
+};
+
+struct PddlDomain
+{
+  std::string name;
+  std::vector<std::string> types;
+  std::vector<std::string> predicates;  // declarations, e.g. "(at ?r - robot ?w - waypoint)"
+  std::vector<ActionSchema> actions;
+};
+
+struct PddlProblem
+{
+  std::string name;
+  std::vector<std::pair<std::string, std::string>> objects;  // name, type
+  std::vector<Atom> init;
+  std::vector<Atom> goal;
+};
+
+struct MissionSpec
+{
+  size_t markers = 4;
+  size_t waypoints = 4;  // detection waypoints, the start waypoint comes on top
+};
+
+// Marker mission domain whose grounding grows linearly with the number of
+// markers: rotateanddetect counts detections marker by marker along a static
+// next-marker chain, instead of one action checking all markers. Only the
+// actions of the existing action nodes appear in its plans; rotateanddetect
+// gets a trailing ?prev argument and finishdetection takes 4 arguments.
+PddlDomain linear_mission_domain();
+
+// Original encoding, with a finishdetection action taking every marker and
+// its waypoint as parameters. For 4 markers it matches domain/domain.pddl.
+PddlDomain nary_mission_domain(size_t markers);
+
+// Robot at "st", waypoints wp1..wpM chained from it, marker i visible at
+// wp((i - 1) % M + 1) and every marker to be photographed. The linear
+// encoding adds the m0 placeholder that starts the next-marker chain.
+PddlProblem mission_problem(const MissionSpec & spec, bool linear);
+
+std::string to_pddl(const PddlDomain & domain);
+std::string to_pddl(const PddlProblem & problem, const std::string & domain_name);
+
+struct GroundingStats
+{
+  size_t ground_actions = 0;
+  bool truncated = false;  // stopped at the action or time limit
+  double seconds = 0.0;
+};
+
+// Enumerates the ground actions whose static preconditions and inequalities
+// hold in the initial state, as planners do before searching. Stops after
+// limit ground actions or time_limit seconds.
+GroundingStats ground(
+  const PddlDomain & domain, const PddlProblem & problem, size_t limit, double time_limit);
+
+}  // namespace plansys_interface
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "rclcpp/rclcpp.hpp"
+#include "plansys2_interface/msg/detected_marker.hpp"
+#include "plansys2_interface/msg/marker_observations.hpp"
+#include "plansys2_interface/msg/marker_observations_ack.hpp"
+
+namespace plansys_interface
+{
+
+struct ObservationPublisherOptions
+{
+  std::chrono::milliseconds batch_period{50};   // observations are sent at most this late
+  size_t max_batch = 64;                        // a full batch is sent right away
+  std::chrono::milliseconds retry_period{1000}; // unacknowledged batches are sent again
+  int max_attempts = 5;                         // then the batch is counted as lost
+};
+
+// Streams marker observations to the world node in sequenced batches.
+//
+// add() only queues the observation, so it never blocks the caller. Batches
+// are kept until the world node acknowledges them and sent again otherwise;
+// a batch that is never acknowledged is logged and counted in lost().
+class ObservationPublisher
+{
+public:
+  // Works with plain and lifecycle nodes. The publisher is not a lifecycle
+  // publisher, registration does not depend on the node state.
+  template<typename NodeT>
+  explicit ObservationPublisher(NodeT * node, const ObservationPublisherOptions & options = {})
+  : options_(options),
+    source_(make_source(node->get_fully_qualified_name())),
+    logger_(node->get_logger())
+  {
+    batches_pub_ = rclcpp::create_publisher<plansys2_interface::msg::MarkerObservations>(
+      *node, "/world_node/observations", rclcpp::QoS(100).reliable());
+    acks_sub_ = rclcpp::create_subscription<plansys2_interface::msg::MarkerObservationsAck>(
+      *node, "/world_node/observation_acks", rclcpp::QoS(100).reliable(),
+      [this](const plansys2_interface::msg::MarkerObservationsAck & ack) {on_ack(ack);});
+    timer_ = rclcpp::create_wall_timer(options_.batch_period, [this]() {on_timer();}, nullptr,
+        node->get_node_base_interface().get(), node->get_node_timers_interface().get());
+    queued_.source = source_;
+  }
+  ObservationPublisher(const ObservationPublisher &) = delete;
+  ObservationPublisher & operator=(const ObservationPublisher &) = delete;
+
+  void add(const plansys2_interface::msg::DetectedMarker & observation);
+
+  // Sends the queued observations now instead of at the end of the batch period
+  void flush();
+
+  const std::string & source() const {return source_;}
+  size_t pending() const;
+  uint64_t acknowledged() const;
+  uint64_t lost() const;
+
+private:
+  struct InFlight
+  {
+    plansys2_interface::msg::MarkerObservations batch;
+    std::chrono::steady_clock::time_point sent;
+    int attempts = 0;
+  };
+
+  static std::string make_source(const std::string & node_name);
+  void on_timer();
+  void on_ack(const plansys2_interface::msg::MarkerObservationsAck & ack);
+  // Requires mutex_
+  void send_queued();
+
+  ObservationPublisherOptions options_;
+  std::string source_;
+  rclcpp::Logger logger_;
+  rclcpp::Publisher<plansys2_interface::msg::MarkerObservations>::SharedPtr batches_pub_;
+  rclcpp::Subscription<plansys2_interface::msg::MarkerObservationsAck>::SharedPtr acks_sub_;
+  rclcpp::TimerBase::SharedPtr timer_;
+
+  mutable std::mutex mutex_;
+  plansys2_interface::msg::MarkerObservations queued_;
+  std::map<uint64_t, InFlight> in_flight_;
+  uint64_t next_sequence_ = 1;
+  uint64_t acknowledged_ = 0;
+  uint64_t lost_ = 0;
+};
+
+}  // namespace plansys_interface
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "plansys_interface/waypoint_registry.hpp"
+
+namespace plansys_interface
+{
+
+// Occupancy grid loaded from a map_server YAML/PGM pair. Row 0 is the bottom of the map.
+struct GridMap
+{
+  int width = 0;
+  int height = 0;
+  double resolution = 0.0;
+  double origin_x = 0.0;
+  double origin_y = 0.0;
+  std::vector<uint8_t> free;  // 1 for traversable cells
+};
+
+bool load_grid_map(const std::string & yaml_path, GridMap & map, std::string & error_message);
+
+// Shortest path lengths (in metres) between every pair of waypoints on a grid map
+class PathCostMatrix
+{
+public:
+  static constexpr double UNREACHABLE = std::numeric_limits<double>::infinity();
+
+  // Runs one Dijkstra search per waypoint, spread over the given number of threads.
+  // Cells closer than robot_radius to an obstacle or unknown space are not traversable.
+  bool compute(
+    const WaypointRegistry & registry, const GridMap & map, double robot_radius,
+    size_t threads, std::string & error_message);
+
+  bool load_cache(const std::string & path, uint64_t key, std::string & error_message);
+  bool save_cache(const std::string & path, uint64_t key, std::string & error_message) const;
+
+  double cost(size_t from, size_t to) const {return costs_[from * size_ + to];}
+  size_t size() const {return size_;}
+
+private:
+  size_t size_ = 0;
+  std::vector<double> costs_;
+};
+
+// Hash of everything the matrix depends on: map contents, waypoints and robot radius
+bool path_cost_cache_key(
+  const WaypointRegistry & registry, const std::string & map_yaml_path, double robot_radius,
+  uint64_t & key, std::string & error_message);
+
+// Loads the matrix from cache_dir when it matches the inputs, otherwise computes it and
+// stores it there. An empty cache_dir disables caching.
+bool load_or_compute_path_costs(
+  const WaypointRegistry & registry, const std::string & map_yaml_path, double robot_radius,
+  const std::string & cache_dir, PathCostMatrix & costs, bool & from_cache,
+  std::string & error_message);
+
+}  // namespace plansys_interface
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "aruco_opencv_msgs/msg/marker_image_points.hpp"
+#include "rclcpp/logger.hpp"
+#include "sensor_msgs/msg/image.hpp"
+
+namespace plansys_interface
+{
+
+struct PhotoJob
+{
+  sensor_msgs::msg::Image::ConstSharedPtr image;
+  aruco_opencv_msgs::msg::MarkerImagePoints marker;
+  std::string path;
+};
+
+// Annotates and encodes photos on a background thread, so image encoding never
+// blocks the executor. Jobs are rejected instead of queued once the queue is full.
+class PhotoWriter
+{
+public:
+  PhotoWriter(const rclcpp::Logger & logger, size_t max_queue, int jpeg_quality);
+  ~PhotoWriter();
+
+  PhotoWriter(const PhotoWriter &) = delete;
+  PhotoWriter & operator=(const PhotoWriter &) = delete;
+
+  // Returns false if the queue is full
+  bool enqueue(PhotoJob && job);
+
+private:
+  void run();
+  void write(const PhotoJob & job);
+
+  rclcpp::Logger logger_;
+  size_t max_queue_;
+  int jpeg_quality_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<PhotoJob> queue_;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+}  // namespace plansys_interface
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+#include "plansys2_msgs/msg/plan.hpp"
+
+namespace plansys_interface
+{
+
+// Plans keyed by the text of the domain and problem they solve. Entries are
+// kept in memory and, when a directory is given, in one file per problem so
+// that repeated missions on the same site skip the planner.
+class PlanCache
+{
+public:
+  explicit PlanCache(const std::string & cache_dir = "")
+  : cache_dir_(cache_dir) {}
+
+  static uint64_t key(const std::string & domain, const std::string & problem);
+
+  bool lookup(
+    const std::string & domain, const std::string & problem,
+    plansys2_msgs::msg::Plan & plan);
+  // A failure to write the file is reported but the plan stays cached in memory
+  bool store(
+    const std::string & domain, const std::string & problem,
+    const plansys2_msgs::msg::Plan & plan, std::string & error_message);
+
+private:
+  // The texts are kept next to the plan, a hash collision must not return a wrong plan
+  struct Entry
+  {
+    std::string domain;
+    std::string problem;
+    plansys2_msgs::msg::Plan plan;
+  };
+
+  std::string path_of(uint64_t key) const;
+
+  std::string cache_dir_;
+  std::unordered_map<uint64_t, Entry> plans_;
+};
+
+}  // namespace plansys_interface
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace plansys_interface
+{
+
+struct ScanConfig
+{
+  // Horizontal field of view of the camera (rad)
+  double camera_hfov = 1.396;
+  // Number of detector frames any direction should stay in view while rotating
+  int frames_per_view = 8;
+  // Rotation speed limits (rad/s)
+  double max_speed = 1.0;
+  double candidate_speed = 0.15;
+  // Consecutive frames a marker has to be seen in before it counts as detected
+  int confirm_frames = 3;
+  // Observations of markers smaller than this (px) or with a larger reprojection
+  // error (px) are ignored
+  double min_marker_size = 20.0;
+  double max_reprojection_error = 2.0;
+  // Assumed until the first frames have been timed
+  double initial_frame_rate = 10.0;
+};
+
+struct MarkerObservation
+{
+  int marker_id;
+  double size;
+  double reprojection_error;  // negative when no pose was estimated
+};
+
+// Chooses the rotation speed of a marker scan and confirms detections.
+//
+// The speed is set so that every direction stays in view for frames_per_view
+// frames at the measured detector frame rate, and drops to candidate_speed
+// while a marker is seen but not yet confirmed.
+class ScanScheduler
+{
+public:
+  explicit ScanScheduler(const ScanConfig & config = ScanConfig())
+  : config_(config)
+  {
+    reset();
+  }
+
+  void reset()
+  {
+    frame_rate_ = config_.initial_frame_rate;
+    last_stamp_ = -1.0;
+    have_yaw_ = false;
+    swept_ = 0.0;
+    streaks_.clear();
+    confirmed_.clear();
+  }
+
+  // Feeds one detector frame, returns the markers confirmed by it
+  std::vector<int> on_frame(double stamp, const std::vector<MarkerObservation> & observations)
+  {
+    if (last_stamp_ >= 0.0) {
+      double dt = stamp - last_stamp_;
+      if (dt > 0.0 && dt < 1.0) {
+        frame_rate_ = 0.8 * frame_rate_ + 0.2 * (1.0 / dt);
+      }
+    }
+    last_stamp_ = stamp;
+
+    std::map<int, int> streaks;
+    std::vector<int> newly_confirmed;
+    for (const auto & obs : observations) {
+      if (!is_sharp(obs) || streaks.count(obs.marker_id)) {
+        continue;
+      }
+      auto it = streaks_.find(obs.marker_id);
+      int streak = (it == streaks_.end() ? 0 : it->second) + 1;
+      streaks[obs.marker_id] = streak;
+      if (streak == config_.confirm_frames && !is_confirmed(obs.marker_id)) {
+        confirmed_.push_back(obs.marker_id);
+        newly_confirmed.push_back(obs.marker_id);
+      }
+    }
+    // Markers missing from this frame start over
+    streaks_ = std::move(streaks);
+    return newly_confirmed;
+  }
+
+  // Feeds the current robot yaw, used to measure how far the scan has turned
+  void on_yaw(double yaw)
+  {
+    if (have_yaw_) {
+      swept_ += std::abs(std::remainder(yaw - last_yaw_, 2.0 * M_PI));
+    }
+    last_yaw_ = yaw;
+    have_yaw_ = true;
+  }
+
+  double rotation_speed() const
+  {
+    double speed = config_.camera_hfov * frame_rate_ / config_.frames_per_view;
+    speed = std::min(speed, config_.max_speed);
+    if (has_candidate()) {
+      speed = std::min(speed, config_.candidate_speed);
+    }
+    return speed;
+  }
+
+  // A marker is being tracked but has not been confirmed yet
+  bool has_candidate() const
+  {
+    for (const auto & streak : streaks_) {
+      if (!is_confirmed(streak.first)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool sweep_complete() const {return swept_ >= 2.0 * M_PI;}
+  double swept_angle() const {return swept_;}
+  double frame_rate() const {return frame_rate_;}
+  const std::vector<int> & confirmed() const {return confirmed_;}
+
+private:
+  bool is_sharp(const MarkerObservation & obs) const
+  {
+    return obs.size >= config_.min_marker_size &&
+           obs.reprojection_error <= config_.max_reprojection_error;
+  }
+
+  bool is_confirmed(int marker_id) const
+  {
+    return std::find(confirmed_.begin(), confirmed_.end(), marker_id) != confirmed_.end();
+  }
+
+  ScanConfig config_;
+  double frame_rate_;
+  double last_stamp_;
+  bool have_yaw_;
+  double last_yaw_ = 0.0;
+  double swept_;
+  std::map<int, int> streaks_;
+  std::vector<int> confirmed_;
+};
+
+}  // namespace plansys_interface
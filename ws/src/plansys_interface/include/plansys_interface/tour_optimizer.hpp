@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "plansys_interface/path_cost_matrix.hpp"
+
+namespace plansys_interface
+{
+
+// Cheapest order to visit every stop once, starting at start and without returning.
+// Exact for up to MAX_EXACT_STOPS stops, nearest neighbour refined by 2-opt above that.
+// Fails, leaving order empty, when some stop cannot be reached on the map.
+bool optimise_tour(
+  const PathCostMatrix & costs, size_t start, const std::vector<size_t> & stops,
+  std::vector<size_t> & order, std::string & error_message);
+
+// Total cost of visiting the stops in the given order, starting at start
+double tour_cost(const PathCostMatrix & costs, size_t start, const std::vector<size_t> & order);
+
+constexpr size_t MAX_EXACT_STOPS = 12;
+
+}  // namespace plansys_interface
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace plansys_interface
+{
+
+struct Waypoint
+{
+  std::string name;
+  double x;
+  double y;
+  double yaw;
+};
+
+// Waypoints by name, loaded from a YAML file. Indices are stable once
+// loaded and are used to address the path cost matrix.
+class WaypointRegistry
+{
+public:
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  bool load_from_file(const std::string & path, std::string & error_message);
+
+  const Waypoint * find(const std::string & name) const;
+  size_t index_of(const std::string & name) const;
+
+  const Waypoint & at(size_t index) const {return waypoints_[index];}
+  const std::vector<Waypoint> & waypoints() const {return waypoints_;}
+  size_t size() const {return waypoints_.size();}
+
+private:
+  std::vector<Waypoint> waypoints_;
+  std::unordered_map<std::string, size_t> index_;
+};
+
+}  // namespace plansys_interface
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "plansys_interface/marker_store.hpp"
+
+namespace plansys_interface
+{
+
+// Marker map shared by a fleet of robots and safe to update from many threads.
+//
+// Markers are spread over shards by ID, each with its own mutex, so reports of
+// different markers do not contend. Ordered reads go through an immutable
+// MarkerStore snapshot that is rebuilt on the first read after a change and
+// shared by all readers until the next one.
+//
+// Conflicting reports of one marker are resolved by supersedes(), which only
+// looks at the reports themselves, so every arrival order ends in the same map.
+class WorldModel
+{
+public:
+  enum class Result { ADDED, UPDATED, REJECTED };
+
+  // Called with the shard locked for every accepted change, so calls for one
+  // marker are ordered like the changes. removed is set for removals.
+  using ChangeListener = std::function<void (const MarkerInfo & info, bool removed)>;
+
+  explicit WorldModel(size_t shards = 16);
+  WorldModel(const WorldModel &) = delete;
+  WorldModel & operator=(const WorldModel &) = delete;
+
+  void set_listener(ChangeListener listener) {listener_ = std::move(listener);}
+
+  // Replaces the content without notifying the listener or recording changes
+  void load(const MarkerStore & store);
+
+  // kept receives the marker as held after the report
+  Result report(const MarkerInfo & info, MarkerInfo & kept);
+  bool remove(int marker_id);
+
+  std::shared_ptr<const MarkerStore> snapshot() const;
+  size_t size() const {return size_.load(std::memory_order_relaxed);}
+
+  // Markers changed since the previous call, coalesced per marker and sorted by
+  // ID. Returns false if nothing changed.
+  bool take_changes(std::vector<MarkerInfo> & upserted, std::vector<int> & removed);
+
+  // Deterministic order of reports of the same marker: the later detection
+  // wins, then the lower robot name, then the lower waypoint and position.
+  static bool supersedes(const MarkerInfo & a, const MarkerInfo & b);
+
+private:
+  struct Shard
+  {
+    std::mutex mutex;
+    std::unordered_map<int, MarkerInfo> markers;
+    std::unordered_set<int> changed;
+  };
+
+  Shard & shard_for(int marker_id);
+
+  std::unique_ptr<Shard[]> shards_;
+  size_t shard_count_;
+  ChangeListener listener_;
+  std::atomic<size_t> size_{0};
+  std::atomic<uint64_t> version_{0};
+
+  mutable std::mutex snapshot_mutex_;
+  mutable std::shared_ptr<const MarkerStore> snapshot_;
+  mutable uint64_t snapshot_version_ = 0;
+};
+
+}  // namespace plansys_interface
@@ -3,12 +3,14 @@ import os
 from ament_index_python.packages import get_package_share_directory
 
 from launch import LaunchDescription
-from launch.actions import DeclareLaunchArgument, IncludeLaunchDescription
+from launch.actions import DeclareLaunchArgument, GroupAction, IncludeLaunchDescription
+from launch.conditions import IfCondition, UnlessCondition
 from launch.launch_description_sources import PythonLaunchDescriptionSource
 from launch_xml.launch_description_sources import XMLLaunchDescriptionSource
 
 from launch.substitutions import LaunchConfiguration
-from launch_ros.actions import Node
+from launch_ros.actions import ComposableNodeContainer, Node
+from launch_ros.descriptions import ComposableNode
 
 
 def generate_launch_description():
@@ -23,6 +25,10 @@ def generate_launch_description():
     start_action_bt_file = LaunchConfiguration('start_action_bt_file')
     end_action_bt_file = LaunchConfiguration('end_action_bt_file')
     bt_builder_plugin = LaunchConfiguration('bt_builder_plugin')
+    landmark_store_path = LaunchConfiguration('landmark_store_path')
+    use_composition = LaunchConfiguration('use_composition')
+    photograph_order = LaunchConfiguration('photograph_order')
+    event_driven = LaunchConfiguration('event_driven')
     
     declare_model_file_cmd = DeclareLaunchArgument(
         'model_file',
@@ -73,6 +79,31 @@ def generate_launch_description():
         description='Behavior tree builder plugin.',
     )
 
+    declare_landmark_store_path_cmd = DeclareLaunchArgument(
+        'landmark_store_path',
+        default_value='',
+        description='File where the world node persists detected markers, e.g. '
+                    '/home/user/.ros/world_node_landmarks.db. Restored markers skip their '
+                    'scans, so only set it when the scene is unchanged since the last mission')
+
+    declare_use_composition_cmd = DeclareLaunchArgument(
+        'use_composition',
+        default_value='True',
+        description='Run the action executors and the world node in one component container')
+
+    declare_photograph_order_cmd = DeclareLaunchArgument(
+        'photograph_order',
+        default_value='id',
+        description='Order markers are photographed in: "id" (increasing marker ID, as the '
+                    'assignment requires) or "cost" (cheapest travel on final_map)')
+
+    declare_event_driven_cmd = DeclareLaunchArgument(
+        'event_driven',
+        default_value='True',
+        description='Run rotateanddetect, photographmarker and align as soon as their data '
+                    'arrives instead of on the next tick. Each completion logs the reaction '
+                    'time with its mean and max, set it to False to compare with polling')
+
     domain_expert_cmd = IncludeLaunchDescription(
         PythonLaunchDescriptionSource(os.path.join(
             get_package_share_directory('plansys2_domain_expert'),
@@ -129,15 +160,23 @@ def generate_launch_description():
         output='screen',
         parameters=[])
         
+    move_params = {
+        'map_file': os.path.join(
+            get_package_share_directory('ros2_navigation'), 'maps', 'final_map.yaml'),
+        'path_cost_cache_dir': os.path.join(os.path.expanduser('~'), '.ros'),
+        # map_file is only read with photograph_order:=cost
+        'photograph_order': photograph_order,
+    }
+
     move_cmd = Node(
         package='plansys_interface',
         executable='move_action_node_3',
         name='move_action_node',
         namespace=namespace,
         output='screen',
-        parameters=[])
-
+        parameters=[move_params])
 
+    executor_params = {'event_driven': event_driven}
 
 
     rotate_detect_cmd = Node(
@@ -146,7 +185,7 @@ def generate_launch_description():
         name='rotate_and_detect_action_node',
         namespace=namespace,
         output='screen',
-        parameters=[])
+        parameters=[executor_params])
 
     photograph_cmd = Node(
         package='plansys_interface',
@@ -154,7 +193,7 @@ def generate_launch_description():
         name='photograph_marker_action_node',
         namespace=namespace,
         output='screen',
-        parameters=[])  
+        parameters=[executor_params])  
 
     align_cmd = Node(
         package='plansys_interface',
@@ -162,7 +201,7 @@ def generate_launch_description():
         name='align_action_node',
         namespace=namespace,
         output='screen',
-        parameters=[])
+        parameters=[executor_params])
 
     finish_detection_cmd = Node(
         package='plansys_interface',
@@ -178,7 +217,53 @@ def generate_launch_description():
         name='world_node',
         namespace=namespace,
         output='screen',
-        parameters=[])  
+        parameters=[{'landmark_store_path': landmark_store_path}])
+
+    landmark_fusion_cmd = Node(
+        package='plansys_interface',
+        executable='landmark_fusion_node',
+        name='landmark_fusion_node',
+        namespace=namespace,
+        output='screen',
+        parameters=[])
+
+    separate_nodes_cmd = GroupAction(
+        condition=UnlessCondition(use_composition),
+        actions=[move_cmd, rotate_detect_cmd, photograph_cmd, align_cmd,
+                 finish_detection_cmd, world_cmd, landmark_fusion_cmd])
+
+    # All executors and the world node share one process and one multi-threaded
+    # executor. The action executors do not take NodeOptions, so their parameters
+    # are given to the container process and intra-process communication would be
+    # ignored; only the world and landmark fusion nodes get their own options.
+    def component(plugin, name, parameters=None, intra_process=False):
+        return ComposableNode(
+            package='plansys_interface',
+            plugin=plugin,
+            name=name,
+            namespace=namespace,
+            parameters=parameters or [],
+            extra_arguments=[{'use_intra_process_comms': True}] if intra_process else [])
+
+    container_cmd = ComposableNodeContainer(
+        condition=IfCondition(use_composition),
+        name='plansys_interface_container',
+        namespace=namespace,
+        package='rclcpp_components',
+        executable='component_container_mt',
+        output='screen',
+        parameters=[move_params, executor_params],
+        composable_node_descriptions=[
+            component('plansys_interface::MoveAction', 'move_action_node'),
+            component('plansys_interface::RotateAndDetectAction', 'rotate_and_detect_action_node'),
+            component('plansys_interface::PhotographMarkerAction', 'photograph_marker_action_node'),
+            component('plansys_interface::AlignAction', 'align_action_node'),
+            component('plansys_interface::FinishDetectionAction', 'finish_detection_action_node'),
+            component('plansys_interface::WorldNode', 'world_node',
+                      [{'landmark_store_path': landmark_store_path}], intra_process=True),
+            component('plansys_interface::LandmarkFusionNode', 'landmark_fusion_node',
+                      intra_process=True),
+        ])
 
     # Include aruco_tracker launch
     aruco_tracker_cmd = IncludeLaunchDescription(
@@ -201,18 +286,18 @@ def generate_launch_description():
     ld.add_action(declare_start_action_bt_file_cmd)
     ld.add_action(declare_end_action_bt_file_cmd)
     ld.add_action(declare_bt_builder_plugin_cmd)
+    ld.add_action(declare_landmark_store_path_cmd)
+    ld.add_action(declare_use_composition_cmd)
+    ld.add_action(declare_photograph_order_cmd)
+    ld.add_action(declare_event_driven_cmd)
     
     ld.add_action(domain_expert_cmd)
     ld.add_action(problem_expert_cmd)
     ld.add_action(planner_cmd)
     ld.add_action(executor_cmd)
     ld.add_action(lifecycle_manager_cmd)
-    ld.add_action(move_cmd)
-    ld.add_action(rotate_detect_cmd)
-    ld.add_action(photograph_cmd)
-    ld.add_action(align_cmd)
-    ld.add_action(finish_detection_cmd)
-    ld.add_action(world_cmd)
+    ld.add_action(separate_nodes_cmd)
+    ld.add_action(container_cmd)
     ld.add_action(aruco_tracker_cmd)
     
     return ld
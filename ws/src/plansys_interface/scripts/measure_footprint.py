@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""Report the footprint of the running plansys_interface nodes.
+
+Sums resident memory and CPU time of every process whose command line matches
+one of the patterns, over an idle window, and times how long it takes until
+all expected nodes show up in the ROS graph. Run it once with
+use_composition:=False and once with use_composition:=True, right after
+starting the launch file, to compare both deployments.
+"""
+
+import argparse
+import os
+import subprocess
+import time
+
+DEFAULT_PATTERNS = [
+    'plansys_interface_container', 'move_action_node_3', 'rotate_and_detect_action_node',
+    'photograph_marker_action_node', 'align_action_node', 'finish_detection_action_node',
+    'world_node', 'landmark_fusion_node',
+]
+# Launched on their own the executors are renamed by the launch file, inside the
+# container they keep their action name. Alternatives are separated by '|'.
+DEFAULT_NODES = ['/move_action_node|/move', '/rotate_and_detect_action_node|/rotateanddetect',
+                 '/photograph_marker_action_node|/photographmarker', '/align_action_node|/align',
+                 '/finish_detection_action_node|/finishdetection', '/world_node',
+                 '/landmark_fusion_node']
+
+
+def matching_pids(patterns):
+    pids = []
+    for entry in os.listdir('/proc'):
+        if not entry.isdigit() or int(entry) == os.getpid():
+            continue
+        try:
+            with open(f'/proc/{entry}/cmdline', 'rb') as f:
+                cmdline = f.read().replace(b'\0', b' ').decode(errors='replace')
+        except OSError:
+            continue
+        if any(p in cmdline for p in patterns) and 'measure_footprint' not in cmdline:
+            pids.append(int(entry))
+    return pids
+
+
+def rss_kib(pid):
+    with open(f'/proc/{pid}/status') as f:
+        for line in f:
+            if line.startswith('VmRSS:'):
+                return int(line.split()[1])
+    return 0
+
+
+def cpu_ticks(pid):
+    with open(f'/proc/{pid}/stat') as f:
+        # Fields after the command name, which may contain spaces
+        fields = f.read().rsplit(')', 1)[1].split()
+    return int(fields[11]) + int(fields[12])
+
+
+def discovery_time(nodes, timeout):
+    start = time.monotonic()
+    while time.monotonic() - start < timeout:
+        out = subprocess.run(['ros2', 'node', 'list'], capture_output=True, text=True).stdout
+        listed = set(out.split())
+        if all(any(alt in listed for alt in n.split('|')) for n in nodes):
+            return time.monotonic() - start
+        time.sleep(0.2)
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--pattern', action='append', help='command line substring to match')
+    parser.add_argument('--node', action='append', help='node expected in the graph')
+    parser.add_argument('--idle', type=float, default=10.0, help='idle window in seconds')
+    parser.add_argument('--timeout', type=float, default=60.0, help='discovery timeout')
+    args = parser.parse_args()
+
+    try:
+        found = discovery_time(args.node or DEFAULT_NODES, args.timeout)
+    except FileNotFoundError:
+        print('ros2 not found, source the ROS setup script first')
+        return 1
+    if found is None:
+        print(f'discovery: not all nodes seen after {args.timeout:.0f} s')
+    else:
+        print(f'discovery: {found:.2f} s')
+
+    pids = matching_pids(args.pattern or DEFAULT_PATTERNS)
+    if not pids:
+        print('no matching processes')
+        return 1
+
+    ticks_per_s = os.sysconf('SC_CLK_TCK')
+    before = {pid: cpu_ticks(pid) for pid in pids}
+    time.sleep(args.idle)
+    cpu = sum(cpu_ticks(pid) - before[pid] for pid in pids if os.path.exists(f'/proc/{pid}'))
+    rss = sum(rss_kib(pid) for pid in pids if os.path.exists(f'/proc/{pid}'))
+
+    print(f'processes: {len(pids)}')
+    print(f'resident memory: {rss / 1024.0:.1f} MiB')
+    print(f'idle cpu: {100.0 * cpu / ticks_per_s / args.idle:.1f} % of one core')
+    return 0
+
+
+if __name__ == '__main__':
+    raise SystemExit(main())
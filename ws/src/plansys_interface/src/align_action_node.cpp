@@ -1,147 +1,200 @@
-#include "plansys2_executor/ActionExecutorClient.hpp"
+#include "plansys_interface/event_driven_action.hpp"
 #include "rclcpp/rclcpp.hpp"
+#include "rclcpp_components/register_node_macro.hpp"
+#include "plansys_interface/component_startup.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
 #include "geometry_msgs/msg/twist.hpp"
+#include "nav_msgs/msg/odometry.hpp"
 #include "aruco_opencv_msgs/msg/aruco_detection.hpp"
+#include "plansys_interface/bearing_controller.hpp"
 #include <memory>
 #include <string>
 #include <algorithm>
 #include <cmath>
 #include <chrono>
-#include <mutex>
 
 using namespace std::chrono_literals;
 
-class AlignAction : public plansys2::ActionExecutorClient
+namespace plansys_interface
+{
+
+class AlignAction : public EventDrivenActionExecutor
 {
 public:
-  AlignAction()
-  : plansys2::ActionExecutorClient("align", 100ms),
-    alignment_active_(false),
-    aligned_(false),
-    center_tolerance_(0.03)
+  // plansys2::ActionExecutorClient takes no NodeOptions, parameters come from the
+  // process arguments
+  explicit AlignAction(const rclcpp::NodeOptions & = rclcpp::NodeOptions())
+  : EventDrivenActionExecutor("align", 100ms)
   {
+    plansys_interface::BearingControlConfig config;
+    config.kp = this->declare_parameter<double>("kp", config.kp);
+    config.max_speed = this->declare_parameter<double>("max_angular_speed", config.max_speed);
+    config.min_speed = this->declare_parameter<double>("min_angular_speed", config.min_speed);
+    config.max_accel = this->declare_parameter<double>("max_angular_accel", config.max_accel);
+    config.tolerance = this->declare_parameter<double>("center_tolerance", config.tolerance);
+    controller_ = plansys_interface::BearingController(config);
+
+    // Detections whose image is older than this (s) are ignored
+    max_detection_age_ = this->declare_parameter<double>("max_detection_age", 0.3);
+    align_timeout_ = this->declare_parameter<double>("align_timeout", 5.0);
+
     // Publisher for cmd_vel to rotate the robot
     cmd_vel_pub_ = this->create_publisher<geometry_msgs::msg::Twist>("/cmd_vel", 10);
-    
-    // Subscriber for marker detection
+
+    // Odometry is used to compensate for the age of each detection
+    odom_sub_ = this->create_subscription<nav_msgs::msg::Odometry>(
+      "/odom", 10,
+      std::bind(&AlignAction::odom_callback, this, std::placeholders::_1)
+    );
+
+    // Only the latest detection is of any use to the controller
     detection_sub_ = this->create_subscription<aruco_opencv_msgs::msg::ArucoDetection>(
-      "/aruco_detections", 10,
+      "/aruco_detections", rclcpp::QoS(1).best_effort(),
       std::bind(&AlignAction::detection_callback, this, std::placeholders::_1)
     );
-    
+
     RCLCPP_INFO(get_logger(), "AlignAction initialized");
+
+    startup_timer_ = start_action_executor(this, "align", true);
   }
 
 private:
+  void odom_callback(const nav_msgs::msg::Odometry::SharedPtr msg)
+  {
+    const auto & q = msg->pose.pose.orientation;
+    double yaw = std::atan2(2.0 * (q.w * q.z + q.x * q.y), 1.0 - 2.0 * (q.y * q.y + q.z * q.z));
+    auto lock = lock_state();
+    latest_odom_stamp_ = rclcpp::Time(msg->header.stamp);
+    has_odom_ = true;
+    controller_.on_yaw(latest_odom_stamp_.seconds(), yaw);
+
+    // Between detections the command follows the odometry-predicted bearing
+    if (running() && controller_.has_bearing() && detection_fresh()) {
+      publish_rotation(controller_.command(sensor_now().seconds()));
+    }
+  }
+
   void detection_callback(const aruco_opencv_msgs::msg::ArucoDetection::SharedPtr msg)
   {
-    std::lock_guard<std::mutex> lock(mutex_);
-    
-    if (!alignment_active_) return;
+    if (!running()) return;
     if (msg->markers.empty()) return;
-    
-    // Get the first marker's x position in camera frame
-    const auto& marker = msg->markers[0];
-    double marker_x = marker.pose.position.x;
-    
-    RCLCPP_DEBUG(get_logger(), "Align: marker x = %.4f", marker_x);
-    
-    // Check if marker is centered (within tolerance)
-    if (std::abs(marker_x) <= center_tolerance_) {
-      aligned_ = true;
-      RCLCPP_INFO(get_logger(), "Marker centered at x = %.4f", marker_x);
-      
-      // Stop rotating
-      geometry_msgs::msg::Twist stop_cmd;
-      cmd_vel_pub_->publish(stop_cmd);
-    } else {
-      // Rotate to center the marker
-      geometry_msgs::msg::Twist rotate_cmd;
-      rotate_cmd.linear.x = 0.0;
-      
-      // If marker is to the left (negative x), rotate left (positive angular.z)
-      // If marker is to the right (positive x), rotate right (negative angular.z)
-      if (marker_x < -center_tolerance_) {
-        rotate_cmd.angular.z = 0.3;  // Rotate left
-      } else if (marker_x > center_tolerance_) {
-        rotate_cmd.angular.z = -0.3; // Rotate right
-      }
-      
-      cmd_vel_pub_->publish(rotate_cmd);
+
+    auto lock = lock_state();
+    rclcpp::Time stamp(msg->header.stamp);
+    double age = has_odom_ ? (latest_odom_stamp_ - stamp).seconds() : 0.0;
+    if (age > max_detection_age_) {
+      RCLCPP_DEBUG(get_logger(), "Dropping detection %.3f s old", age);
+      return;
     }
+
+    // Camera optical frame: x to the right, z forward. Bearing is positive to the left.
+    auto bearing = [](const aruco_opencv_msgs::msg::MarkerPose & m) {
+        return -std::atan2(m.pose.position.x, m.pose.position.z);
+      };
+    // Keep aligning with the marker closest to the current heading
+    const auto & marker = *std::min_element(msg->markers.begin(), msg->markers.end(),
+        [&bearing](const auto & a, const auto & b) {
+          return std::abs(bearing(a)) < std::abs(bearing(b));
+        });
+
+    controller_.on_bearing(stamp.seconds(), bearing(marker));
+    last_detection_ = stamp;
+    RCLCPP_DEBUG(get_logger(), "Align: marker %d bearing %.4f rad, compensated %.4f rad",
+                 marker.marker_id, bearing(marker), controller_.error());
+
+    if (controller_.centred()) {
+      wake();
+      return;
+    }
+    publish_rotation(controller_.command(sensor_now().seconds()));
+  }
+
+  // Sensor stamps are compared with the latest odometry stamp rather than now(): under
+  // Gazebo they are in simulation time, whether or not use_sim_time is set for this node
+  rclcpp::Time sensor_now() const
+  {
+    return has_odom_ ? std::max(latest_odom_stamp_, last_detection_) : last_detection_;
+  }
+
+  bool detection_fresh()
+  {
+    return (sensor_now() - last_detection_).seconds() <= max_detection_age_;
+  }
+
+  void publish_rotation(double speed)
+  {
+    geometry_msgs::msg::Twist cmd;
+    cmd.angular.z = speed;
+    cmd_vel_pub_->publish(cmd);
   }
 
-  void do_work() override
+  void on_start() override
   {
     auto args = get_arguments();
-    
+
     // Expected: align ?r ?w
     if (args.size() < 3) {
       RCLCPP_ERROR(get_logger(), "Not enough arguments for align action");
-      finish(false, 0.0, "Insufficient arguments");
+      complete(false, 0.0, "Insufficient arguments");
       return;
     }
-    
+
     std::string waypoint = args[2];
     RCLCPP_INFO(get_logger(), "Aligning at waypoint [%s]", waypoint.c_str());
-    
-    if (!alignment_active_) {
-      alignment_active_ = true;
-      aligned_ = false;
-      alignment_start_time_ = this->now();
-    }
-    
-    // Check timeout (5 seconds)
+    controller_.reset();
+    alignment_start_time_ = this->now();
+    last_detection_ = has_odom_ ? latest_odom_stamp_ : rclcpp::Time(0, 0, RCL_ROS_TIME);
+  }
+
+  // Also runs when the action is cancelled
+  void on_stop() override
+  {
+    publish_rotation(0.0);
+  }
+
+  void step() override
+  {
     auto elapsed = (this->now() - alignment_start_time_).seconds();
-    
-    if (elapsed > 5.0) {
+
+    if (controller_.has_bearing() && controller_.centred()) {
+      RCLCPP_INFO(get_logger(), "Alignment complete in %.2f s (error %.4f rad)",
+                  elapsed, controller_.error());
+      complete(true, 1.0, "Aligned with marker");
+      return;
+    }
+
+    // Do not keep turning on a marker that went out of view
+    if (controller_.has_bearing() && !detection_fresh()) {
+      publish_rotation(0.0);
+    }
+
+    if (elapsed > align_timeout_) {
       RCLCPP_WARN(get_logger(), "Alignment timeout");
-      geometry_msgs::msg::Twist stop_cmd;
-      cmd_vel_pub_->publish(stop_cmd);
-      alignment_active_ = false;
-      
+
       // Still finish successfully if we timed out (might be close enough)
-      finish(true, 1.0, "Alignment timeout");
+      complete(true, 1.0, "Alignment timeout");
       return;
     }
-    
-    double progress = elapsed / 5.0;
-    send_feedback(progress, "Aligning with marker...");
-    
-    {
-      std::lock_guard<std::mutex> lock(mutex_);
-      if (aligned_) {
-        geometry_msgs::msg::Twist stop_cmd;
-        cmd_vel_pub_->publish(stop_cmd);
-        alignment_active_ = false;
-        aligned_ = false;
-        RCLCPP_INFO(get_logger(), "Alignment complete");
-        finish(true, 1.0, "Aligned with marker");
-      }
-    }
+
+    double progress = std::min(elapsed / align_timeout_, 1.0);
+    set_progress(progress, "Aligning with marker...");
   }
-  
-  bool alignment_active_;
-  bool aligned_;
-  double center_tolerance_;
+
+  double max_detection_age_;
+  double align_timeout_;
   rclcpp::Time alignment_start_time_;
-  
-  std::mutex mutex_;
-  
+  rclcpp::Time last_detection_{0, 0, RCL_ROS_TIME};
+  rclcpp::Time latest_odom_stamp_{0, 0, RCL_ROS_TIME};
+  bool has_odom_ = false;
+  plansys_interface::BearingController controller_;
+
   rclcpp::Publisher<geometry_msgs::msg::Twist>::SharedPtr cmd_vel_pub_;
+  rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
   rclcpp::Subscription<aruco_opencv_msgs::msg::ArucoDetection>::SharedPtr detection_sub_;
+
+  rclcpp::TimerBase::SharedPtr startup_timer_;
 };
 
-int main(int argc, char ** argv)
-{
-  rclcpp::init(argc, argv);
-  auto node = std::make_shared<AlignAction>();
-  node->set_parameter(rclcpp::Parameter("action_name", "align"));
-  node->trigger_transition(lifecycle_msgs::msg::Transition::TRANSITION_CONFIGURE);
-  node->trigger_transition(lifecycle_msgs::msg::Transition::TRANSITION_ACTIVATE);
-  rclcpp::spin(node->get_node_base_interface());
-  rclcpp::shutdown();
-  return 0;
-}
+}  // namespace plansys_interface
 
+RCLCPP_COMPONENTS_REGISTER_NODE(plansys_interface::AlignAction)
@@ -2,17 +2,26 @@
 
 #include "plansys2_executor/ActionExecutorClient.hpp"
 #include "rclcpp/rclcpp.hpp"
+#include "rclcpp_components/register_node_macro.hpp"
+#include "plansys_interface/component_startup.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
 
 using namespace std::chrono_literals;
 
+namespace plansys_interface
+{
+
 class AskCharge : public plansys2::ActionExecutorClient
 {
 public:
-  AskCharge()
+  // plansys2::ActionExecutorClient takes no NodeOptions, parameters come from the
+  // process arguments
+  explicit AskCharge(const rclcpp::NodeOptions & = rclcpp::NodeOptions())
   : plansys2::ActionExecutorClient("askcharge", 1s)
   {
     progress_ = 0.0;
+
+    startup_timer_ = start_action_executor(this, "askcharge", false);
   }
 
 private:
@@ -34,19 +43,10 @@ private:
   }
 
   float progress_;
-};
 
-int main(int argc, char ** argv)
-{
-  rclcpp::init(argc, argv);
-  auto node = std::make_shared<AskCharge>();
-
-  node->set_parameter(rclcpp::Parameter("action_name", "askcharge"));
-  node->trigger_transition(lifecycle_msgs::msg::Transition::TRANSITION_CONFIGURE);
-
-  rclcpp::spin(node->get_node_base_interface());
+  rclcpp::TimerBase::SharedPtr startup_timer_;
+};
 
-  rclcpp::shutdown();
+}  // namespace plansys_interface
 
-  return 0;
-}
+RCLCPP_COMPONENTS_REGISTER_NODE(plansys_interface::AskCharge)
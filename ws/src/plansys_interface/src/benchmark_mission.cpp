@@ -0,0 +1,98 @@
+#include "plansys_interface/mission_pddl.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Reports grounding size and time of the linear and n-ary mission encodings for
+// growing numbers of markers (one waypoint per marker). With --planner, the
+// command is also run on every generated linear mission and timed; "{domain}"
+// and "{problem}" in it are replaced by the file paths, e.g.
+//   benchmark_mission --planner "ros2 run popf popf {domain} {problem}"
+static std::string replace_all(std::string text, const std::string & from, const std::string & to)
+{
+  for (size_t pos = text.find(from); pos != std::string::npos; pos = text.find(from, pos)) {
+    text.replace(pos, from.size(), to);
+    pos += to.size();
+  }
+  return text;
+}
+
+int main(int argc, char ** argv)
+{
+  std::string planner;
+  std::string work_dir = "/tmp";
+  double time_limit = 10.0;
+  std::vector<size_t> sizes;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg == "--planner" && i + 1 < argc) {
+      planner = argv[++i];
+    } else if (arg == "--dir" && i + 1 < argc) {
+      work_dir = argv[++i];
+    } else if (arg == "--time-limit" && i + 1 < argc) {
+      time_limit = std::atof(argv[++i]);
+    } else if (std::strtoul(arg.c_str(), nullptr, 10) > 0) {
+      sizes.push_back(std::strtoul(arg.c_str(), nullptr, 10));
+    } else {
+      std::fprintf(stderr,
+        "Usage: %s [--planner CMD] [--dir DIR] [--time-limit S] [markers...]\n", argv[0]);
+      return 1;
+    }
+  }
+  if (sizes.empty()) {
+    sizes = {4, 5, 6, 7, 8, 10, 20, 50, 100, 200};
+  }
+
+  const size_t action_limit = 100000000;
+  bool nary_gave_up = false;
+  std::printf("%8s %14s %12s %16s %12s %12s\n", "markers", "linear acts", "ground (s)",
+    "n-ary acts", "ground (s)", "plan (s)");
+  for (size_t n : sizes) {
+    plansys_interface::MissionSpec spec;
+    spec.markers = n;
+    spec.waypoints = n;
+
+    auto linear_domain = plansys_interface::linear_mission_domain();
+    auto linear_problem = plansys_interface::mission_problem(spec, true);
+    auto linear = plansys_interface::ground(linear_domain, linear_problem, action_limit,
+      time_limit);
+    std::printf("%8zu %14zu %12.4f", n, linear.ground_actions, linear.seconds);
+
+    // Once the n-ary encoding hits the limits it only gets worse
+    if (nary_gave_up) {
+      std::printf(" %16s %12s", "-", "-");
+    } else {
+      auto nary = plansys_interface::ground(plansys_interface::nary_mission_domain(n),
+        plansys_interface::mission_problem(spec, false), action_limit, time_limit);
+      std::printf(" %15zu%s %12.4f", nary.ground_actions, nary.truncated ? "+" : " ",
+        nary.seconds);
+      nary_gave_up = nary.truncated;
+    }
+    std::fflush(stdout);
+
+    if (planner.empty()) {
+      std::printf(" %12s\n", "-");
+      continue;
+    }
+    const std::string domain_path = work_dir + "/mission_" + std::to_string(n) + "_domain.pddl";
+    const std::string problem_path = work_dir + "/mission_" + std::to_string(n) + "_problem.pddl";
+    std::ofstream(domain_path) << plansys_interface::to_pddl(linear_domain);
+    std::ofstream(problem_path) << plansys_interface::to_pddl(linear_problem, linear_domain.name);
+
+    std::string command = replace_all(replace_all(planner, "{domain}", domain_path),
+        "{problem}", problem_path) + " > /dev/null 2>&1";
+    auto start = std::chrono::steady_clock::now();
+    int status = std::system(command.c_str());
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (status == 0) {
+      std::printf(" %12.3f\n", seconds);
+    } else {
+      std::printf(" %12s\n", "failed");
+    }
+  }
+  std::printf("'+': stopped at %zu actions or %.0f s\n", action_limit, time_limit);
+  return 0;
+}
@@ -0,0 +1,57 @@
+#include "plansys_interface/path_cost_matrix.hpp"
+#include "plansys_interface/waypoint_registry.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+// Precomputes the waypoint path cost matrix for a map and stores it in the cache directory,
+// so nodes started with the same map and waypoints load it instead of searching the map.
+int main(int argc, char ** argv)
+{
+  if (argc < 3) {
+    std::fprintf(stderr,
+      "Usage: %s <waypoints.yaml> <map.yaml> [robot_radius=0.25] [cache_dir=.]\n", argv[0]);
+    return 1;
+  }
+
+  const std::string waypoints_file = argv[1];
+  const std::string map_file = argv[2];
+  const double robot_radius = argc > 3 ? std::atof(argv[3]) : 0.25;
+  const std::string cache_dir = argc > 4 ? argv[4] : ".";
+
+  plansys_interface::WaypointRegistry registry;
+  std::string err;
+  if (!registry.load_from_file(waypoints_file, err)) {
+    std::fprintf(stderr, "%s\n", err.c_str());
+    return 1;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  plansys_interface::PathCostMatrix costs;
+  bool from_cache;
+  if (!plansys_interface::load_or_compute_path_costs(
+      registry, map_file, robot_radius, cache_dir, costs, from_cache, err))
+  {
+    std::fprintf(stderr, "%s\n", err.c_str());
+    return 1;
+  }
+  double elapsed = std::chrono::duration<double, std::milli>(
+    std::chrono::steady_clock::now() - start).count();
+
+  std::printf("%zu waypoints, %s in %.1f ms\n", costs.size(),
+    from_cache ? "loaded from cache" : "computed", elapsed);
+  std::printf("%12s", "");
+  for (const auto & wp : registry.waypoints()) {
+    std::printf(" %10s", wp.name.c_str());
+  }
+  std::printf("\n");
+  for (size_t i = 0; i < costs.size(); ++i) {
+    std::printf("%12s", registry.at(i).name.c_str());
+    for (size_t j = 0; j < costs.size(); ++j) {
+      std::printf(" %10.2f", costs.cost(i, j));
+    }
+    std::printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,137 @@
+#include "plansys_interface/event_driven_action.hpp"
+
+#include <algorithm>
+
+namespace plansys_interface
+{
+
+EventDrivenActionExecutor::EventDrivenActionExecutor(
+  const std::string & action_name, std::chrono::nanoseconds tick_period)
+: plansys2::ActionExecutorClient(action_name, tick_period)
+{
+  event_driven_ = this->declare_parameter<bool>("event_driven", true);
+}
+
+EventDrivenActionExecutor::StateLock::StateLock(EventDrivenActionExecutor & owner)
+: owner_(owner)
+{
+  owner_.state_mutex_.lock();
+  ++owner_.lock_depth_;
+}
+
+EventDrivenActionExecutor::StateLock::~StateLock()
+{
+  std::optional<Completion> completion;
+  if (--owner_.lock_depth_ == 0) {
+    completion.swap(owner_.pending_completion_);
+  }
+  owner_.state_mutex_.unlock();
+
+  // A cancellation may have deactivated the node since complete()
+  if (completion && owner_.phase() == Phase::FINISHING) {
+    // Deactivates the node, which ends in on_deactivate and on_stop
+    owner_.finish(completion->success, completion->completion, completion->status);
+  }
+}
+
+EventDrivenActionExecutor::CallbackReturn
+EventDrivenActionExecutor::on_activate(const rclcpp_lifecycle::State & state)
+{
+  {
+    auto lock = lock_state();
+    started_ = false;
+    woken_ = false;
+    progress_ = 0.0f;
+    status_.clear();
+    pending_completion_.reset();
+    phase_ = Phase::RUNNING;
+  }
+  return plansys2::ActionExecutorClient::on_activate(state);
+}
+
+EventDrivenActionExecutor::CallbackReturn
+EventDrivenActionExecutor::on_deactivate(const rclcpp_lifecycle::State & state)
+{
+  {
+    auto lock = lock_state();
+    bool was_started = started_;
+    phase_ = Phase::IDLE;
+    started_ = false;
+    pending_completion_.reset();
+    if (was_started) {
+      on_stop();
+    }
+  }
+  return plansys2::ActionExecutorClient::on_deactivate(state);
+}
+
+void EventDrivenActionExecutor::wake()
+{
+  if (!running()) {
+    return;
+  }
+  auto lock = lock_state();
+  woken_ = true;
+  last_wake_ = std::chrono::steady_clock::now();
+  if (event_driven_) {
+    run_step();
+  }
+}
+
+void EventDrivenActionExecutor::do_work()
+{
+  auto lock = lock_state();
+  run_step();
+  if (running()) {
+    send_feedback(progress_, status_);
+  }
+}
+
+void EventDrivenActionExecutor::run_step()
+{
+  if (!running()) {
+    return;
+  }
+  if (!started_) {
+    started_ = true;
+    on_start();
+    if (!running()) {
+      return;
+    }
+  }
+  step();
+}
+
+void EventDrivenActionExecutor::set_progress(float completion, const std::string & status)
+{
+  auto lock = lock_state();
+  progress_ = completion;
+  status_ = status;
+}
+
+void EventDrivenActionExecutor::complete(
+  bool success, float completion, const std::string & status)
+{
+  auto lock = lock_state();
+  Phase expected = Phase::RUNNING;
+  if (!phase_.compare_exchange_strong(expected, Phase::FINISHING)) {
+    return;
+  }
+
+  if (woken_) {
+    double reaction_ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - last_wake_).count();
+    ++completions_;
+    total_reaction_ms_ += reaction_ms;
+    max_reaction_ms_ = std::max(max_reaction_ms_, reaction_ms);
+    RCLCPP_INFO(get_logger(), "Reaction time %.1f ms (%s; mean %.1f ms, max %.1f ms over %lu)",
+                reaction_ms, event_driven_ ? "event-driven" : "polling",
+                total_reaction_ms_ / completions_, max_reaction_ms_,
+                static_cast<unsigned long>(completions_));
+  }
+
+  // Run by the outermost StateLock once it is released
+  pending_completion_ = Completion{success, completion, status};
+}
+
+}  // namespace plansys_interface
@@ -0,0 +1,164 @@
+#include "plansys_interface/execution_monitor.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace plansys_interface
+{
+
+void ExecutionMonitor::reset(size_t planned_actions)
+{
+  planned_ = planned_actions;
+  pending_ = planned_actions;
+  running_ = 0;
+  succeeded_ = 0;
+  failed_ = 0;
+  records_.clear();
+  archive_.clear();
+  dropped_.clear();
+}
+
+void ExecutionMonitor::replan(size_t planned_actions, double stamp)
+{
+  // Finished actions move to the archive, so that the new plan may reuse their names
+  for (auto & entry : records_) {
+    if (entry.second.state == ActionState::SUCCEEDED || entry.second.state == ActionState::FAILED) {
+      archive_.push_back(std::move(entry));
+    } else {
+      dropped_[entry.first] = stamp;
+    }
+  }
+  records_.clear();
+  planned_ = succeeded_ + failed_ + planned_actions;
+  pending_ = planned_actions;
+  running_ = 0;
+}
+
+bool ExecutionMonitor::update(
+  const std::string & full_name, const std::string & action, ActionState state,
+  double start, double stamp)
+{
+  // A new plan restarts at time 0, so a re-issued action gets the name of the
+  // dropped one. Updates belong to the old plan if the action started before
+  // the replan, or if they cancel an action that never started.
+  auto dropped = dropped_.find(full_name);
+  if (dropped != dropped_.end()) {
+    bool started = start > 0.0;
+    if ((started && start < dropped->second) || (!started && state == ActionState::FAILED)) {
+      return false;
+    }
+  }
+
+  auto inserted = records_.emplace(full_name, ActionRecord());
+  ActionRecord & record = inserted.first->second;
+  if (inserted.second) {
+    record.action = action;
+    // Actions missing from the plan given to reset() are counted as they show up
+    if (pending_ == 0) {
+      ++planned_;
+      ++pending_;
+    }
+  } else if (record.state == state) {
+    return false;
+  }
+
+  // Finished actions stay finished, late or reordered messages are ignored
+  if (record.state == ActionState::SUCCEEDED || record.state == ActionState::FAILED) {
+    return false;
+  }
+
+  --counter(record.state);
+  ++counter(state);
+  record.state = state;
+  if (state != ActionState::PENDING) {
+    record.start = start;
+    record.end = stamp;
+  }
+  return inserted.second || state != ActionState::PENDING;
+}
+
+size_t & ExecutionMonitor::counter(ActionState state)
+{
+  switch (state) {
+    case ActionState::RUNNING: return running_;
+    case ActionState::SUCCEEDED: return succeeded_;
+    case ActionState::FAILED: return failed_;
+    default: return pending_;
+  }
+}
+
+const ActionRecord * ExecutionMonitor::find(const std::string & full_name) const
+{
+  auto it = records_.find(full_name);
+  return it == records_.end() ? nullptr : &it->second;
+}
+
+ExecutionSummary ExecutionMonitor::summary() const
+{
+  ExecutionSummary summary;
+  summary.planned = planned_;
+  summary.succeeded = succeeded_;
+  summary.failed = failed_;
+  summary.success = failed_ == 0 && succeeded_ >= planned_;
+
+  std::map<std::string, ActionTypeStats> by_action;
+  double first_start = std::numeric_limits<double>::max();
+  double last_end = std::numeric_limits<double>::lowest();
+  auto add = [&](const std::string & name, const ActionRecord & record) {
+      if (record.state != ActionState::SUCCEEDED && record.state != ActionState::FAILED) {
+        return;
+      }
+      double duration = record.duration();
+      first_start = std::min(first_start, record.start);
+      last_end = std::max(last_end, record.end);
+
+      ActionTypeStats & stats = by_action[record.action];
+      if (stats.succeeded + stats.failed == 0) {
+        stats.action = record.action;
+        stats.min_duration = duration;
+        stats.max_duration = duration;
+      }
+      (record.state == ActionState::SUCCEEDED ? stats.succeeded : stats.failed)++;
+      stats.total_duration += duration;
+      stats.min_duration = std::min(stats.min_duration, duration);
+      stats.max_duration = std::max(stats.max_duration, duration);
+
+      if (duration > summary.slowest_duration) {
+        summary.slowest_duration = duration;
+        summary.slowest_action = name;
+      }
+    };
+  for (const auto & entry : records_) {
+    add(entry.first, entry.second);
+  }
+  for (const auto & entry : archive_) {
+    add(entry.first, entry.second);
+  }
+
+  if (last_end >= first_start) {
+    summary.plan_duration = last_end - first_start;
+  }
+  for (auto & entry : by_action) {
+    summary.stats.push_back(entry.second);
+  }
+  // Where the mission time went, largest share first
+  std::sort(summary.stats.begin(), summary.stats.end(),
+    [](const ActionTypeStats & a, const ActionTypeStats & b) {
+      return a.total_duration > b.total_duration;
+    });
+  return summary;
+}
+
+const char * to_string(ActionState state)
+{
+  switch (state) {
+    case ActionState::PENDING: return "PENDING";
+    case ActionState::RUNNING: return "RUNNING";
+    case ActionState::SUCCEEDED: return "SUCCEEDED";
+    case ActionState::FAILED: return "FAILED";
+  }
+  return "UNKNOWN";
+}
+
+}  // namespace plansys_interface
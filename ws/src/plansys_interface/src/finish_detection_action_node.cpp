@@ -1,14 +1,22 @@
 #include "plansys2_executor/ActionExecutorClient.hpp"
 #include "rclcpp/rclcpp.hpp"
+#include "rclcpp_components/register_node_macro.hpp"
+#include "plansys_interface/component_startup.hpp"
 
 using namespace std::chrono_literals;
 
+namespace plansys_interface
+{
+
 class FinishDetectionAction : public plansys2::ActionExecutorClient
 {
 public:
-  FinishDetectionAction()
+  // plansys2::ActionExecutorClient takes no NodeOptions, parameters come from the
+  // process arguments
+  explicit FinishDetectionAction(const rclcpp::NodeOptions & = rclcpp::NodeOptions())
   : plansys2::ActionExecutorClient("finishdetection", 100ms)
   {
+    startup_timer_ = start_action_executor(this, "finishdetection", false);
   }
 
 private:
@@ -23,20 +31,10 @@ private:
     // Finish with success (true), 100% progress, and completion message
     finish(true, 1.0, "Detection phase completed");
   }
-};
-
-int main(int argc, char ** argv)
-{
-  rclcpp::init(argc, argv);
-  auto node = std::make_shared<FinishDetectionAction>();
-
-  node->set_parameter(rclcpp::Parameter("action_name", "finishdetection"));
-  node->trigger_transition(lifecycle_msgs::msg::Transition::TRANSITION_CONFIGURE);
 
-  rclcpp::spin(node->get_node_base_interface());
-
-  rclcpp::shutdown();
+  rclcpp::TimerBase::SharedPtr startup_timer_;
+};
 
-  return 0;
-}
+}  // namespace plansys_interface
 
+RCLCPP_COMPONENTS_REGISTER_NODE(plansys_interface::FinishDetectionAction)
@@ -0,0 +1,51 @@
+#include "plansys_interface/mission_pddl.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+// Writes domain.pddl and problem.pddl for a mission with any number of markers and
+// waypoints. The default encoding grounds linearly, --nary writes the original one.
+int main(int argc, char ** argv)
+{
+  if (argc < 4) {
+    std::fprintf(stderr, "Usage: %s <markers> <waypoints> <output_dir> [--nary]\n", argv[0]);
+    return 1;
+  }
+
+  plansys_interface::MissionSpec spec;
+  spec.markers = std::strtoul(argv[1], nullptr, 10);
+  spec.waypoints = std::strtoul(argv[2], nullptr, 10);
+  const std::string out_dir = argv[3];
+  const bool nary = argc > 4 && std::string(argv[4]) == "--nary";
+  if (spec.markers == 0 || spec.waypoints == 0) {
+    std::fprintf(stderr, "markers and waypoints must be positive\n");
+    return 1;
+  }
+
+  auto domain = nary ? plansys_interface::nary_mission_domain(spec.markers) :
+    plansys_interface::linear_mission_domain();
+  auto problem = plansys_interface::mission_problem(spec, !nary);
+
+  std::error_code ec;
+  std::filesystem::create_directories(out_dir, ec);
+  if (ec) {
+    std::fprintf(stderr, "Failed to create %s: %s\n", out_dir.c_str(), ec.message().c_str());
+    return 1;
+  }
+
+  const std::string domain_path = out_dir + "/domain.pddl";
+  const std::string problem_path = out_dir + "/problem.pddl";
+  std::ofstream(domain_path) << plansys_interface::to_pddl(domain);
+  std::ofstream problem_file(problem_path);
+  problem_file << plansys_interface::to_pddl(problem, domain.name);
+  if (!problem_file) {
+    std::fprintf(stderr, "Failed to write %s\n", problem_path.c_str());
+    return 1;
+  }
+
+  std::printf("%zu markers, %zu waypoints (%s encoding): %s, %s\n", spec.markers,
+    spec.waypoints, nary ? "n-ary" : "linear", domain_path.c_str(), problem_path.c_str());
+  return 0;
+}
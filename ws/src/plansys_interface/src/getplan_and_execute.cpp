@@ -3,15 +3,35 @@
 #include "plansys2_pddl_parser/Utils.hpp"
 #include "plansys2_msgs/msg/action_execution_info.hpp"
 #include "plansys2_msgs/msg/plan.hpp"
+#include "plansys2_msgs/srv/get_plan.hpp"
 #include "plansys2_domain_expert/DomainExpertClient.hpp"
 #include "plansys2_planner/PlannerClient.hpp"
 #include "plansys2_problem_expert/ProblemExpertClient.hpp"
 #include "plansys2_executor/ExecutorClient.hpp"
+#include "plansys2_interface/msg/detected_markers.hpp"
+#include "plansys2_interface/msg/detected_markers_delta.hpp"
+#include "plansys2_interface/msg/plan_execution_summary.hpp"
+#include "plansys_interface/execution_monitor.hpp"
+#include "plansys_interface/plan_cache.hpp"
+#include "plansys_interface/tour_optimizer.hpp"
+#include "plansys_interface/waypoint_registry.hpp"
 
 
 #include "rclcpp/rclcpp.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <optional>
 #include <ostream>
+#include <set>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+using namespace std::chrono_literals;
 
 std::ostream& operator<<(std::ostream& os, const plansys2_msgs::msg::Plan & plan)
 {
@@ -50,75 +70,478 @@ public:
     action_feedback_sub_ = this->create_subscription<plansys2_msgs::msg::ActionExecutionInfo>(
         "/action_execution_info", 10,
         std::bind(&Controller::action_feedback_callback, this, std::placeholders::_1));
+
+    // Published once per plan with the per-action timing statistics
+    summary_pub_ = this->create_publisher<plansys2_interface::msg::PlanExecutionSummary>(
+        "/plan_execution_summary", rclcpp::QoS(1).reliable().transient_local());
+
+    // With a waypoint file and a map, the detection waypoints are chained in the cheapest order
+    waypoints_file_ = this->declare_parameter<std::string>("waypoints_file", "");
+    map_file_ = this->declare_parameter<std::string>("map_file", "");
+    robot_radius_ = this->declare_parameter<double>("robot_radius", 0.25);
+    cache_dir_ = this->declare_parameter<std::string>("path_cost_cache_dir", "");
+
+    // Plans are reused for identical domain and problem text, kept on disk when a directory is set
+    plan_cache_ = std::make_unique<plansys_interface::PlanCache>(
+      this->declare_parameter<std::string>("plan_cache_dir", ""));
+
+    // GetPlan services of planner nodes running different solvers. When set, all of them
+    // are asked at once and the first plan wins, instead of using the default planner.
+    planner_services_ = this->declare_parameter<std::vector<std::string>>(
+      "planner_services", std::vector<std::string>());
+    planning_timeout_ = this->declare_parameter<double>("planning_timeout", 15.0);
+    // The portfolio clients live on their own node so they can be waited on from callbacks
+    portfolio_node_ = rclcpp::Node::make_shared("planner_portfolio_client");
+    for (const auto & service : planner_services_) {
+      portfolio_clients_.push_back(
+        portfolio_node_->create_client<plansys2_msgs::srv::GetPlan>(service));
+    }
+
+    // Markers learnt by the world node are pushed into the problem in batches, and the rest
+    // of the plan is replanned when they change it
+    replan_on_updates_ = this->declare_parameter<bool>("replan_on_marker_updates", true);
+    auto batch_period = this->declare_parameter<double>("fact_batch_period", 0.5);
+    markers_snapshot_sub_ = this->create_subscription<plansys2_interface::msg::DetectedMarkers>(
+        "/world_node/detected_markers", rclcpp::QoS(1).reliable().transient_local(),
+        std::bind(&Controller::markers_snapshot_callback, this, std::placeholders::_1));
+    marker_updates_sub_ = this->create_subscription<plansys2_interface::msg::DetectedMarkersDelta>(
+        "/world_node/marker_updates", rclcpp::QoS(100).reliable(),
+        std::bind(&Controller::marker_updates_callback, this, std::placeholders::_1));
+    fact_batch_timer_ = this->create_wall_timer(
+        std::chrono::duration<double>(batch_period),
+        std::bind(&Controller::flush_marker_facts, this));
+  }
+
+  // Replaces the connected facts between the start and the detection waypoints
+  // with a chain following the cheapest tour on the map
+  void optimise_detection_tour()
+  {
+    if (waypoints_file_.empty() || map_file_.empty()) {
+      return;
+    }
+
+    plansys_interface::WaypointRegistry registry;
+    plansys_interface::PathCostMatrix costs;
+    std::string err;
+    bool from_cache;
+    if (!registry.load_from_file(waypoints_file_, err) ||
+      !plansys_interface::load_or_compute_path_costs(
+        registry, map_file_, robot_radius_, cache_dir_, costs, from_cache, err))
+    {
+      std::cout << "Keeping the problem's waypoint order: " << err << std::endl;
+      return;
+    }
+
+    std::string start;
+    std::set<std::string> stop_names;
+    std::vector<plansys2::Predicate> connections;
+    for (const auto & pred : problem_expert_->getPredicates()) {
+      if (pred.name == "at" && pred.parameters.size() == 2) {
+        start = pred.parameters[1].name;
+      } else if (pred.name == "marker-visible-at" && pred.parameters.size() == 2) {
+        stop_names.insert(pred.parameters[1].name);
+      } else if (pred.name == "connected") {
+        connections.push_back(pred);
+      }
+    }
+
+    size_t start_idx = registry.index_of(start);
+    std::vector<size_t> stops;
+    for (const auto & name : stop_names) {
+      stops.push_back(registry.index_of(name));
+    }
+    if (start_idx == plansys_interface::WaypointRegistry::npos ||
+      std::count(stops.begin(), stops.end(), plansys_interface::WaypointRegistry::npos) > 0)
+    {
+      std::cout << "Detection waypoints missing from " << waypoints_file_ <<
+        ", keeping the problem's waypoint order" << std::endl;
+      return;
+    }
+
+    std::vector<size_t> order;
+    if (!plansys_interface::optimise_tour(costs, start_idx, stops, order, err)) {
+      std::cout << "Keeping the problem's waypoint order: " << err << std::endl;
+      return;
+    }
+
+    stop_names.insert(start);
+    for (const auto & pred : connections) {
+      if (pred.parameters.size() == 2 &&
+        stop_names.count(pred.parameters[0].name) && stop_names.count(pred.parameters[1].name))
+      {
+        problem_expert_->removePredicate(pred);
+      }
+    }
+    std::string prev = start;
+    std::cout << "Detection tour: " << start;
+    for (size_t idx : order) {
+      const auto & next = registry.at(idx).name;
+      problem_expert_->addPredicate(plansys2::Predicate("(connected " + prev + " " + next + ")"));
+      problem_expert_->addPredicate(plansys2::Predicate("(connected " + next + " " + prev + ")"));
+      std::cout << " -> " << next;
+      prev = next;
+    }
+    std::cout << " (" << plansys_interface::tour_cost(costs, start_idx, order) << " m)" <<
+      std::endl;
   }
 
   void plan()
   {
+    plansys2_msgs::msg::Plan plan;
+    if (!get_plan(plan)) {
+      return;
+    }
+    std::cout << plan << std::endl;
+    monitor_.reset(plan.items.size());
+    current_plan_ = plan;
+    executor_client_->start_plan_execution(plan);
+  }
 
-          auto domain = domain_expert_->getDomain();
-          auto problem = problem_expert_->getProblem();
-          auto plan = planner_client_->getPlan(domain, problem);
+private:
+  // Plans from the current state of the problem expert, which already holds the
+  // effects of the executed actions
+  bool get_plan(plansys2_msgs::msg::Plan & plan)
+  {
+    auto planning_start = std::chrono::steady_clock::now();
+    auto domain = domain_expert_->getDomain();
+    auto problem = problem_expert_->getProblem();
 
-          if (!plan.has_value()) {
-            std::cout << "Could not find plan to reach goal " <<
-              parser::pddl::toString(problem_expert_->getGoal()) << std::endl;
-          }
+    // Repeated missions on the same site produce the same problem text
+    std::string source = "cache";
+    if (!plan_cache_->lookup(domain, problem, plan)) {
+      std::optional<plansys2_msgs::msg::Plan> result;
+      if (portfolio_clients_.empty()) {
+        source = "planner";
+        result = planner_client_->getPlan(domain, problem);
+      } else {
+        result = plan_with_portfolio(domain, problem, source);
+      }
 
-          else{
-          std::cout << plan.value() << std::endl;
-          executor_client_->start_plan_execution(plan.value());
-        }
-      
+      if (!result.has_value()) {
+        std::cout << "Could not find plan to reach goal " <<
+          parser::pddl::toString(problem_expert_->getGoal()) << std::endl;
+        return false;
+      }
+      plan = result.value();
+
+      std::string err;
+      if (!plan_cache_->store(domain, problem, plan, err)) {
+        RCLCPP_WARN(get_logger(), "%s", err.c_str());
+      }
+    }
+
+    double elapsed = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - planning_start).count();
+    planning_time_ += elapsed;
+    RCLCPP_INFO(get_logger(), "Plan of %zu actions from %s in %.3f s",
+      plan.items.size(), source.c_str(), elapsed);
+    return true;
+  }
+
+  void markers_snapshot_callback(const plansys2_interface::msg::DetectedMarkers::SharedPtr msg)
+  {
+    if (msg->revision <= marker_revision_) {
+      return;
+    }
+    marker_revision_ = msg->revision;
+    for (const auto & marker : msg->markers) {
+      pending_markers_[marker.marker_id] = marker.wp;
+    }
+  }
 
+  void marker_updates_callback(const plansys2_interface::msg::DetectedMarkersDelta::SharedPtr msg)
+  {
+    // Deltas already covered by the snapshot are skipped
+    if (msg->revision <= marker_revision_) {
+      return;
+    }
+    marker_revision_ = msg->revision;
+    for (const auto & marker : msg->upserted) {
+      pending_markers_[marker.marker_id] = marker.wp;
+    }
   }
 
+  // Turns the markers received since the last batch into facts: the marker object the
+  // problem expects at that waypoint (or a new one) is visible there and detected
+  void flush_marker_facts()
+  {
+    if (pending_markers_.empty() || plan_finished_) {
+      return;
+    }
 
+    std::map<std::string, std::string> marker_at_wp;
+    std::set<std::string> facts;
+    for (const auto & pred : problem_expert_->getPredicates()) {
+      if (pred.name == "marker-visible-at" && pred.parameters.size() == 2) {
+        marker_at_wp[pred.parameters[1].name] = pred.parameters[0].name;
+      }
+      std::string fact = "(" + pred.name;
+      for (const auto & param : pred.parameters) {
+        fact += " " + param.name;
+      }
+      facts.insert(fact + ")");
+    }
 
-private:
+    bool changed = false;
+    for (const auto & marker : pending_markers_) {
+      const std::string & wp = marker.second;
+      std::string object;
+      auto it = marker_at_wp.find(wp);
+      if (it != marker_at_wp.end()) {
+        object = it->second;
+      } else {
+        object = "marker" + std::to_string(marker.first);
+        problem_expert_->addInstance(plansys2::Instance(object, "marker"));
+        changed |= add_fact("(marker-visible-at " + object + " " + wp + ")", facts);
+      }
+      changed |= add_fact("(marker-detected " + object + ")", facts);
+    }
+    pending_markers_.clear();
 
-void action_feedback_callback(const plansys2_msgs::msg::ActionExecutionInfo::SharedPtr msg)
-{
-    if(msg->action_full_name !=":0"){
-    action_completion_map_[msg->action_full_name] = msg->completion;
-    std::cout << "Action: " << msg->action_full_name
-              << " | Completion: " << (msg->completion * 100.0) << "%"
-              << " | Status: ";
-    switch(msg->status) {
-        case plansys2_msgs::msg::ActionExecutionInfo::NOT_EXECUTED:
-            std::cout << "NOT_EXECUTED"; break;
-        case plansys2_msgs::msg::ActionExecutionInfo::EXECUTING:
-            std::cout << "EXECUTING"; break;
-        case plansys2_msgs::msg::ActionExecutionInfo::SUCCEEDED:
-            std::cout << "SUCCEEDED"; break;
-        case plansys2_msgs::msg::ActionExecutionInfo::FAILED:
-            std::cout << "FAILED"; break;
-        case plansys2_msgs::msg::ActionExecutionInfo::CANCELLED:
-            std::cout << "CANCELLED"; break;
-        default:
-            std::cout << "UNKNOWN"; break;
-    }
-    std::cout << std::endl;
+    if (changed && replan_on_updates_ && !current_plan_.items.empty()) {
+      replan_remaining();
+    }
   }
 
-    bool all_done = true;
-    for (auto & a : action_completion_map_) {
-        if (a.second < 1.0) {
-            all_done = false;
-            break;
+  bool add_fact(const std::string & fact, std::set<std::string> & facts)
+  {
+    if (!facts.insert(fact).second) {
+      return false;
+    }
+    problem_expert_->addPredicate(plansys2::Predicate(fact));
+    return true;
+  }
+
+  // Plans again from the current state and switches to the new plan only if it
+  // differs from what is left of the running one
+  void replan_remaining()
+  {
+    auto remaining = executor_client_->getRemainingPlan();
+    if (!remaining.has_value() || remaining.value().items.empty()) {
+      return;
+    }
+
+    plansys2_msgs::msg::Plan plan;
+    if (!get_plan(plan)) {
+      RCLCPP_WARN(get_logger(), "Replanning failed, keeping the current plan");
+      return;
+    }
+
+    const auto & old_items = remaining.value().items;
+    bool same = plan.items.size() == old_items.size() &&
+      std::equal(plan.items.begin(), plan.items.end(), old_items.begin(),
+        [](const auto & a, const auto & b) {return a.action == b.action;});
+    if (same) {
+      RCLCPP_INFO(get_logger(), "Marker updates leave the remaining %zu actions valid",
+        old_items.size());
+      return;
+    }
+
+    RCLCPP_INFO(get_logger(), "Replanned the remaining %zu actions into %zu",
+      old_items.size(), plan.items.size());
+    std::cout << plan << std::endl;
+    executor_client_->cancel_plan_execution();
+    monitor_.replan(plan.items.size(), now().seconds());
+    current_plan_ = plan;
+    executor_client_->start_plan_execution(plan);
+  }
+
+  // Sends the problem to every planner of the portfolio at once and keeps the
+  // first valid plan. Planners that have not answered by then are abandoned.
+  // The whole call, including waiting for planners to come up, is bounded by
+  // planning_timeout.
+  std::optional<plansys2_msgs::msg::Plan> plan_with_portfolio(
+    const std::string & domain, const std::string & problem, std::string & winner)
+  {
+    using GetPlan = plansys2_msgs::srv::GetPlan;
+
+    auto deadline = std::chrono::steady_clock::now() +
+      std::chrono::duration<double>(planning_timeout_);
+
+    auto request = std::make_shared<GetPlan::Request>();
+    request->domain = domain;
+    request->problem = problem;
+
+    // Planners not discovered yet get the request as soon as they show up
+    std::vector<size_t> unsent;
+    for (size_t i = 0; i < portfolio_clients_.size(); ++i) {
+      unsent.push_back(i);
+    }
+    std::vector<std::pair<size_t, rclcpp::Client<GetPlan>::FutureAndRequestId>> pending;
+    auto send_to_ready = [&]() {
+        for (auto it = unsent.begin(); it != unsent.end(); ) {
+          if (!portfolio_clients_[*it]->service_is_ready()) {
+            ++it;
+            continue;
+          }
+          pending.emplace_back(*it, portfolio_clients_[*it]->async_send_request(request));
+          it = unsent.erase(it);
+        }
+      };
+    send_to_ready();
+
+    rclcpp::executors::SingleThreadedExecutor executor;
+    executor.add_node(portfolio_node_);
+
+    std::optional<plansys2_msgs::msg::Plan> plan;
+    while (!plan.has_value() && (!pending.empty() || !unsent.empty()) &&
+      std::chrono::steady_clock::now() < deadline)
+    {
+      executor.spin_once(10ms);
+      send_to_ready();
+      for (auto it = pending.begin(); it != pending.end(); ) {
+        if (it->second.wait_for(0s) != std::future_status::ready) {
+          ++it;
+          continue;
+        }
+        auto response = it->second.get();
+        if (response->success) {
+          plan = response->plan;
+          winner = planner_services_[it->first];
+          pending.erase(it);
+          break;
         }
+        RCLCPP_WARN(get_logger(), "Planner %s failed: %s",
+          planner_services_[it->first].c_str(), response->error_info.c_str());
+        it = pending.erase(it);
+      }
+    }
+    executor.remove_node(portfolio_node_);
+
+    // A service call cannot be stopped on the server side, late answers are dropped here
+    for (auto & call : pending) {
+      portfolio_clients_[call.first]->remove_pending_request(call.second);
+    }
+    for (size_t i : unsent) {
+      RCLCPP_WARN(get_logger(), "Planner %s not available", planner_services_[i].c_str());
+    }
+    if (!plan.has_value() && std::chrono::steady_clock::now() >= deadline) {
+      RCLCPP_WARN(get_logger(), "No plan from the portfolio within %.1f s", planning_timeout_);
+    }
+    return plan;
+  }
+
+void action_feedback_callback(const plansys2_msgs::msg::ActionExecutionInfo::SharedPtr msg)
+{
+    using plansys2_msgs::msg::ActionExecutionInfo;
+    using plansys_interface::ActionState;
+
+    if (msg->action_full_name == ":0" || plan_finished_) {
+      return;
+    }
+
+    ActionState state;
+    switch (msg->status) {
+      case ActionExecutionInfo::EXECUTING: state = ActionState::RUNNING; break;
+      case ActionExecutionInfo::SUCCEEDED: state = ActionState::SUCCEEDED; break;
+      case ActionExecutionInfo::FAILED:
+      case ActionExecutionInfo::CANCELLED: state = ActionState::FAILED; break;
+      default: state = ActionState::PENDING; break;
+    }
+
+    RCLCPP_DEBUG(get_logger(), "Action %s at %.0f%%",
+      msg->action_full_name.c_str(), msg->completion * 100.0);
+
+    // Only state changes are logged, progress updates are frequent
+    if (!monitor_.update(msg->action_full_name, msg->action, state,
+      rclcpp::Time(msg->start_stamp).seconds(), rclcpp::Time(msg->status_stamp).seconds()))
+    {
+      return;
+    }
+    const auto * record = monitor_.find(msg->action_full_name);
+    if (state == ActionState::RUNNING) {
+      RCLCPP_INFO(get_logger(), "[%zu/%zu done] %s started", monitor_.succeeded(),
+        monitor_.planned(),
+        msg->action_full_name.c_str());
+    } else if (state != ActionState::PENDING) {
+      RCLCPP_INFO(get_logger(), "[%zu/%zu done] %s %s after %.2f s", monitor_.succeeded(),
+        monitor_.planned(),
+        msg->action_full_name.c_str(), plansys_interface::to_string(state), record->duration());
     }
 
-    if (all_done) {
-        std::cout << "Everything done!!" << std::endl;
-        rclcpp::shutdown();
+    if (monitor_.finished()) {
+      plan_finished_ = true;
+      publish_summary();
+      if (monitor_.failed() == 0) {
+        // Give the latched summary time to reach subscribers before exiting
+        shutdown_timer_ = this->create_wall_timer(500ms, []() {rclcpp::shutdown();});
+      }
+    }
+}
+
+void publish_summary()
+{
+    auto summary = monitor_.summary();
+
+    plansys2_interface::msg::PlanExecutionSummary msg;
+    msg.success = summary.success;
+    msg.plan_duration = summary.plan_duration;
+    msg.planning_time = planning_time_;
+    msg.actions_planned = summary.planned;
+    msg.actions_succeeded = summary.succeeded;
+    msg.actions_failed = summary.failed;
+    msg.slowest_action = summary.slowest_action;
+    msg.slowest_duration = summary.slowest_duration;
+
+    std::ostringstream table;
+    table << (summary.success ? "Everything done!!" : "Plan failed") <<
+      " " << summary.succeeded << "/" << summary.planned << " actions in " <<
+      std::fixed << std::setprecision(1) << summary.plan_duration << " s (planned in " <<
+      std::setprecision(2) << planning_time_ << std::setprecision(1) << " s)\n";
+    for (const auto & stats : summary.stats) {
+      plansys2_interface::msg::ActionStats action;
+      action.action = stats.action;
+      action.succeeded = stats.succeeded;
+      action.failed = stats.failed;
+      action.total_duration = stats.total_duration;
+      action.mean_duration = stats.mean_duration();
+      action.min_duration = stats.min_duration;
+      action.max_duration = stats.max_duration;
+      msg.stats.push_back(action);
+
+      double share = summary.plan_duration > 0.0 ?
+        100.0 * stats.total_duration / summary.plan_duration : 0.0;
+      table << "  " << std::left << std::setw(18) << stats.action << std::right <<
+        " n=" << std::setw(3) << stats.succeeded + stats.failed <<
+        " total " << std::setw(7) << stats.total_duration << " s (" <<
+        std::setw(3) << std::setprecision(0) << share << std::setprecision(1) << "%)" <<
+        " mean " << std::setw(6) << stats.mean_duration() <<
+        " min " << std::setw(6) << stats.min_duration <<
+        " max " << std::setw(6) << stats.max_duration << "\n";
     }
+    table << "  slowest: " << summary.slowest_action << " (" << summary.slowest_duration << " s)";
+
+    summary_pub_->publish(msg);
+    RCLCPP_INFO(get_logger(), "%s", table.str().c_str());
 }
+
   std::shared_ptr<plansys2::DomainExpertClient> domain_expert_;
   std::shared_ptr<plansys2::PlannerClient> planner_client_;
   std::shared_ptr<plansys2::ProblemExpertClient> problem_expert_;
   std::shared_ptr<plansys2::ExecutorClient> executor_client_;
   rclcpp::Subscription<plansys2_msgs::msg::ActionExecutionInfo>::SharedPtr action_feedback_sub_;
-  std::map<std::string, float> action_completion_map_;
+  rclcpp::Publisher<plansys2_interface::msg::PlanExecutionSummary>::SharedPtr summary_pub_;
+  rclcpp::TimerBase::SharedPtr shutdown_timer_;
+  plansys_interface::ExecutionMonitor monitor_;
+  std::unique_ptr<plansys_interface::PlanCache> plan_cache_;
+  std::vector<std::string> planner_services_;
+  std::vector<rclcpp::Client<plansys2_msgs::srv::GetPlan>::SharedPtr> portfolio_clients_;
+  rclcpp::Node::SharedPtr portfolio_node_;
+  rclcpp::Subscription<plansys2_interface::msg::DetectedMarkers>::SharedPtr markers_snapshot_sub_;
+  rclcpp::Subscription<plansys2_interface::msg::DetectedMarkersDelta>::SharedPtr
+    marker_updates_sub_;
+  rclcpp::TimerBase::SharedPtr fact_batch_timer_;
+  std::map<int, std::string> pending_markers_;
+  uint64_t marker_revision_ = 0;
+  bool replan_on_updates_;
+  plansys2_msgs::msg::Plan current_plan_;
+  double planning_timeout_;
+  double planning_time_ = 0.0;
+  bool plan_finished_ = false;
+  std::string waypoints_file_;
+  std::string map_file_;
+  double robot_radius_;
+  std::string cache_dir_;
 };
 
 int main(int argc, char ** argv)
@@ -126,6 +549,7 @@ int main(int argc, char ** argv)
   rclcpp::init(argc, argv);
   auto node = std::make_shared<Controller>();
   node->init();
+  node->optimise_detection_tour();
   node->plan();
   rclcpp::spin(node);
   rclcpp::shutdown();
@@ -0,0 +1,249 @@
+#include "plansys_interface/landmark_fusion.hpp"
+
+#include <algorithm>
+
+namespace plansys_interface
+{
+
+Mat3 Mat3::identity(double s)
+{
+  Mat3 r;
+  r.m[0][0] = r.m[1][1] = r.m[2][2] = s;
+  return r;
+}
+
+Mat3 Mat3::operator+(const Mat3 & o) const
+{
+  Mat3 r;
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      r.m[i][j] = m[i][j] + o.m[i][j];
+    }
+  }
+  return r;
+}
+
+Mat3 Mat3::operator*(const Mat3 & o) const
+{
+  Mat3 r;
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      r.m[i][j] = m[i][0] * o.m[0][j] + m[i][1] * o.m[1][j] + m[i][2] * o.m[2][j];
+    }
+  }
+  return r;
+}
+
+Vec3 Mat3::operator*(const Vec3 & v) const
+{
+  return {
+    m[0][0] * v.x + m[0][1] * v.y + m[0][2] * v.z,
+    m[1][0] * v.x + m[1][1] * v.y + m[1][2] * v.z,
+    m[2][0] * v.x + m[2][1] * v.y + m[2][2] * v.z};
+}
+
+Mat3 Mat3::transposed() const
+{
+  Mat3 r;
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      r.m[i][j] = m[j][i];
+    }
+  }
+  return r;
+}
+
+bool Mat3::inverse(Mat3 & out) const
+{
+  const auto & a = m;
+  double c00 = a[1][1] * a[2][2] - a[1][2] * a[2][1];
+  double c01 = a[1][2] * a[2][0] - a[1][0] * a[2][2];
+  double c02 = a[1][0] * a[2][1] - a[1][1] * a[2][0];
+  double det = a[0][0] * c00 + a[0][1] * c01 + a[0][2] * c02;
+  if (std::abs(det) < 1e-30) {
+    return false;
+  }
+  double inv = 1.0 / det;
+  out.m[0][0] = c00 * inv;
+  out.m[1][0] = c01 * inv;
+  out.m[2][0] = c02 * inv;
+  out.m[0][1] = (a[0][2] * a[2][1] - a[0][1] * a[2][2]) * inv;
+  out.m[1][1] = (a[0][0] * a[2][2] - a[0][2] * a[2][0]) * inv;
+  out.m[2][1] = (a[0][1] * a[2][0] - a[0][0] * a[2][1]) * inv;
+  out.m[0][2] = (a[0][1] * a[1][2] - a[0][2] * a[1][1]) * inv;
+  out.m[1][2] = (a[0][2] * a[1][0] - a[0][0] * a[1][2]) * inv;
+  out.m[2][2] = (a[0][0] * a[1][1] - a[0][1] * a[1][0]) * inv;
+  return true;
+}
+
+Quat Quat::operator*(const Quat & o) const
+{
+  return {
+    w * o.x + x * o.w + y * o.z - z * o.y,
+    w * o.y - x * o.z + y * o.w + z * o.x,
+    w * o.z + x * o.y - y * o.x + z * o.w,
+    w * o.w - x * o.x - y * o.y - z * o.z};
+}
+
+Vec3 Quat::rotate(const Vec3 & v) const
+{
+  return matrix() * v;
+}
+
+Mat3 Quat::matrix() const
+{
+  Mat3 r;
+  r.m[0][0] = 1 - 2 * (y * y + z * z);
+  r.m[0][1] = 2 * (x * y - z * w);
+  r.m[0][2] = 2 * (x * z + y * w);
+  r.m[1][0] = 2 * (x * y + z * w);
+  r.m[1][1] = 1 - 2 * (x * x + z * z);
+  r.m[1][2] = 2 * (y * z - x * w);
+  r.m[2][0] = 2 * (x * z - y * w);
+  r.m[2][1] = 2 * (y * z + x * w);
+  r.m[2][2] = 1 - 2 * (x * x + y * y);
+  return r;
+}
+
+Quat Quat::normalized() const
+{
+  double n = std::sqrt(x * x + y * y + z * z + w * w);
+  if (n < 1e-12) {
+    return Quat();
+  }
+  return {x / n, y / n, z / n, w / n};
+}
+
+Pose3 Pose3::compose(const Pose3 & other) const
+{
+  return {position + orientation.rotate(other.position),
+    (orientation * other.orientation).normalized()};
+}
+
+static double quat_dot(const Quat & a, const Quat & b)
+{
+  return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+}
+
+// Angle of the rotation between two orientations
+static double quat_angle(const Quat & a, const Quat & b)
+{
+  return 2.0 * std::acos(std::min(1.0, std::abs(quat_dot(a, b))));
+}
+
+LandmarkFuser::LandmarkFuser(const FusionConfig & config)
+: config_(config)
+{
+}
+
+void LandmarkFuser::clear()
+{
+  landmarks_.clear();
+  ++revision_;
+}
+
+LandmarkObservation LandmarkFuser::observe(
+  const Pose3 & in_frame, const Pose3 & map_from_frame, const Vec3 & camera_position) const
+{
+  LandmarkObservation obs;
+  obs.pose = map_from_frame.compose(in_frame);
+
+  // sigma_lat^2 I + (sigma_depth^2 - sigma_lat^2) u u^T, u along the camera ray
+  Vec3 ray = obs.pose.position - camera_position;
+  double range = ray.norm();
+  Vec3 u = range > 1e-9 ? ray * (1.0 / range) : Vec3{0.0, 0.0, 1.0};
+  // Only kept away from zero, the floors apply to the fused landmark
+  double lateral = std::max(config_.lateral_noise * range, 1e-3);
+  double depth = std::max(config_.depth_noise * range * range, 1e-3);
+  double extra = depth * depth - lateral * lateral;
+  obs.covariance = Mat3::identity(lateral * lateral);
+  const double uv[3] = {u.x, u.y, u.z};
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      obs.covariance.m[i][j] += extra * uv[i] * uv[j];
+    }
+  }
+
+  obs.orientation_std = std::max(config_.orientation_noise * range, 1e-3);
+  obs.range = range;
+  return obs;
+}
+
+LandmarkFuser::Result LandmarkFuser::add(
+  const std::string & key, const LandmarkObservation & observation)
+{
+  if (!std::isfinite(observation.pose.position.norm()) || observation.range > config_.max_range) {
+    return Result::IGNORED;
+  }
+
+  double obs_weight = 1.0 / (observation.orientation_std * observation.orientation_std);
+  const Mat3 floor = Mat3::identity(config_.min_position_std * config_.min_position_std);
+  auto restart = [&](Landmark & landmark) {
+      landmark.pose = observation.pose;
+      landmark.noise_covariance = observation.covariance;
+      landmark.covariance = observation.covariance + floor;
+      landmark.orientation_weight = obs_weight;
+      landmark.orientation_floor = config_.min_orientation_std;
+      landmark.observations = 1;
+      landmark.outliers_in_row = 0;
+      landmark.converged = false;
+      ++revision_;
+    };
+
+  auto it = landmarks_.find(key);
+  if (it == landmarks_.end()) {
+    restart(landmarks_[key]);
+    return Result::ADDED;
+  }
+  auto & landmark = it->second;
+
+  // Mahalanobis distance of the innovation, and orientation difference. The observation
+  // carries its own localisation error, independent of the one of earlier visits.
+  Vec3 innovation = observation.pose.position - landmark.pose.position;
+  Mat3 innovation_info;
+  bool gated =
+    (landmark.covariance + observation.covariance + floor).inverse(innovation_info) &&
+    innovation.dot(innovation_info * innovation) <= config_.gate &&
+    quat_angle(landmark.pose.orientation, observation.pose.orientation) <=
+    config_.max_orientation_error;
+  if (!gated) {
+    if (++landmark.outliers_in_row >= config_.reset_after_outliers) {
+      restart(landmark);
+      return Result::RESET;
+    }
+    return Result::OUTLIER;
+  }
+
+  // Information-form update: P = (P1^-1 + P2^-1)^-1, x = P (P1^-1 x1 + P2^-1 x2)
+  Mat3 info_landmark, info_obs, covariance;
+  if (!landmark.noise_covariance.inverse(info_landmark) ||
+    !observation.covariance.inverse(info_obs) ||
+    !(info_landmark + info_obs).inverse(covariance))
+  {
+    return Result::IGNORED;
+  }
+  landmark.pose.position = covariance *
+    (info_landmark * landmark.pose.position + info_obs * observation.pose.position);
+  landmark.noise_covariance = covariance;
+  landmark.covariance = covariance + floor;
+
+  // Weighted average of quaternions on the same hemisphere, fine for close orientations
+  Quat q = observation.pose.orientation;
+  double sign = quat_dot(landmark.pose.orientation, q) < 0.0 ? -1.0 : 1.0;
+  double w0 = landmark.orientation_weight;
+  double w1 = obs_weight * sign;
+  const Quat & p = landmark.pose.orientation;
+  landmark.pose.orientation = Quat{
+    w0 * p.x + w1 * q.x, w0 * p.y + w1 * q.y, w0 * p.z + w1 * q.z, w0 * p.w + w1 * q.w}
+  .normalized();
+  landmark.orientation_weight += obs_weight;
+
+  ++landmark.observations;
+  landmark.outliers_in_row = 0;
+  landmark.converged = landmark.observations >= static_cast<uint32_t>(config_.min_observations) &&
+    landmark.position_std() <= config_.converged_std;
+  ++revision_;
+  return Result::FUSED;
+}
+
+}  // namespace plansys_interface
@@ -0,0 +1,216 @@
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp_components/register_node_macro.hpp"
+#include "aruco_opencv_msgs/msg/aruco_detection.hpp"
+#include "geometry_msgs/msg/transform_stamped.hpp"
+#include "plansys2_interface/msg/landmark_map.hpp"
+#include "plansys_interface/landmark_fusion.hpp"
+#include "tf2/exceptions.h"
+#include "tf2_ros/buffer.h"
+#include "tf2_ros/static_transform_broadcaster.h"
+#include "tf2_ros/transform_listener.h"
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+
+using namespace std::chrono_literals;
+
+namespace plansys_interface
+{
+
+// Fuses the marker and board poses of /aruco_detections into a map-frame landmark
+// map. The map is published latched on /landmark_map whenever it changes, and
+// every converged landmark is put on TF as a static frame, landmark_marker_<id>
+// or landmark_board_<name>, so navigation and alignment can use it directly.
+class LandmarkFusionNode : public rclcpp::Node
+{
+public:
+  explicit LandmarkFusionNode(const rclcpp::NodeOptions & options = rclcpp::NodeOptions())
+  : Node("landmark_fusion_node", options)
+  {
+    map_frame_ = this->declare_parameter<std::string>("map_frame", "map");
+    // Frame of the camera origin, empty when detections are in the camera frame
+    camera_frame_ = this->declare_parameter<std::string>("camera_frame", "");
+    // Converged landmarks that moved more than this are sent on TF again (m)
+    tf_update_distance_ = this->declare_parameter<double>("tf_update_distance", 0.02);
+
+    FusionConfig config;
+    config.lateral_noise = this->declare_parameter<double>("lateral_noise", config.lateral_noise);
+    config.depth_noise = this->declare_parameter<double>("depth_noise", config.depth_noise);
+    config.min_position_std =
+      this->declare_parameter<double>("min_position_std", config.min_position_std);
+    config.orientation_noise =
+      this->declare_parameter<double>("orientation_noise", config.orientation_noise);
+    config.min_orientation_std =
+      this->declare_parameter<double>("min_orientation_std", config.min_orientation_std);
+    config.max_range = this->declare_parameter<double>("max_range", config.max_range);
+    config.gate = this->declare_parameter<double>("outlier_gate", config.gate);
+    config.max_orientation_error =
+      this->declare_parameter<double>("max_orientation_error", config.max_orientation_error);
+    config.reset_after_outliers =
+      this->declare_parameter<int>("reset_after_outliers", config.reset_after_outliers);
+    config.min_observations =
+      this->declare_parameter<int>("min_observations", config.min_observations);
+    config.converged_std = this->declare_parameter<double>("converged_std", config.converged_std);
+    fuser_ = LandmarkFuser(config);
+
+    tf_buffer_ = std::make_unique<tf2_ros::Buffer>(this->get_clock());
+    tf_listener_ = std::make_shared<tf2_ros::TransformListener>(*tf_buffer_);
+    static_broadcaster_ = std::make_unique<tf2_ros::StaticTransformBroadcaster>(*this);
+
+    map_pub_ = this->create_publisher<plansys2_interface::msg::LandmarkMap>(
+      "/landmark_map", rclcpp::QoS(1).reliable().transient_local());
+
+    detection_sub_ = this->create_subscription<aruco_opencv_msgs::msg::ArucoDetection>(
+      "/aruco_detections", rclcpp::QoS(10).best_effort(),
+      std::bind(&LandmarkFusionNode::detection_callback, this, std::placeholders::_1)
+    );
+
+    // The map is republished at most this often
+    auto publish_period = this->declare_parameter<double>("publish_period", 1.0);
+    timer_ = this->create_wall_timer(std::chrono::duration<double>(publish_period),
+        std::bind(&LandmarkFusionNode::publish_map, this));
+
+    RCLCPP_INFO(get_logger(), "LandmarkFusionNode initialized, fusing in [%s]",
+                map_frame_.c_str());
+  }
+
+private:
+  void detection_callback(const aruco_opencv_msgs::msg::ArucoDetection::SharedPtr msg)
+  {
+    if (msg->markers.empty() && msg->boards.empty()) return;
+
+    // Transforms at the image time only; detections without one are dropped, not waited for
+    Pose3 map_from_frame, map_from_camera;
+    const std::string & camera_frame =
+      camera_frame_.empty() ? msg->header.frame_id : camera_frame_;
+    if (!lookup(msg->header.frame_id, msg->header.stamp, map_from_frame) ||
+      !lookup(camera_frame, msg->header.stamp, map_from_camera))
+    {
+      return;
+    }
+
+    for (const auto & marker : msg->markers) {
+      fuse("marker_" + std::to_string(marker.marker_id), marker.pose, map_from_frame,
+        map_from_camera.position);
+    }
+    for (const auto & board : msg->boards) {
+      fuse("board_" + board.board_name, board.pose, map_from_frame, map_from_camera.position);
+    }
+  }
+
+  bool lookup(
+    const std::string & frame, const builtin_interfaces::msg::Time & stamp, Pose3 & pose)
+  {
+    geometry_msgs::msg::TransformStamped transform;
+    try {
+      transform = tf_buffer_->lookupTransform(map_frame_, frame, rclcpp::Time(stamp));
+    } catch (const tf2::TransformException & e) {
+      RCLCPP_WARN_THROTTLE(get_logger(), *get_clock(), 5000, "No transform %s -> %s: %s",
+                           map_frame_.c_str(), frame.c_str(), e.what());
+      return false;
+    }
+    const auto & t = transform.transform;
+    pose.position = {t.translation.x, t.translation.y, t.translation.z};
+    pose.orientation = {t.rotation.x, t.rotation.y, t.rotation.z, t.rotation.w};
+    return true;
+  }
+
+  void fuse(
+    const std::string & key, const geometry_msgs::msg::Pose & pose, const Pose3 & map_from_frame,
+    const Vec3 & camera_position)
+  {
+    Pose3 in_frame;
+    in_frame.position = {pose.position.x, pose.position.y, pose.position.z};
+    in_frame.orientation = {pose.orientation.x, pose.orientation.y, pose.orientation.z,
+      pose.orientation.w};
+
+    auto result = fuser_.add(key, fuser_.observe(in_frame, map_from_frame, camera_position));
+    if (result == LandmarkFuser::Result::ADDED) {
+      RCLCPP_INFO(get_logger(), "New landmark %s", key.c_str());
+    } else if (result == LandmarkFuser::Result::RESET) {
+      RCLCPP_WARN(get_logger(), "Landmark %s moved, restarting it", key.c_str());
+    } else if (result == LandmarkFuser::Result::OUTLIER) {
+      RCLCPP_DEBUG(get_logger(), "Rejected outlier observation of %s", key.c_str());
+    }
+  }
+
+  void publish_map()
+  {
+    if (fuser_.revision() == published_revision_) return;
+    published_revision_ = fuser_.revision();
+
+    plansys2_interface::msg::LandmarkMap map;
+    map.header.stamp = this->now();
+    map.header.frame_id = map_frame_;
+    std::vector<geometry_msgs::msg::TransformStamped> transforms;
+
+    for (const auto & [key, landmark] : fuser_.landmarks()) {
+      plansys2_interface::msg::Landmark msg;
+      if (key.rfind("marker_", 0) == 0) {
+        msg.marker_id = std::stoi(key.substr(7));
+      } else {
+        msg.marker_id = -1;
+        msg.board = key.substr(6);
+      }
+      msg.frame_id = "landmark_" + key;
+      msg.pose.position.x = landmark.pose.position.x;
+      msg.pose.position.y = landmark.pose.position.y;
+      msg.pose.position.z = landmark.pose.position.z;
+      msg.pose.orientation.x = landmark.pose.orientation.x;
+      msg.pose.orientation.y = landmark.pose.orientation.y;
+      msg.pose.orientation.z = landmark.pose.orientation.z;
+      msg.pose.orientation.w = landmark.pose.orientation.w;
+      msg.position_std = landmark.position_std();
+      msg.orientation_std = landmark.orientation_std();
+      msg.observations = landmark.observations;
+      msg.converged = landmark.converged;
+      map.landmarks.push_back(msg);
+
+      if (landmark.converged && needs_tf_update(key, landmark.pose.position)) {
+        geometry_msgs::msg::TransformStamped transform;
+        transform.header = map.header;
+        transform.child_frame_id = msg.frame_id;
+        transform.transform.translation.x = msg.pose.position.x;
+        transform.transform.translation.y = msg.pose.position.y;
+        transform.transform.translation.z = msg.pose.position.z;
+        transform.transform.rotation = msg.pose.orientation;
+        transforms.push_back(transform);
+        broadcast_positions_[key] = landmark.pose.position;
+      }
+    }
+
+    map_pub_->publish(map);
+    if (!transforms.empty()) {
+      // The static broadcaster keeps every frame sent so far and republishes them all
+      static_broadcaster_->sendTransform(transforms);
+      RCLCPP_INFO(get_logger(), "Sent %zu converged landmark(s) on TF", transforms.size());
+    }
+  }
+
+  bool needs_tf_update(const std::string & key, const Vec3 & position) const
+  {
+    auto it = broadcast_positions_.find(key);
+    return it == broadcast_positions_.end() ||
+           (position - it->second).norm() > tf_update_distance_;
+  }
+
+  std::string map_frame_;
+  std::string camera_frame_;
+  double tf_update_distance_;
+  LandmarkFuser fuser_;
+  uint64_t published_revision_ = 0;
+  std::map<std::string, Vec3> broadcast_positions_;
+
+  std::unique_ptr<tf2_ros::Buffer> tf_buffer_;
+  std::shared_ptr<tf2_ros::TransformListener> tf_listener_;
+  std::unique_ptr<tf2_ros::StaticTransformBroadcaster> static_broadcaster_;
+  rclcpp::Publisher<plansys2_interface::msg::LandmarkMap>::SharedPtr map_pub_;
+  rclcpp::Subscription<aruco_opencv_msgs::msg::ArucoDetection>::SharedPtr detection_sub_;
+  rclcpp::TimerBase::SharedPtr timer_;
+};
+
+}  // namespace plansys_interface
+
+RCLCPP_COMPONENTS_REGISTER_NODE(plansys_interface::LandmarkFusionNode)
@@ -0,0 +1,361 @@
+#include "plansys_interface/landmark_log.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+namespace plansys_interface
+{
+
+static const char LANDMARK_LOG_MAGIC[8] = {'L', 'A', 'N', 'D', 'M', 'R', 'K', 'S'};
+static const uint32_t LANDMARK_LOG_VERSION = 1;
+
+// The file grows in chunks of this many records
+static const uint64_t RECORDS_PER_CHUNK = 1024;
+// Compact on open once superseded records exceed live ones by this much
+static const uint64_t COMPACTION_SLACK = 1024;
+
+enum RecordType : uint16_t { RECORD_UPSERT = 1, RECORD_REMOVE = 2 };
+
+static uint32_t crc32(const uint8_t * data, size_t len)
+{
+  static const auto table = [] {
+      std::array<uint32_t, 256> t{};
+      for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) {
+          c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        }
+        t[i] = c;
+      }
+      return t;
+    }();
+
+  uint32_t crc = 0xFFFFFFFFu;
+  for (size_t i = 0; i < len; ++i) {
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFFu;
+}
+
+static uint32_t record_crc(const LandmarkRecord & record)
+{
+  auto bytes = reinterpret_cast<const uint8_t *>(&record);
+  return crc32(bytes + sizeof(record.crc), sizeof(record) - sizeof(record.crc));
+}
+
+static bool fill_upsert(const MarkerInfo & info, LandmarkRecord & record, std::string & err)
+{
+  if (info.robot_wp.size() > sizeof(record.wp)) {
+    err = "waypoint name '" + info.robot_wp + "' is longer than " +
+      std::to_string(sizeof(record.wp)) + " characters";
+    return false;
+  }
+
+  std::memset(&record, 0, sizeof(record));
+  record.type = RECORD_UPSERT;
+  record.marker_id = info.marker_id;
+  record.wp_length = static_cast<uint16_t>(info.robot_wp.size());
+  std::memcpy(record.wp, info.robot_wp.data(), info.robot_wp.size());
+  record.position[0] = info.robot_pose.position.x;
+  record.position[1] = info.robot_pose.position.y;
+  record.position[2] = info.robot_pose.position.z;
+  record.orientation[0] = info.robot_pose.orientation.x;
+  record.orientation[1] = info.robot_pose.orientation.y;
+  record.orientation[2] = info.robot_pose.orientation.z;
+  record.orientation[3] = info.robot_pose.orientation.w;
+  return true;
+}
+
+static void apply_record(const LandmarkRecord & record, MarkerStore & store)
+{
+  if (record.type == RECORD_REMOVE) {
+    store.remove(record.marker_id);
+    return;
+  }
+
+  MarkerInfo info;
+  info.marker_id = record.marker_id;
+  info.robot_wp.assign(record.wp, std::min<size_t>(record.wp_length, sizeof(record.wp)));
+  info.robot_pose.position.x = record.position[0];
+  info.robot_pose.position.y = record.position[1];
+  info.robot_pose.position.z = record.position[2];
+  info.robot_pose.orientation.x = record.orientation[0];
+  info.robot_pose.orientation.y = record.orientation[1];
+  info.robot_pose.orientation.z = record.orientation[2];
+  info.robot_pose.orientation.w = record.orientation[3];
+  store.upsert(info);
+}
+
+static size_t file_size_for(uint64_t records)
+{
+  uint64_t chunks = (records + RECORDS_PER_CHUNK - 1) / RECORDS_PER_CHUNK;
+  if (chunks == 0) {
+    chunks = 1;
+  }
+  return sizeof(LandmarkLogHeader) + chunks * RECORDS_PER_CHUNK * sizeof(LandmarkRecord);
+}
+
+LandmarkLog::~LandmarkLog()
+{
+  close();
+}
+
+void LandmarkLog::close()
+{
+  if (data_ != nullptr) {
+    munmap(data_, mapped_size_);
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+  fd_ = -1;
+  data_ = nullptr;
+  mapped_size_ = 0;
+  header_ = nullptr;
+}
+
+bool LandmarkLog::open(
+  const std::string & path, bool sync_writes, MarkerStore & store,
+  std::string & error_message)
+{
+  close();
+  path_ = path;
+  sync_writes_ = sync_writes;
+
+  if (!map_file(path, error_message)) {
+    return false;
+  }
+
+  // Replay every complete record, stopping at the first torn or stale one
+  auto records = reinterpret_cast<LandmarkRecord *>(data_ + sizeof(LandmarkLogHeader));
+  const uint64_t capacity = (mapped_size_ - sizeof(LandmarkLogHeader)) / sizeof(LandmarkRecord);
+  uint64_t count = 0;
+  while (count < capacity && records[count].sequence == count + 1 &&
+    records[count].crc == record_crc(records[count]))
+  {
+    apply_record(records[count], store);
+    ++count;
+  }
+
+  // Clear whatever follows so it can not be mistaken for a valid record later
+  if (count < capacity) {
+    static const LandmarkRecord empty{};
+    if (std::memcmp(&records[count], &empty, sizeof(empty)) != 0) {
+      std::memset(&records[count], 0, (capacity - count) * sizeof(LandmarkRecord));
+      flush(&records[count], (capacity - count) * sizeof(LandmarkRecord));
+    }
+  }
+
+  if (header_->committed != count) {
+    header_->committed = count;
+    flush(header_, sizeof(LandmarkLogHeader));
+  }
+
+  if (count > 2 * store.size() + COMPACTION_SLACK) {
+    return compact(store, error_message);
+  }
+  return true;
+}
+
+bool LandmarkLog::map_file(const std::string & path, std::string & error_message)
+{
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    error_message = "Failed to open landmark log " + path + ": " + std::strerror(errno);
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    error_message = "Failed to stat landmark log " + path + ": " + std::strerror(errno);
+    close();
+    return false;
+  }
+
+  const bool fresh = st.st_size == 0;
+  size_t size = static_cast<size_t>(st.st_size);
+  if (fresh) {
+    size = file_size_for(0);
+    if (ftruncate(fd_, size) != 0) {
+      error_message = "Failed to resize landmark log " + path + ": " + std::strerror(errno);
+      close();
+      return false;
+    }
+  } else if (size < sizeof(LandmarkLogHeader)) {
+    error_message = "Failed to load landmark log " + path + ": file too small";
+    close();
+    return false;
+  }
+
+  void * data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (data == MAP_FAILED) {
+    error_message = "Failed to map landmark log " + path + ": " + std::strerror(errno);
+    close();
+    return false;
+  }
+  data_ = static_cast<uint8_t *>(data);
+  mapped_size_ = size;
+  header_ = reinterpret_cast<LandmarkLogHeader *>(data_);
+
+  if (fresh) {
+    std::memcpy(header_->magic, LANDMARK_LOG_MAGIC, sizeof(LANDMARK_LOG_MAGIC));
+    header_->version = LANDMARK_LOG_VERSION;
+    header_->record_size = sizeof(LandmarkRecord);
+    header_->committed = 0;
+    flush(header_, sizeof(LandmarkLogHeader));
+    return true;
+  }
+
+  if (std::memcmp(header_->magic, LANDMARK_LOG_MAGIC, sizeof(LANDMARK_LOG_MAGIC)) != 0 ||
+    header_->version != LANDMARK_LOG_VERSION ||
+    header_->record_size != sizeof(LandmarkRecord))
+  {
+    error_message = "Failed to load landmark log " + path + ": unsupported file format";
+    close();
+    return false;
+  }
+  return true;
+}
+
+bool LandmarkLog::reserve(uint64_t records, std::string & error_message)
+{
+  if (sizeof(LandmarkLogHeader) + records * sizeof(LandmarkRecord) <= mapped_size_) {
+    return true;
+  }
+
+  const size_t size = file_size_for(records);
+  if (ftruncate(fd_, size) != 0) {
+    error_message = "Failed to grow landmark log " + path_ + ": " + std::strerror(errno);
+    return false;
+  }
+
+  munmap(data_, mapped_size_);
+  void * data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (data == MAP_FAILED) {
+    error_message = "Failed to map landmark log " + path_ + ": " + std::strerror(errno);
+    data_ = nullptr;
+    close();
+    return false;
+  }
+  data_ = static_cast<uint8_t *>(data);
+  mapped_size_ = size;
+  header_ = reinterpret_cast<LandmarkLogHeader *>(data_);
+  return true;
+}
+
+bool LandmarkLog::append(LandmarkRecord & record, std::string & error_message)
+{
+  if (!is_open()) {
+    error_message = "Landmark log is not open";
+    return false;
+  }
+
+  const uint64_t index = header_->committed;
+  if (!reserve(index + 1, error_message)) {
+    return false;
+  }
+
+  record.sequence = index + 1;
+  record.crc = record_crc(record);
+
+  auto slot = data_ + sizeof(LandmarkLogHeader) + index * sizeof(LandmarkRecord);
+  std::memcpy(slot, &record, sizeof(record));
+  flush(slot, sizeof(record));
+
+  header_->committed = index + 1;
+  flush(header_, sizeof(LandmarkLogHeader));
+  return true;
+}
+
+bool LandmarkLog::append_upsert(const MarkerInfo & info, std::string & error_message)
+{
+  LandmarkRecord record;
+  if (!fill_upsert(info, record, error_message)) {
+    return false;
+  }
+  return append(record, error_message);
+}
+
+bool LandmarkLog::append_remove(int marker_id, std::string & error_message)
+{
+  LandmarkRecord record{};
+  record.type = RECORD_REMOVE;
+  record.marker_id = marker_id;
+  return append(record, error_message);
+}
+
+bool LandmarkLog::compact(const MarkerStore & store, std::string & error_message)
+{
+  // Write the live markers to a new file and atomically replace the old log
+  std::vector<uint8_t> buffer(file_size_for(store.size()), 0);
+  auto header = reinterpret_cast<LandmarkLogHeader *>(buffer.data());
+  std::memcpy(header->magic, LANDMARK_LOG_MAGIC, sizeof(LANDMARK_LOG_MAGIC));
+  header->version = LANDMARK_LOG_VERSION;
+  header->record_size = sizeof(LandmarkRecord);
+  header->committed = store.size();
+
+  auto records = reinterpret_cast<LandmarkRecord *>(buffer.data() + sizeof(LandmarkLogHeader));
+  uint64_t index = 0;
+  for (const auto & info : store) {
+    if (!fill_upsert(info, records[index], error_message)) {
+      return false;
+    }
+    records[index].sequence = index + 1;
+    records[index].crc = record_crc(records[index]);
+    ++index;
+  }
+
+  const std::string tmp_path = path_ + ".tmp";
+  int fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    error_message = "Failed to create " + tmp_path + ": " + std::strerror(errno);
+    return false;
+  }
+
+  size_t written = 0;
+  while (written < buffer.size()) {
+    ssize_t n = ::write(fd, buffer.data() + written, buffer.size() - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      error_message = "Failed to write " + tmp_path + ": " + std::strerror(errno);
+      ::close(fd);
+      unlink(tmp_path.c_str());
+      return false;
+    }
+    written += static_cast<size_t>(n);
+  }
+
+  if (fsync(fd) != 0 || ::close(fd) != 0 || rename(tmp_path.c_str(), path_.c_str()) != 0) {
+    error_message = "Failed to replace landmark log " + path_ + ": " + std::strerror(errno);
+    unlink(tmp_path.c_str());
+    return false;
+  }
+
+  close();
+  return map_file(path_, error_message);
+}
+
+void LandmarkLog::flush(const void * addr, size_t len)
+{
+  // Without syncing, writes still survive a crash of this process through the page cache
+  if (!sync_writes_) {
+    return;
+  }
+
+  static const uintptr_t page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  auto start = reinterpret_cast<uintptr_t>(addr) & ~(page_size - 1);
+  auto end = reinterpret_cast<uintptr_t>(addr) + len;
+  msync(reinterpret_cast<void *>(start), end - start, MS_SYNC);
+}
+
+}  // namespace plansys_interface
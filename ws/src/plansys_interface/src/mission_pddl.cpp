@@ -0,0 +1,448 @@
+#include "plansys_interface/mission_pddl.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <set>
+#include <sstream>
+
+namespace plansys_interface
+{
+
+static Atom atom(const std::string & predicate, std::vector<std::string> args = {})
+{
+  return Atom{predicate, std::move(args)};
+}
+
+static std::vector<std::string> common_predicates()
+{
+  return {
+    "(at ?r - robot ?w - waypoint)",
+    "(connected ?from - waypoint ?to - waypoint)",
+    "(marker-visible-at ?m - marker ?w - waypoint)",
+    "(marker-detected ?m - marker)",
+    "(marker-photographed ?m - marker)",
+    "(detection-complete)",
+    "(move-possible ?r - robot)",
+  };
+}
+
+// move, rotateanddetect and photographmarker are the same in both encodings
+static std::vector<ActionSchema> common_actions()
+{
+  ActionSchema move;
+  move.name = "move";
+  move.params = {{"?r", "robot"}, {"?from", "waypoint"}, {"?to", "waypoint"}};
+  move.pre = {atom("at", {"?r", "?from"}), atom("move-possible", {"?r"}),
+    atom("connected", {"?from", "?to"})};
+  move.add = {atom("at", {"?r", "?to"})};
+  move.del = {atom("at", {"?r", "?from"}), atom("move-possible", {"?r"})};
+
+  ActionSchema detect;
+  detect.name = "rotateanddetect";
+  detect.params = {{"?r", "robot"}, {"?w", "waypoint"}, {"?m", "marker"}};
+  detect.pre = {atom("at", {"?r", "?w"}), atom("marker-visible-at", {"?m", "?w"})};
+  detect.add = {atom("marker-detected", {"?m"}), atom("move-possible", {"?r"})};
+
+  ActionSchema photograph;
+  photograph.name = "photographmarker";
+  photograph.params = {{"?r", "robot"}, {"?w", "waypoint"}, {"?m", "marker"}};
+  photograph.pre = {atom("at", {"?r", "?w"}), atom("marker-detected", {"?m"}),
+    atom("marker-visible-at", {"?m", "?w"}), atom("detection-complete")};
+  photograph.add = {atom("marker-photographed", {"?m"})};
+
+  return {move, detect, photograph};
+}
+
+PddlDomain linear_mission_domain()
+{
+  PddlDomain domain;
+  domain.name = "marker_mission";
+  domain.types = {"robot", "waypoint", "marker"};
+  domain.predicates = common_predicates();
+  domain.predicates.insert(domain.predicates.end(), {
+    "(start-waypoint ?w - waypoint)",
+    "(next-marker ?m - marker ?n - marker)",
+    "(last-marker ?m - marker)",
+    "(detection-counted ?m - marker)",
+  });
+  domain.actions = common_actions();
+
+  // Detections are counted by rotateanddetect itself, in the order of the static
+  // next-marker chain, which starts at the m0 placeholder. The extra ?prev argument
+  // comes last, so the action node still finds the waypoint and marker where it expects.
+  auto & detect = domain.actions[1];
+  detect.params.emplace_back("?prev", "marker");
+  detect.pre.push_back(atom("detection-counted", {"?prev"}));
+  detect.pre.push_back(atom("next-marker", {"?prev", "?m"}));
+  detect.add.push_back(atom("detection-counted", {"?m"}));
+
+  ActionSchema finish;
+  finish.name = "finishdetection";
+  finish.params = {{"?r", "robot"}, {"?from", "waypoint"}, {"?st", "waypoint"},
+    {"?last", "marker"}};
+  finish.pre = {atom("at", {"?r", "?from"}), atom("start-waypoint", {"?st"}),
+    atom("last-marker", {"?last"}), atom("detection-counted", {"?last"})};
+  finish.neg_pre = {atom("detection-complete")};
+  finish.add = {atom("detection-complete"), atom("at", {"?r", "?st"})};
+  finish.del = {atom("at", {"?r", "?from"})};
+
+  domain.actions.insert(domain.actions.begin() + 2, finish);
+  return domain;
+}
+
+PddlDomain nary_mission_domain(size_t markers)
+{
+  PddlDomain domain;
+  domain.name = "marker_mission";
+  domain.types = {"robot", "waypoint", "marker"};
+  domain.predicates = common_predicates();
+  domain.actions = common_actions();
+
+  ActionSchema finish;
+  finish.name = "finishdetection";
+  finish.params = {{"?r", "robot"}};
+  for (size_t i = 1; i <= markers; ++i) {
+    finish.params.emplace_back("?m" + std::to_string(i), "marker");
+  }
+  for (size_t i = 1; i <= markers; ++i) {
+    finish.params.emplace_back("?w" + std::to_string(i), "waypoint");
+  }
+  finish.params.emplace_back("?st", "waypoint");
+  finish.add = {atom("detection-complete"), atom("at", {"?r", "?st"})};
+
+  for (size_t i = 1; i <= markers; ++i) {
+    const std::string m = "?m" + std::to_string(i);
+    const std::string w = "?w" + std::to_string(i);
+    finish.pre.push_back(atom("marker-detected", {m}));
+    finish.pre.push_back(atom("marker-visible-at", {m, w}));
+    for (size_t j = i + 1; j <= markers; ++j) {
+      finish.distinct.emplace_back(m, "?m" + std::to_string(j));
+      finish.distinct.emplace_back(w, "?w" + std::to_string(j));
+    }
+    finish.distinct.emplace_back(w, "?st");
+    finish.del.push_back(atom("at", {"?r", w}));
+    finish.del.push_back(atom("marker-detected", {m}));
+  }
+
+  domain.actions.insert(domain.actions.begin() + 2, finish);
+  return domain;
+}
+
+PddlProblem mission_problem(const MissionSpec & spec, bool linear)
+{
+  PddlProblem problem;
+  problem.name = "marker_mission_problem";
+  problem.objects.emplace_back("robot1", "robot");
+  problem.objects.emplace_back("st", "waypoint");
+  for (size_t i = 1; i <= spec.waypoints; ++i) {
+    problem.objects.emplace_back("wp" + std::to_string(i), "waypoint");
+  }
+  for (size_t i = 1; i <= spec.markers; ++i) {
+    problem.objects.emplace_back("m" + std::to_string(i), "marker");
+  }
+
+  problem.init.push_back(atom("at", {"robot1", "st"}));
+  problem.init.push_back(atom("move-possible", {"robot1"}));
+  for (size_t i = 1; i <= spec.markers; ++i) {
+    problem.init.push_back(atom("marker-visible-at",
+      {"m" + std::to_string(i), "wp" + std::to_string((i - 1) % spec.waypoints + 1)}));
+  }
+  std::string prev = "st";
+  for (size_t i = 1; i <= spec.waypoints; ++i) {
+    const std::string wp = "wp" + std::to_string(i);
+    problem.init.push_back(atom("connected", {prev, wp}));
+    problem.init.push_back(atom("connected", {wp, prev}));
+    prev = wp;
+  }
+
+  if (linear) {
+    problem.objects.emplace_back("m0", "marker");
+    problem.init.push_back(atom("start-waypoint", {"st"}));
+    problem.init.push_back(atom("detection-counted", {"m0"}));
+    for (size_t i = 0; i < spec.markers; ++i) {
+      problem.init.push_back(atom("next-marker",
+        {"m" + std::to_string(i), "m" + std::to_string(i + 1)}));
+    }
+    problem.init.push_back(atom("last-marker", {"m" + std::to_string(spec.markers)}));
+  }
+
+  for (size_t i = 1; i <= spec.markers; ++i) {
+    problem.goal.push_back(atom("marker-photographed", {"m" + std::to_string(i)}));
+  }
+  return problem;
+}
+
+static std::string to_string(const Atom & a)
+{
+  std::string s = "(" + a.predicate;
+  for (const auto & arg : a.args) {
+    s += " " + arg;
+  }
+  return s + ")";
+}
+
+std::string to_pddl(const PddlDomain & domain)
+{
+  std::ostringstream out;
+  out << "(define (domain " << domain.name << ")\n";
+  out << "  (:requirements :strips :typing :equality :negative-preconditions)\n";
+  out << "  (:types";
+  for (const auto & type : domain.types) {
+    out << " " << type;
+  }
+  out << ")\n\n  (:predicates\n";
+  for (const auto & pred : domain.predicates) {
+    out << "    " << pred << "\n";
+  }
+  out << "  )\n";
+
+  for (const auto & action : domain.actions) {
+    out << "\n  (:action " << action.name << "\n    :parameters (";
+    for (size_t i = 0; i < action.params.size(); ++i) {
+      out << (i ? " " : "") << action.params[i].first << " - " << action.params[i].second;
+    }
+    out << ")\n    :precondition (and\n";
+    for (const auto & a : action.pre) {
+      out << "      " << to_string(a) << "\n";
+    }
+    for (const auto & a : action.neg_pre) {
+      out << "      (not " << to_string(a) << ")\n";
+    }
+    for (const auto & d : action.distinct) {
+      out << "      (not (= " << d.first << " " << d.second << "))\n";
+    }
+    out << "    )\n    :effect (and\n";
+    for (const auto & a : action.add) {
+      out << "      " << to_string(a) << "\n";
+    }
+    for (const auto & a : action.del) {
+      out << "      (not " << to_string(a) << ")\n";
+    }
+    out << "    )\n  )\n";
+  }
+  out << ")\n";
+  return out.str();
+}
+
+std::string to_pddl(const PddlProblem & problem, const std::string & domain_name)
+{
+  std::ostringstream out;
+  out << "(define (problem " << problem.name << ")\n";
+  out << "  (:domain " << domain_name << ")\n\n  (:objects\n";
+  std::map<std::string, std::vector<std::string>> by_type;
+  std::vector<std::string> type_order;
+  for (const auto & obj : problem.objects) {
+    if (!by_type.count(obj.second)) {
+      type_order.push_back(obj.second);
+    }
+    by_type[obj.second].push_back(obj.first);
+  }
+  for (const auto & type : type_order) {
+    out << "   ";
+    for (const auto & name : by_type[type]) {
+      out << " " << name;
+    }
+    out << " - " << type << "\n";
+  }
+  out << "  )\n\n  (:init\n";
+  for (const auto & a : problem.init) {
+    out << "    " << to_string(a) << "\n";
+  }
+  out << "  )\n\n  (:goal\n    (and\n";
+  for (const auto & a : problem.goal) {
+    out << "      " << to_string(a) << "\n";
+  }
+  out << "    )\n  )\n)\n";
+  return out.str();
+}
+
+namespace
+{
+
+// Backtracking over the parameters of one schema, checking every static
+// precondition and inequality as soon as its arguments are bound
+class SchemaGrounder
+{
+public:
+  SchemaGrounder(
+    const ActionSchema & action, const std::map<std::string, std::vector<std::string>> & objects,
+    const std::set<std::string> & static_predicates, const std::set<std::string> & static_facts,
+    size_t limit, std::chrono::steady_clock::time_point deadline)
+  : action_(action), static_facts_(static_facts), limit_(limit), deadline_(deadline)
+  {
+    for (size_t i = 0; i < action.params.size(); ++i) {
+      index_[action.params[i].first] = i;
+      auto it = objects.find(action.params[i].second);
+      domains_.push_back(it == objects.end() ? nullptr : &it->second);
+    }
+    checks_.resize(action.params.size());
+    auto last_bound = [this](const std::vector<std::string> & args) {
+        size_t last = 0;
+        for (const auto & arg : args) {
+          auto it = index_.find(arg);
+          if (it != index_.end()) {
+            last = std::max(last, it->second);
+          }
+        }
+        return last;
+      };
+    for (const auto & a : action.pre) {
+      if (static_predicates.count(a.predicate)) {
+        checks_[last_bound(a.args)].push_back({&a, true, {}});
+      }
+    }
+    for (const auto & a : action.neg_pre) {
+      if (static_predicates.count(a.predicate)) {
+        checks_[last_bound(a.args)].push_back({&a, false, {}});
+      }
+    }
+    for (const auto & d : action.distinct) {
+      checks_[last_bound({d.first, d.second})].push_back({nullptr, false, d});
+    }
+    binding_.resize(action.params.size());
+  }
+
+  size_t run(bool & truncated)
+  {
+    count_ = 0;
+    truncated_ = false;
+    if (!action_.params.empty()) {
+      bind(0);
+    } else {
+      count_ = 1;
+    }
+    truncated = truncated_;
+    return count_;
+  }
+
+private:
+  struct Check
+  {
+    const Atom * atom;
+    bool positive;
+    std::pair<std::string, std::string> distinct;
+  };
+
+  const std::string & value(const std::string & arg) const
+  {
+    auto it = index_.find(arg);
+    return it == index_.end() ? arg : *binding_[it->second];
+  }
+
+  bool holds(const Check & check) const
+  {
+    if (check.atom == nullptr) {
+      return value(check.distinct.first) != value(check.distinct.second);
+    }
+    std::string fact = "(" + check.atom->predicate;
+    for (const auto & arg : check.atom->args) {
+      fact += " " + value(arg);
+    }
+    fact += ")";
+    return static_facts_.count(fact) > 0 ? check.positive : !check.positive;
+  }
+
+  void bind(size_t depth)
+  {
+    if (domains_[depth] == nullptr) {
+      return;
+    }
+    for (const auto & obj : *domains_[depth]) {
+      if (truncated_) {
+        return;
+      }
+      // Checking the clock on every node would dominate the search
+      if ((++nodes_ & 0xfff) == 0 && std::chrono::steady_clock::now() > deadline_) {
+        truncated_ = true;
+        return;
+      }
+      binding_[depth] = &obj;
+      bool ok = true;
+      for (const auto & check : checks_[depth]) {
+        if (!holds(check)) {
+          ok = false;
+          break;
+        }
+      }
+      if (!ok) {
+        continue;
+      }
+      if (depth + 1 == binding_.size()) {
+        if (++count_ >= limit_) {
+          truncated_ = true;
+        }
+      } else {
+        bind(depth + 1);
+      }
+    }
+  }
+
+  const ActionSchema & action_;
+  const std::set<std::string> & static_facts_;
+  size_t limit_;
+  std::chrono::steady_clock::time_point deadline_;
+  size_t nodes_ = 0;
+  std::map<std::string, size_t> index_;
+  std::vector<const std::vector<std::string> *> domains_;
+  std::vector<std::vector<Check>> checks_;
+  std::vector<const std::string *> binding_;
+  size_t count_ = 0;
+  bool truncated_ = false;
+};
+
+}  // namespace
+
+GroundingStats ground(
+  const PddlDomain & domain, const PddlProblem & problem, size_t limit, double time_limit)
+{
+  auto start = std::chrono::steady_clock::now();
+  auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(time_limit));
+
+  // Predicates no action changes keep their initial value
+  std::set<std::string> static_predicates;
+  std::set<std::string> fluent;
+  for (const auto & action : domain.actions) {
+    for (const auto & a : action.add) {
+      fluent.insert(a.predicate);
+    }
+    for (const auto & a : action.del) {
+      fluent.insert(a.predicate);
+    }
+  }
+  for (const auto & decl : domain.predicates) {
+    std::string name = decl.substr(1, decl.find_first_of(" )") - 1);
+    if (!fluent.count(name)) {
+      static_predicates.insert(name);
+    }
+  }
+
+  std::set<std::string> static_facts;
+  for (const auto & a : problem.init) {
+    if (static_predicates.count(a.predicate)) {
+      static_facts.insert(to_string(a));
+    }
+  }
+  std::map<std::string, std::vector<std::string>> objects;
+  for (const auto & obj : problem.objects) {
+    objects[obj.second].push_back(obj.first);
+  }
+
+  GroundingStats stats;
+  for (const auto & action : domain.actions) {
+    bool truncated = false;
+    size_t remaining = limit > stats.ground_actions ? limit - stats.ground_actions : 1;
+    SchemaGrounder grounder(action, objects, static_predicates, static_facts, remaining,
+      deadline);
+    stats.ground_actions += grounder.run(truncated);
+    if (truncated) {
+      stats.truncated = true;
+      break;
+    }
+  }
+  stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return stats;
+}
+
+}  // namespace plansys_interface
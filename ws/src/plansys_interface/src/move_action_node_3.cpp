@@ -1,11 +1,15 @@
 #include "plansys2_executor/ActionExecutorClient.hpp"
 #include "rclcpp/rclcpp.hpp"
+#include "rclcpp_components/register_node_macro.hpp"
+#include "plansys_interface/component_startup.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
 #include "geometry_msgs/msg/pose_stamped.hpp"
 #include "nav2_msgs/action/navigate_to_pose.hpp"
-#include "nav_msgs/msg/odometry.hpp"
 #include "lifecycle_msgs/msg/transition.hpp"
 #include "plansys2_interface/msg/detected_markers.hpp"
+#include "plansys_interface/tour_optimizer.hpp"
+#include "plansys_interface/waypoint_registry.hpp"
+#include "ament_index_cpp/get_package_share_directory.hpp"
 #include <memory>
 #include <chrono>
 #include <string>
@@ -15,10 +19,15 @@
 
 using namespace std::chrono_literals;
 
+namespace plansys_interface
+{
+
 class MoveAction : public plansys2::ActionExecutorClient
 {
 public:
-  MoveAction()
+  // plansys2::ActionExecutorClient takes no NodeOptions, parameters come from the
+  // process arguments
+  explicit MoveAction(const rclcpp::NodeOptions & = rclcpp::NodeOptions())
   : plansys2::ActionExecutorClient("move", 500ms), 
     goal_sent_(false), 
     progress_(0.0),
@@ -26,29 +35,59 @@ public:
     nth_request_index_(0),
     info_requested_(false)
   {
-    odom_ = this->create_subscription<nav_msgs::msg::Odometry>(
-      "/odom", 10,
-      std::bind(&MoveAction::odom_callback, this, std::placeholders::_1)
-    );
-
-    nav2_node_ = rclcpp::Node::make_shared("move_action_nav2_client");
+    // The Nav2 client lives on this node, so its responses are handled by the same executor
+    // as soon as they arrive instead of waiting for the next do_work tick. It shares the
+    // default callback group with the do_work timer, so even in a multi-threaded container
+    // its callbacks never run concurrently with do_work.
     nav2_client_ = rclcpp_action::create_client<nav2_msgs::action::NavigateToPose>(
-      nav2_node_, "navigate_to_pose"
+      get_node_base_interface(), get_node_graph_interface(), get_node_logging_interface(),
+      get_node_waitables_interface(), "navigate_to_pose"
     );
     
     // Subscriber to get all detected markers from world node
     detected_markers_sub_ = this->create_subscription<plansys2_interface::msg::DetectedMarkers>(
-      "/world_node/detected_markers", 10,
+      "/world_node/detected_markers", rclcpp::QoS(1).reliable().transient_local(),
       std::bind(&MoveAction::detected_markers_callback, this, std::placeholders::_1)
     );
+
+    auto waypoints_file = this->declare_parameter<std::string>("waypoints_file",
+      ament_index_cpp::get_package_share_directory("plansys_interface") +
+      "/config/waypoints.yaml");
+    // "id" photographs markers in increasing ID order, "cost" in the cheapest travel order
+    photograph_order_ = this->declare_parameter<std::string>("photograph_order", "id");
+    auto map_file = this->declare_parameter<std::string>("map_file", "");
+    auto robot_radius = this->declare_parameter<double>("robot_radius", 0.25);
+    auto cache_dir = this->declare_parameter<std::string>("path_cost_cache_dir", "");
+
+    std::string err;
+    if (!waypoints_.load_from_file(waypoints_file, err)) {
+      RCLCPP_ERROR(get_logger(), "%s", err.c_str());
+    }
+
+    if (photograph_order_ == "cost") {
+      bool from_cache;
+      if (map_file.empty() ||
+        !plansys_interface::load_or_compute_path_costs(
+          waypoints_, map_file, robot_radius, cache_dir, path_costs_, from_cache, err))
+      {
+        RCLCPP_WARN(get_logger(), "No path costs (%s), photographing in ID order",
+                    map_file.empty() ? "map_file not set" : err.c_str());
+        photograph_order_ = "id";
+      } else {
+        RCLCPP_INFO(get_logger(), "Path costs for %zu waypoints %s", path_costs_.size(),
+                    from_cache ? "loaded from cache" : "computed");
+      }
+    }
+
+    startup_timer_ = start_action_executor(this, "move", true);
   }
 
 private:
   void do_work() override
   {
-    // Skip if goal was already sent and we're waiting for result
+    // The result callback finishes the action, only report progress while waiting for it
     if (goal_sent_) {
-      rclcpp::spin_some(nav2_node_);
+      send_feedback(progress_, "Moving to " + goal_wp_name_);
       return;
     }
     
@@ -62,11 +101,14 @@ private:
     std::string wp_to_navigate = args[2];
 
     double goal_x, goal_y;
-    // Waypoint coordinates as per assignment 
+    // In the photography phase the goal is the next marker waypoint, not the planned one
     if(visited_waypoints_ >= 4){
-      // Use cached markers from subscription (already sorted by world_node)
-      if (!cached_markers_.empty() && nth_request_index_ < static_cast<int>(cached_markers_.size())) {
-        marker_wp_ = cached_markers_[nth_request_index_].wp;
+      if (!cached_markers_.empty() && photograph_wps_.empty()) {
+        plan_photograph_order();
+      }
+
+      if (!cached_markers_.empty() && nth_request_index_ < static_cast<int>(photograph_wps_.size())) {
+        marker_wp_ = photograph_wps_[nth_request_index_];
         nth_request_index_++;
         RCLCPP_INFO(get_logger(), "Got nth(%d) marker wp: %s",
                     nth_request_index_ - 1, marker_wp_.c_str());
@@ -83,27 +125,17 @@ private:
       wp_to_navigate = marker_wp_;
       marker_wp_ = "";
     }
-      if (wp_to_navigate == "wp1") {
-        goal_x = -6.0;
-        goal_y = -6.0;
-      } else if (wp_to_navigate == "wp2") {
-        goal_x = -6.0;
-        goal_y = 6.0;
-      } else if (wp_to_navigate == "wp3") {
-        goal_x = 6.0;
-        goal_y = 6.0;
-      } else if (wp_to_navigate == "wp4") {
-        goal_x = 6.0;
-        goal_y = -6.0;
-      } else {
-        RCLCPP_ERROR(get_logger(), "Unknown waypoint: %s", wp_to_navigate.c_str());
-        finish(false, 0.0, "Unknown waypoint");
-        return;
-      }
-    
+    const auto * goal_wp = waypoints_.find(wp_to_navigate);
+    if (goal_wp == nullptr) {
+      RCLCPP_ERROR(get_logger(), "Unknown waypoint: %s", wp_to_navigate.c_str());
+      finish(false, 0.0, "Unknown waypoint");
+      return;
+    }
+    goal_x = goal_wp->x;
+    goal_y = goal_wp->y;
 
     if (!goal_sent_) {
-      if (!nav2_client_->wait_for_action_server(1s)) {
+      if (!nav2_client_->action_server_is_ready()) {
         RCLCPP_WARN(get_logger(), "NavigateToPose server not ready");
         return;
       }
@@ -114,12 +146,34 @@ private:
       goal_pose.pose.position.x = goal_x;
       goal_pose.pose.position.y = goal_y;
       // goal_pose.pose.position.z = 0.0;
-      goal_pose.pose.orientation.w = 1.0;
+      goal_pose.pose.orientation.z = std::sin(goal_wp->yaw / 2.0);
+      goal_pose.pose.orientation.w = std::cos(goal_wp->yaw / 2.0);
 
       auto goal_msg = nav2_msgs::action::NavigateToPose::Goal();
       goal_msg.pose = goal_pose;
 
       rclcpp_action::Client<nav2_msgs::action::NavigateToPose>::SendGoalOptions send_goal_options;
+      send_goal_options.goal_response_callback =
+        [this, wp_to_navigate](const rclcpp_action::ClientGoalHandle<nav2_msgs::action::NavigateToPose>::SharedPtr & handle)
+        {
+          if (!handle) {
+            RCLCPP_ERROR(get_logger(), "Navigation goal rejected: %s", wp_to_navigate.c_str());
+            goal_sent_ = false;
+            finish(false, 0.0, "Move rejected");
+          }
+        };
+      send_goal_options.feedback_callback =
+        [this](rclcpp_action::ClientGoalHandle<nav2_msgs::action::NavigateToPose>::SharedPtr,
+               const std::shared_ptr<const nav2_msgs::action::NavigateToPose::Feedback> feedback)
+        {
+          // The first estimate of the remaining path length is taken as the leg length
+          double remaining = feedback->distance_remaining;
+          if (initial_distance_ <= 0.0) {
+            initial_distance_ = remaining;
+          }
+          progress_ = initial_distance_ > 0.0 ?
+            1.0 - std::clamp(remaining / initial_distance_, 0.0, 1.0) : 0.0;
+        };
       send_goal_options.result_callback =
         [this, wp_to_navigate](const rclcpp_action::ClientGoalHandle<nav2_msgs::action::NavigateToPose>::WrappedResult & result)
         {
@@ -139,30 +193,60 @@ private:
           }
           
           RCLCPP_INFO(get_logger(), "Reached waypoint: %s (visited: %d)", wp_to_navigate.c_str(), visited_waypoints_);
+          last_reached_wp_ = wp_to_navigate;
           goal_sent_ = false;
           finish(true, 1.0, "Move completed");
         };
 
+      progress_ = 0.0;
+      initial_distance_ = 0.0;
+      goal_wp_name_ = wp_to_navigate;
       nav2_client_->async_send_goal(goal_msg, send_goal_options);
       goal_sent_ = true;
 
-      start_x_ = current_x_;
-      start_y_ = current_y_;
-      
       RCLCPP_INFO(get_logger(), "Navigating to %s at (%.2f, %.2f)", wp_to_navigate.c_str(), goal_x, goal_y);
     }
 
-    double total_dist = std::hypot(goal_x - start_x_, goal_y - start_y_);
-    double rem_dist   = std::hypot(goal_x - current_x_, goal_y - current_y_);
-    progress_ = total_dist > 0.0 ? 1.0 - std::min(rem_dist / total_dist, 1.0) : 1.0;
-
     send_feedback(progress_, "Moving to " + wp_to_navigate);
+  }
 
-    // if (rem_dist < 0.6) {
-      
-    // }
+  // Waypoints of the detected markers in the order they are photographed
+  void plan_photograph_order()
+  {
+    // Markers arrive sorted by ID from world_node
+    photograph_wps_.clear();
+    for (const auto & marker : cached_markers_) {
+      photograph_wps_.push_back(marker.wp);
+    }
+    if (photograph_order_ != "cost") {
+      return;
+    }
+
+    size_t start = waypoints_.index_of(last_reached_wp_);
+    std::vector<size_t> stops;
+    for (const auto & wp : photograph_wps_) {
+      stops.push_back(waypoints_.index_of(wp));
+    }
+    if (start == plansys_interface::WaypointRegistry::npos ||
+      std::count(stops.begin(), stops.end(), plansys_interface::WaypointRegistry::npos) > 0)
+    {
+      RCLCPP_WARN(get_logger(), "Marker waypoints missing from the registry, keeping ID order");
+      return;
+    }
 
-    // rclcpp::spin_some(nav2_node_);
+    std::vector<size_t> order;
+    std::string err;
+    if (!plansys_interface::optimise_tour(path_costs_, start, stops, order, err)) {
+      RCLCPP_WARN(get_logger(), "%s, keeping ID order", err.c_str());
+      return;
+    }
+    RCLCPP_INFO(get_logger(), "Photograph tour cost %.2f m (ID order %.2f m)",
+                plansys_interface::tour_cost(path_costs_, start, order),
+                plansys_interface::tour_cost(path_costs_, start, stops));
+    photograph_wps_.clear();
+    for (size_t idx : order) {
+      photograph_wps_.push_back(waypoints_.at(idx).name);
+    }
   }
 
   void detected_markers_callback(const plansys2_interface::msg::DetectedMarkers::SharedPtr msg)
@@ -172,17 +256,11 @@ private:
     RCLCPP_INFO(get_logger(), "Received %zu detected markers", cached_markers_.size());
   }
 
-  void odom_callback(const nav_msgs::msg::Odometry::SharedPtr msg)
-  {
-    current_x_ = msg->pose.pose.position.x;
-    current_y_ = msg->pose.pose.position.y;
-  }
-
 
   float progress_;
   bool goal_sent_;
-  double start_x_ = 0.0, start_y_ = 0.0;
-  double current_x_ = 0.0, current_y_ = 0.0;
+  double initial_distance_ = 0.0;
+  std::string goal_wp_name_;
   std::string marker_wp_;
   int visited_waypoints_;
   int nth_request_index_;
@@ -191,26 +269,19 @@ private:
 
   // Cached markers from subscription
   std::vector<plansys2_interface::msg::DetectedMarker> cached_markers_;
+  std::vector<std::string> photograph_wps_;
+  std::string photograph_order_;
+  std::string last_reached_wp_;
+
+  plansys_interface::WaypointRegistry waypoints_;
+  plansys_interface::PathCostMatrix path_costs_;
 
-  rclcpp::Node::SharedPtr nav2_node_;
   rclcpp_action::Client<nav2_msgs::action::NavigateToPose>::SharedPtr nav2_client_;
   rclcpp::Subscription<plansys2_interface::msg::DetectedMarkers>::SharedPtr detected_markers_sub_;
-  rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_;
-};
-
-int main(int argc, char ** argv)
-{
-  rclcpp::init(argc, argv);
-  auto node = std::make_shared<MoveAction>();
 
-  node->set_parameter(rclcpp::Parameter("action_name", "move"));
-  node->trigger_transition(lifecycle_msgs::msg::Transition::TRANSITION_CONFIGURE);
-  node->trigger_transition(lifecycle_msgs::msg::Transition::TRANSITION_ACTIVATE);
-
-  rclcpp::spin(node->get_node_base_interface());
-
-  rclcpp::shutdown();
+  rclcpp::TimerBase::SharedPtr startup_timer_;
+};
 
-  return 0;
-}
+}  // namespace plansys_interface
 
+RCLCPP_COMPONENTS_REGISTER_NODE(plansys_interface::MoveAction)
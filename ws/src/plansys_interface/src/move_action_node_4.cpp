@@ -3,8 +3,9 @@
 #include "rclcpp_action/rclcpp_action.hpp"
 #include "geometry_msgs/msg/pose_stamped.hpp"
 #include "nav2_msgs/action/navigate_to_pose.hpp"
-#include "nav_msgs/msg/odometry.hpp"
 #include "lifecycle_msgs/msg/transition.hpp"
+#include "plansys_interface/waypoint_registry.hpp"
+#include "ament_index_cpp/get_package_share_directory.hpp"
 #include <memory>
 #include <chrono>
 #include <string>
@@ -19,15 +20,21 @@ public:
   MoveAction()
   : plansys2::ActionExecutorClient("move", 500ms), goal_sent_(false), progress_(0.0)
   {
-    odom_ = this->create_subscription<nav_msgs::msg::Odometry>(
-      "/odom", 10,
-      std::bind(&MoveAction::odom_callback, this, std::placeholders::_1)
-    );
-
-    nav2_node_ = rclcpp::Node::make_shared("move_action_nav2_client");
+    // The Nav2 client lives on this node, so its responses are handled by the same executor
+    // as soon as they arrive instead of waiting for the next do_work tick
+    nav2_cb_group_ = this->create_callback_group(rclcpp::CallbackGroupType::MutuallyExclusive);
     nav2_client_ = rclcpp_action::create_client<nav2_msgs::action::NavigateToPose>(
-      nav2_node_, "navigate_to_pose"
+      get_node_base_interface(), get_node_graph_interface(), get_node_logging_interface(),
+      get_node_waitables_interface(), "navigate_to_pose", nav2_cb_group_
     );
+
+    auto waypoints_file = this->declare_parameter<std::string>("waypoints_file",
+      ament_index_cpp::get_package_share_directory("plansys_interface") +
+      "/config/waypoints.yaml");
+    std::string err;
+    if (!waypoints_.load_from_file(waypoints_file, err)) {
+      RCLCPP_ERROR(get_logger(), "%s", err.c_str());
+    }
   }
 
 private:
@@ -42,21 +49,17 @@ private:
 
     std::string wp_to_navigate = args[2];
 
-    double goal_x, goal_y;
-    if (wp_to_navigate == "bathroom") {
-      goal_x = 10.0;
-      goal_y = 5.0;
-    } else if (wp_to_navigate == "bedroom") {
-      goal_x = 5.0;
-      goal_y = 6.0;
-    } else {
+    const auto * goal_wp = waypoints_.find(wp_to_navigate);
+    if (goal_wp == nullptr) {
       RCLCPP_ERROR(get_logger(), "Unknown waypoint: %s", wp_to_navigate.c_str());
       finish(false, 0.0, "Unknown waypoint");
       return;
     }
+    double goal_x = goal_wp->x;
+    double goal_y = goal_wp->y;
 
     if (!goal_sent_) {
-      if (!nav2_client_->wait_for_action_server(1s)) {
+      if (!nav2_client_->action_server_is_ready()) {
         RCLCPP_WARN(get_logger(), "NavigateToPose server not ready");
         return;
       }
@@ -65,59 +68,66 @@ private:
       goal_pose.header.frame_id = "map";
       goal_pose.pose.position.x = goal_x;
       goal_pose.pose.position.y = goal_y;
-      goal_pose.pose.orientation.w = 1.0;
+      goal_pose.pose.orientation.z = std::sin(goal_wp->yaw / 2.0);
+      goal_pose.pose.orientation.w = std::cos(goal_wp->yaw / 2.0);
 
       auto goal_msg = nav2_msgs::action::NavigateToPose::Goal();
       goal_msg.pose = goal_pose;
 
       rclcpp_action::Client<nav2_msgs::action::NavigateToPose>::SendGoalOptions send_goal_options;
+      send_goal_options.goal_response_callback =
+        [this, wp_to_navigate](const rclcpp_action::ClientGoalHandle<nav2_msgs::action::NavigateToPose>::SharedPtr & handle)
+        {
+          if (!handle) {
+            RCLCPP_ERROR(get_logger(), "Navigation goal rejected: %s", wp_to_navigate.c_str());
+            goal_sent_ = false;
+            finish(false, 0.0, "Move rejected");
+          }
+        };
+      send_goal_options.feedback_callback =
+        [this](rclcpp_action::ClientGoalHandle<nav2_msgs::action::NavigateToPose>::SharedPtr,
+               const std::shared_ptr<const nav2_msgs::action::NavigateToPose::Feedback> feedback)
+        {
+          // The first estimate of the remaining path length is taken as the leg length
+          double remaining = feedback->distance_remaining;
+          if (initial_distance_ <= 0.0) {
+            initial_distance_ = remaining;
+          }
+          progress_ = initial_distance_ > 0.0 ?
+            1.0 - std::clamp(remaining / initial_distance_, 0.0, 1.0) : 0.0;
+        };
       send_goal_options.result_callback =
         [this, wp_to_navigate](const rclcpp_action::ClientGoalHandle<nav2_msgs::action::NavigateToPose>::WrappedResult & result)
         {
+          goal_sent_ = false;
           if (result.code != rclcpp_action::ResultCode::SUCCEEDED) {
             RCLCPP_ERROR(get_logger(), "Navigation failed: %s", wp_to_navigate.c_str());
             finish(true, 1.0, "Move failed");
+            return;
           }
+          progress_ = 1.0;
+          send_feedback(progress_, "Moving to " + wp_to_navigate);
+          RCLCPP_INFO(get_logger(), "Reached waypoint: %s", wp_to_navigate.c_str());
+          finish(true, 1.0, "Move completed");
         };
 
+      progress_ = 0.0;
+      initial_distance_ = 0.0;
       nav2_client_->async_send_goal(goal_msg, send_goal_options);
       goal_sent_ = true;
-
-      start_x_ = current_x_;
-      start_y_ = current_y_;
     }
 
-    double total_dist = std::hypot(goal_x - start_x_, goal_y - start_y_);
-    double rem_dist   = std::hypot(goal_x - current_x_, goal_y - current_y_);
-    progress_ = total_dist > 0.0 ? 1.0 - std::min(rem_dist / total_dist, 1.0) : 1.0;
-
     send_feedback(progress_, "Moving to " + wp_to_navigate);
-
-    if (rem_dist < 0.6) {
-      goal_sent_= false;
-      progress_ = 1.0;
-      send_feedback(progress_, "Moving to " + wp_to_navigate);
-      RCLCPP_INFO(get_logger(), "Reached waypoint: %s", wp_to_navigate.c_str());
-      finish(true, 1.0, "Move completed");
-    }
-
-    rclcpp::spin_some(nav2_node_);
-  }
-
-  void odom_callback(const nav_msgs::msg::Odometry::SharedPtr msg)
-  {
-    current_x_ = msg->pose.pose.position.x;
-    current_y_ = msg->pose.pose.position.y;
   }
 
   float progress_;
   bool goal_sent_;
-  double start_x_ = 0.0, start_y_ = 0.0;
-  double current_x_ = 0.0, current_y_ = 0.0;
+  double initial_distance_ = 0.0;
+
+  plansys_interface::WaypointRegistry waypoints_;
 
-  rclcpp::Node::SharedPtr nav2_node_;
+  rclcpp::CallbackGroup::SharedPtr nav2_cb_group_;
   rclcpp_action::Client<nav2_msgs::action::NavigateToPose>::SharedPtr nav2_client_;
-  rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_;
 };
 
 int main(int argc, char ** argv)
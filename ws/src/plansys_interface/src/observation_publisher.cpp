@@ -0,0 +1,104 @@
+#include "plansys_interface/observation_publisher.hpp"
+
+#include <random>
+
+namespace plansys_interface
+{
+
+// Sequence numbers restart with the process, so a restarted node is a new source
+std::string ObservationPublisher::make_source(const std::string & node_name)
+{
+  return node_name + "#" + std::to_string(std::random_device()());
+}
+
+void ObservationPublisher::add(const plansys2_interface::msg::DetectedMarker & observation)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  queued_.observations.push_back(observation);
+  if (queued_.observations.size() >= options_.max_batch) {
+    send_queued();
+  }
+}
+
+void ObservationPublisher::flush()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  send_queued();
+}
+
+size_t ObservationPublisher::pending() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queued_.observations.size() + in_flight_.size();
+}
+
+uint64_t ObservationPublisher::acknowledged() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return acknowledged_;
+}
+
+uint64_t ObservationPublisher::lost() const
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  return lost_;
+}
+
+void ObservationPublisher::send_queued()
+{
+  if (queued_.observations.empty()) {
+    return;
+  }
+
+  queued_.sequence = next_sequence_++;
+  auto & entry = in_flight_[queued_.sequence];
+  entry.batch = std::move(queued_);
+  entry.sent = std::chrono::steady_clock::now();
+  entry.attempts = 1;
+  batches_pub_->publish(entry.batch);
+
+  queued_ = plansys2_interface::msg::MarkerObservations();
+  queued_.source = source_;
+}
+
+void ObservationPublisher::on_timer()
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  send_queued();
+
+  auto now = std::chrono::steady_clock::now();
+  for (auto it = in_flight_.begin(); it != in_flight_.end(); ) {
+    auto & entry = it->second;
+    if (now - entry.sent < options_.retry_period) {
+      ++it;
+      continue;
+    }
+    if (entry.attempts >= options_.max_attempts) {
+      ++lost_;
+      RCLCPP_ERROR(logger_, "Marker batch %lu (%zu observations) was not acknowledged after "
+        "%d attempts, %lu batches lost", static_cast<unsigned long>(it->first),
+        entry.batch.observations.size(), entry.attempts, static_cast<unsigned long>(lost_));
+      it = in_flight_.erase(it);
+      continue;
+    }
+    RCLCPP_WARN(logger_, "Resending unacknowledged marker batch %lu",
+      static_cast<unsigned long>(it->first));
+    entry.sent = now;
+    ++entry.attempts;
+    batches_pub_->publish(entry.batch);
+    ++it;
+  }
+}
+
+void ObservationPublisher::on_ack(const plansys2_interface::msg::MarkerObservationsAck & ack)
+{
+  if (ack.source != source_) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (in_flight_.erase(ack.sequence) > 0) {
+    ++acknowledged_;
+  }
+}
+
+}  // namespace plansys_interface
@@ -0,0 +1,452 @@
+#include "plansys_interface/path_cost_matrix.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <sstream>
+#include <thread>
+#include <utility>
+
+#include "yaml-cpp/yaml.h"
+
+namespace plansys_interface
+{
+
+static const char PATH_COST_MAGIC[8] = {'P', 'A', 'T', 'H', 'C', 'O', 'S', 'T'};
+
+// Waypoints inside inflated space are moved to the closest free cell within this distance
+static const double SNAP_DISTANCE = 0.5;
+
+static bool read_file(const std::string & path, std::string & contents)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return false;
+  }
+  contents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return true;
+}
+
+static std::string resolve_relative(const std::string & base_file, const std::string & path)
+{
+  if (path.empty() || path[0] == '/') {
+    return path;
+  }
+  auto slash = base_file.find_last_of('/');
+  return slash == std::string::npos ? path : base_file.substr(0, slash + 1) + path;
+}
+
+static bool parse_pgm(
+  const std::string & data, int & width, int & height, int & maxval,
+  size_t & pixels_offset)
+{
+  std::istringstream in(data);
+  std::string magic;
+  in >> magic;
+  if (magic != "P5") {
+    return false;
+  }
+
+  int values[3];
+  for (int & value : values) {
+    in >> std::ws;
+    while (in.peek() == '#') {
+      std::string comment;
+      std::getline(in, comment);
+      in >> std::ws;
+    }
+    if (!(in >> value)) {
+      return false;
+    }
+  }
+  width = values[0];
+  height = values[1];
+  maxval = values[2];
+
+  // Exactly one whitespace character separates the header from the pixels
+  in.get();
+  pixels_offset = static_cast<size_t>(in.tellg());
+  return width > 0 && height > 0 && maxval > 0 && maxval < 256 &&
+         data.size() >= pixels_offset + static_cast<size_t>(width) * height;
+}
+
+bool load_grid_map(const std::string & yaml_path, GridMap & map, std::string & error_message)
+{
+  std::string image_path;
+  double free_thresh;
+  bool negate;
+
+  try {
+    YAML::Node config = YAML::LoadFile(yaml_path);
+    image_path = resolve_relative(yaml_path, config["image"].as<std::string>());
+    map.resolution = config["resolution"].as<double>();
+    auto origin = config["origin"].as<std::vector<double>>();
+    if (origin.size() < 2) {
+      throw YAML::Exception(config["origin"].Mark(), "origin needs at least 2 values");
+    }
+    map.origin_x = origin[0];
+    map.origin_y = origin[1];
+    negate = config["negate"] ? config["negate"].as<int>() != 0 : false;
+    free_thresh = config["free_thresh"].as<double>();
+  } catch (const YAML::Exception & e) {
+    error_message = "Failed to load map " + yaml_path + ": " + e.what();
+    return false;
+  }
+
+  std::string image;
+  if (!read_file(image_path, image)) {
+    error_message = "Failed to read map image " + image_path;
+    return false;
+  }
+
+  int maxval;
+  size_t offset;
+  if (!parse_pgm(image, map.width, map.height, maxval, offset)) {
+    error_message = "Failed to load map image " + image_path + ": not an 8-bit binary PGM";
+    return false;
+  }
+
+  map.free.assign(static_cast<size_t>(map.width) * map.height, 0);
+  auto pixels = reinterpret_cast<const uint8_t *>(image.data() + offset);
+  for (int row = 0; row < map.height; ++row) {
+    // Image rows go top to bottom, grid rows bottom to top
+    const uint8_t * line = pixels + static_cast<size_t>(map.height - 1 - row) * map.width;
+    for (int col = 0; col < map.width; ++col) {
+      double value = static_cast<double>(line[col]) / maxval;
+      double occupancy = negate ? value : 1.0 - value;
+      // Occupied and unknown cells are both treated as obstacles
+      map.free[static_cast<size_t>(row) * map.width + col] = occupancy < free_thresh;
+    }
+  }
+  return true;
+}
+
+// Marks every cell within radius of a non-free cell as not traversable
+static std::vector<uint8_t> inflate(const GridMap & map, double robot_radius)
+{
+  std::vector<uint8_t> free = map.free;
+  const int r = static_cast<int>(std::ceil(robot_radius / map.resolution));
+  if (r <= 0) {
+    return free;
+  }
+
+  std::vector<std::pair<int, int>> disc;
+  for (int dy = -r; dy <= r; ++dy) {
+    for (int dx = -r; dx <= r; ++dx) {
+      if (dx * dx + dy * dy <= r * r) {
+        disc.emplace_back(dx, dy);
+      }
+    }
+  }
+
+  for (int y = 0; y < map.height; ++y) {
+    for (int x = 0; x < map.width; ++x) {
+      if (map.free[static_cast<size_t>(y) * map.width + x]) {
+        continue;
+      }
+      // Only obstacle borders can reach free space
+      bool border = false;
+      for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, map.height - 1) && !border; ++ny) {
+        for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, map.width - 1); ++nx) {
+          if (map.free[static_cast<size_t>(ny) * map.width + nx]) {
+            border = true;
+            break;
+          }
+        }
+      }
+      if (!border) {
+        continue;
+      }
+      for (const auto & d : disc) {
+        int nx = x + d.first, ny = y + d.second;
+        if (nx >= 0 && ny >= 0 && nx < map.width && ny < map.height) {
+          free[static_cast<size_t>(ny) * map.width + nx] = 0;
+        }
+      }
+    }
+  }
+  return free;
+}
+
+// Closest traversable cell to a world position, or -1 if there is none nearby
+static long snap_to_free(const GridMap & map, const std::vector<uint8_t> & free, double x, double y)
+{
+  const int cx = static_cast<int>(std::floor((x - map.origin_x) / map.resolution));
+  const int cy = static_cast<int>(std::floor((y - map.origin_y) / map.resolution));
+  const int r = static_cast<int>(std::ceil(SNAP_DISTANCE / map.resolution));
+
+  long best = -1;
+  int best_d2 = r * r + 1;
+  for (int ny = cy - r; ny <= cy + r; ++ny) {
+    for (int nx = cx - r; nx <= cx + r; ++nx) {
+      if (nx < 0 || ny < 0 || nx >= map.width || ny >= map.height) {
+        continue;
+      }
+      const long idx = static_cast<long>(ny) * map.width + nx;
+      const int d2 = (nx - cx) * (nx - cx) + (ny - cy) * (ny - cy);
+      if (free[idx] && d2 < best_d2) {
+        best = idx;
+        best_d2 = d2;
+      }
+    }
+  }
+  return best;
+}
+
+// 8-connected Dijkstra from source until every target is settled
+static void dijkstra(
+  const GridMap & map, const std::vector<uint8_t> & free, long source,
+  const std::vector<long> & targets, double * out)
+{
+  static const int DX[8] = {1, -1, 0, 0, 1, 1, -1, -1};
+  static const int DY[8] = {0, 0, 1, -1, 1, -1, 1, -1};
+  const double straight = map.resolution;
+  const double diagonal = map.resolution * std::sqrt(2.0);
+
+  std::vector<double> dist(free.size(), PathCostMatrix::UNREACHABLE);
+  std::vector<uint8_t> settled(free.size(), 0);
+  size_t remaining = 0;
+  std::vector<uint8_t> is_target(free.size(), 0);
+  for (long t : targets) {
+    if (t >= 0 && !is_target[t]) {
+      is_target[t] = 1;
+      ++remaining;
+    }
+  }
+
+  using Entry = std::pair<double, long>;
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+  dist[source] = 0.0;
+  open.emplace(0.0, source);
+
+  while (!open.empty() && remaining > 0) {
+    auto [d, idx] = open.top();
+    open.pop();
+    if (settled[idx]) {
+      continue;
+    }
+    settled[idx] = 1;
+    if (is_target[idx]) {
+      --remaining;
+    }
+
+    const int x = static_cast<int>(idx % map.width);
+    const int y = static_cast<int>(idx / map.width);
+    for (int k = 0; k < 8; ++k) {
+      const int nx = x + DX[k], ny = y + DY[k];
+      if (nx < 0 || ny < 0 || nx >= map.width || ny >= map.height) {
+        continue;
+      }
+      const long nidx = static_cast<long>(ny) * map.width + nx;
+      if (!free[nidx]) {
+        continue;
+      }
+      // Do not cut corners of obstacles
+      if (k >= 4 && (!free[static_cast<long>(y) * map.width + nx] ||
+        !free[static_cast<long>(ny) * map.width + x]))
+      {
+        continue;
+      }
+      const double nd = d + (k < 4 ? straight : diagonal);
+      if (nd < dist[nidx]) {
+        dist[nidx] = nd;
+        open.emplace(nd, nidx);
+      }
+    }
+  }
+
+  for (size_t i = 0; i < targets.size(); ++i) {
+    out[i] = targets[i] < 0 ? PathCostMatrix::UNREACHABLE : dist[targets[i]];
+  }
+}
+
+bool PathCostMatrix::compute(
+  const WaypointRegistry & registry, const GridMap & map, double robot_radius,
+  size_t threads, std::string & error_message)
+{
+  const size_t n = registry.size();
+  const std::vector<uint8_t> free = inflate(map, robot_radius);
+
+  std::vector<long> cells(n);
+  for (size_t i = 0; i < n; ++i) {
+    const auto & wp = registry.at(i);
+    cells[i] = snap_to_free(map, free, wp.x, wp.y);
+    if (cells[i] < 0) {
+      error_message = "Waypoint '" + wp.name + "' is not in free space on the map";
+      return false;
+    }
+  }
+
+  std::vector<double> costs(n * n, UNREACHABLE);
+  std::atomic<size_t> next{0};
+  auto worker = [&]() {
+      for (size_t i = next++; i < n; i = next++) {
+        dijkstra(map, free, cells[i], cells, &costs[i * n]);
+      }
+    };
+
+  threads = std::max<size_t>(1, std::min(threads, n));
+  std::vector<std::thread> pool;
+  for (size_t t = 1; t < threads; ++t) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (auto & thread : pool) {
+    thread.join();
+  }
+
+  size_ = n;
+  costs_ = std::move(costs);
+  return true;
+}
+
+bool PathCostMatrix::load_cache(
+  const std::string & path, uint64_t key,
+  std::string & error_message)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    error_message = "No path cost cache at " + path;
+    return false;
+  }
+
+  char magic[8];
+  uint64_t file_key, n;
+  file.read(magic, sizeof(magic));
+  file.read(reinterpret_cast<char *>(&file_key), sizeof(file_key));
+  file.read(reinterpret_cast<char *>(&n), sizeof(n));
+  if (!file || std::memcmp(magic, PATH_COST_MAGIC, sizeof(magic)) != 0 || file_key != key) {
+    error_message = "Path cost cache " + path + " does not match the map and waypoints";
+    return false;
+  }
+
+  std::vector<double> costs(n * n);
+  file.read(reinterpret_cast<char *>(costs.data()), costs.size() * sizeof(double));
+  if (!file) {
+    error_message = "Path cost cache " + path + " is truncated";
+    return false;
+  }
+
+  size_ = n;
+  costs_ = std::move(costs);
+  return true;
+}
+
+bool PathCostMatrix::save_cache(
+  const std::string & path, uint64_t key,
+  std::string & error_message) const
+{
+  // Write next to the destination and rename, so readers never see a partial file
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    const uint64_t n = size_;
+    file.write(PATH_COST_MAGIC, sizeof(PATH_COST_MAGIC));
+    file.write(reinterpret_cast<const char *>(&key), sizeof(key));
+    file.write(reinterpret_cast<const char *>(&n), sizeof(n));
+    file.write(reinterpret_cast<const char *>(costs_.data()), costs_.size() * sizeof(double));
+    if (!file) {
+      error_message = "Failed to write path cost cache " + tmp_path;
+      return false;
+    }
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    error_message = "Failed to write path cost cache " + path;
+    return false;
+  }
+  return true;
+}
+
+static void fnv1a(uint64_t & hash, const void * data, size_t len)
+{
+  auto bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+}
+
+bool path_cost_cache_key(
+  const WaypointRegistry & registry, const std::string & map_yaml_path, double robot_radius,
+  uint64_t & key, std::string & error_message)
+{
+  std::string map_yaml, map_image;
+  if (!read_file(map_yaml_path, map_yaml)) {
+    error_message = "Failed to read map " + map_yaml_path;
+    return false;
+  }
+  try {
+    auto image = YAML::Load(map_yaml)["image"].as<std::string>();
+    if (!read_file(resolve_relative(map_yaml_path, image), map_image)) {
+      error_message = "Failed to read map image " + image;
+      return false;
+    }
+  } catch (const YAML::Exception & e) {
+    error_message = "Failed to load map " + map_yaml_path + ": " + e.what();
+    return false;
+  }
+
+  uint64_t hash = 14695981039346656037ull;
+  fnv1a(hash, map_yaml.data(), map_yaml.size());
+  fnv1a(hash, map_image.data(), map_image.size());
+  fnv1a(hash, &robot_radius, sizeof(robot_radius));
+  for (const auto & wp : registry.waypoints()) {
+    fnv1a(hash, wp.name.data(), wp.name.size() + 1);
+    fnv1a(hash, &wp.x, sizeof(wp.x));
+    fnv1a(hash, &wp.y, sizeof(wp.y));
+  }
+  key = hash;
+  return true;
+}
+
+bool load_or_compute_path_costs(
+  const WaypointRegistry & registry, const std::string & map_yaml_path, double robot_radius,
+  const std::string & cache_dir, PathCostMatrix & costs, bool & from_cache,
+  std::string & error_message)
+{
+  from_cache = false;
+
+  uint64_t key = 0;
+  if (!path_cost_cache_key(registry, map_yaml_path, robot_radius, key, error_message)) {
+    return false;
+  }
+
+  std::string cache_path;
+  if (!cache_dir.empty()) {
+    char name[64];
+    std::snprintf(name, sizeof(name), "path_costs_%016llx.bin",
+      static_cast<unsigned long long>(key));
+    cache_path = cache_dir + "/" + name;
+
+    std::string cache_err;
+    if (costs.load_cache(cache_path, key, cache_err) && costs.size() == registry.size()) {
+      from_cache = true;
+      return true;
+    }
+  }
+
+  GridMap map;
+  if (!load_grid_map(map_yaml_path, map, error_message)) {
+    return false;
+  }
+
+  const size_t threads = std::max(1u, std::thread::hardware_concurrency());
+  if (!costs.compute(registry, map, robot_radius, threads, error_message)) {
+    return false;
+  }
+
+  // A failure to cache is not fatal, the matrix is simply recomputed next time
+  if (!cache_path.empty()) {
+    std::string cache_err;
+    costs.save_cache(cache_path, key, cache_err);
+  }
+  return true;
+}
+
+}  // namespace plansys_interface
@@ -0,0 +1,106 @@
+#include "plansys_interface/photo_writer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <utility>
+#include <vector>
+
+#include "cv_bridge/cv_bridge.hpp"
+#include "opencv2/imgcodecs.hpp"
+#include "opencv2/imgproc.hpp"
+#include "rclcpp/logging.hpp"
+
+namespace plansys_interface
+{
+
+PhotoWriter::PhotoWriter(const rclcpp::Logger & logger, size_t max_queue, int jpeg_quality)
+: logger_(logger), max_queue_(max_queue), jpeg_quality_(jpeg_quality)
+{
+  thread_ = std::thread(&PhotoWriter::run, this);
+}
+
+PhotoWriter::~PhotoWriter()
+{
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    stop_ = true;
+  }
+  cv_.notify_one();
+  // Pending photos are still written before the thread exits
+  thread_.join();
+}
+
+bool PhotoWriter::enqueue(PhotoJob && job)
+{
+  {
+    std::lock_guard<std::mutex> lk(mutex_);
+    if (queue_.size() >= max_queue_) {
+      return false;
+    }
+    queue_.push_back(std::move(job));
+  }
+  cv_.notify_one();
+  return true;
+}
+
+void PhotoWriter::run()
+{
+  std::unique_lock<std::mutex> lk(mutex_);
+  while (true) {
+    cv_.wait(lk, [this] {return stop_ || !queue_.empty();});
+    if (queue_.empty()) {
+      return;
+    }
+    PhotoJob job = std::move(queue_.front());
+    queue_.pop_front();
+
+    lk.unlock();
+    write(job);
+    lk.lock();
+  }
+}
+
+void PhotoWriter::write(const PhotoJob & job)
+{
+  cv::Mat frame;
+  try {
+    frame = cv_bridge::toCvCopy(job.image, "bgr8")->image;
+  } catch (cv_bridge::Exception & e) {
+    RCLCPP_ERROR(logger_, "CV Bridge: %s", e.what());
+    return;
+  }
+
+  const auto & marker = job.marker;
+  int cx = static_cast<int>(marker.center.x);
+  int cy = static_cast<int>(marker.center.y);
+  int r = 0;
+  for (const auto & corner : marker.corners) {
+    r = std::max(r, static_cast<int>(std::hypot(corner.x - cx, corner.y - cy)));
+  }
+  cv::circle(frame, cv::Point(cx, cy), r, cv::Scalar(0, 255, 0), 3);
+  cv::putText(frame, "ID " + std::to_string(marker.marker_id),
+              cv::Point(cx + r + 5, cy),
+              cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 255, 0), 2);
+
+  std::error_code ec;
+  std::filesystem::create_directories(std::filesystem::path(job.path).parent_path(), ec);
+
+  std::vector<int> params;
+  auto ext = std::filesystem::path(job.path).extension().string();
+  if (ext == ".jpg" || ext == ".jpeg") {
+    params = {cv::IMWRITE_JPEG_QUALITY, jpeg_quality_};
+  }
+
+  try {
+    if (cv::imwrite(job.path, frame, params)) {
+      RCLCPP_INFO(logger_, "Saved: %s", job.path.c_str());
+    } else {
+      RCLCPP_ERROR(logger_, "Failed to save %s", job.path.c_str());
+    }
+  } catch (const cv::Exception & e) {
+    RCLCPP_ERROR(logger_, "Failed to save %s: %s", job.path.c_str(), e.what());
+  }
+}
+
+}  // namespace plansys_interface
@@ -1,11 +1,11 @@
-#include "plansys2_executor/ActionExecutorClient.hpp"
+#include "plansys_interface/event_driven_action.hpp"
 #include "rclcpp/rclcpp.hpp"
+#include "rclcpp_components/register_node_macro.hpp"
+#include "plansys_interface/component_startup.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
-#include "geometry_msgs/msg/pose_stamped.hpp"
-#include "nav2_msgs/action/navigate_to_pose.hpp"
-#include "nav_msgs/msg/odometry.hpp"
 #include "sensor_msgs/msg/image.hpp"
-#include "aruco_opencv_msgs/msg/aruco_detection.hpp"
+#include "aruco_opencv_msgs/msg/aruco_image_detection.hpp"
+#include "plansys_interface/photo_writer.hpp"
 #include "cv_bridge/cv_bridge.hpp"
 #include "opencv2/opencv.hpp"
 #include <memory>
@@ -13,156 +13,226 @@
 #include <algorithm>
 #include <cmath>
 #include <chrono>
-#include <filesystem>
+#include <cstdlib>
+#include <deque>
+#include <utility>
 
 using namespace std::chrono_literals;
 
-class PhotographMarkerAction : public plansys2::ActionExecutorClient
+namespace plansys_interface
+{
+
+class PhotographMarkerAction : public EventDrivenActionExecutor
 {
 public:
-  PhotographMarkerAction()
-  : plansys2::ActionExecutorClient("photographmarker", 100ms),
-    waiting_for_photo_(false),
-    photo_taken_(false)
+  // plansys2::ActionExecutorClient takes no NodeOptions, parameters come from the
+  // process arguments
+  explicit PhotographMarkerAction(const rclcpp::NodeOptions & = rclcpp::NodeOptions())
+  : EventDrivenActionExecutor("photographmarker", 100ms)
   {
+    const char * home = std::getenv("HOME");
+    output_dir_ = this->declare_parameter<std::string>(
+      "output_dir", std::string(home ? home : ".") + "/marker_photos");
+    // "png" or "jpg"
+    image_format_ = this->declare_parameter<std::string>("image_format", "png");
+    // Number of frames showing a marker to choose the sharpest photo from
+    burst_frames_ = this->declare_parameter<int>("burst_frames", 5);
+    photo_timeout_ = this->declare_parameter<double>("photo_timeout", 60.0);
+    auto queue_size = this->declare_parameter<int>("writer_queue_size", 4);
+    auto jpeg_quality = this->declare_parameter<int>("jpeg_quality", 95);
+
+    writer_ = std::make_unique<plansys_interface::PhotoWriter>(
+      get_logger(), static_cast<size_t>(std::max(1, queue_size)), jpeg_quality);
 
-    
-    // Subscribe to detection topic to get marker info
-    detection_sub_ = this->create_subscription<aruco_opencv_msgs::msg::ArucoDetection>(
-      "/aruco_detections", 10,
-      [this](const aruco_opencv_msgs::msg::ArucoDetection::SharedPtr msg) {
-        latest_detection_ = msg;
-      }
-    );
-    
-    image_sub_ = this->create_subscription<sensor_msgs::msg::Image>(
-      "/camera/image", 10,
-      [this](const sensor_msgs::msg::Image::SharedPtr msg) {
-        take_photo(msg);
-      }
-    );
-    
-    fx_ = 381.3611602783203;
-    fy_ = 381.3611602783203;
-    cx_ = 320.0;
-    cy_ = 240.0;
-    marker_size_ = 0.0742;
     photo_start_ = this->now();
     RCLCPP_INFO(get_logger(), "PhotographMarkerAction ready");
+
+    startup_timer_ = start_action_executor(this, "photographmarker", true);
   }
 
 private:
-  std::tuple<int, int, int> project_marker(const geometry_msgs::msg::Point& pos, double size)
+  // Camera and detections are only subscribed to while a photo is being taken
+  void start_capture()
   {
-    double x = pos.x, y = pos.y, z = pos.z;
-    if (z <= 0) return {-1, -1, 0};
-    
-    double h = size / 2.0;
-    std::vector<std::tuple<double, double, double>> corners = {
-      {-h, -h, 0}, {h, -h, 0}, {h, h, 0}, {-h, h, 0}
-    };
-    
-    int cu = static_cast<int>(fx_ * x / z + cx_);
-    int cv = static_cast<int>(fy_ * y / z + cy_);
-    
-    int max_r = 0;
-    for (auto [cx, cy, cz] : corners) {
-      double X = x + cx, Y = y + cy, Z = (z + cz > 0) ? z + cz : z;
-      int u = static_cast<int>(fx_ * X / Z + cx_);
-      int v = static_cast<int>(fy_ * Y / Z + cy_);
-      max_r = std::max(max_r, static_cast<int>(std::hypot(u - cu, v - cv)));
-    }
-    return {cu, cv, max_r};
+    recent_images_.clear();
+    best_image_.reset();
+    best_score_ = -1.0;
+    candidate_frames_ = 0;
+
+    image_sub_ = this->create_subscription<sensor_msgs::msg::Image>(
+      "/camera/image", rclcpp::SensorDataQoS(),
+      [this](sensor_msgs::msg::Image::ConstSharedPtr msg) {
+        auto lock = lock_state();
+        recent_images_.push_back(msg);
+        if (recent_images_.size() > MAX_RECENT_IMAGES) {
+          recent_images_.pop_front();
+        }
+      }
+    );
+
+    // Subscribe to image-space detections to get marker corners in pixels
+    detection_sub_ = this->create_subscription<aruco_opencv_msgs::msg::ArucoImageDetection>(
+      "/aruco_image_detections", 10,
+      std::bind(&PhotographMarkerAction::detection_callback, this, std::placeholders::_1)
+    );
   }
 
-  void take_photo(const sensor_msgs::msg::Image::SharedPtr& msg)
+  void stop_capture()
   {
-    if(!waiting_for_photo_)
+    image_sub_.reset();
+    detection_sub_.reset();
+    recent_images_.clear();
+    best_image_.reset();
+  }
+
+  void detection_callback(const aruco_opencv_msgs::msg::ArucoImageDetection::SharedPtr msg)
+  {
+    if (msg->markers.empty()) {
+      return;
+    }
+
+    auto lock = lock_state();
+    // Detections carry the stamp of the image they were computed on
+    auto image = std::find_if(recent_images_.begin(), recent_images_.end(),
+        [&msg](const sensor_msgs::msg::Image::ConstSharedPtr & img) {
+          return img->header.stamp == msg->header.stamp;
+        });
+    if (image == recent_images_.end()) {
       return;
+    }
+
+    // Photograph the closest marker in view
+    const auto & marker = *std::max_element(msg->markers.begin(), msg->markers.end(),
+        [](const auto & a, const auto & b) {return a.size < b.size;});
+
+    double score = score_frame(*image, marker);
+    ++candidate_frames_;
+    if (score > best_score_) {
+      best_score_ = score;
+      best_image_ = *image;
+      best_marker_ = marker;
+    }
+
+    // The burst is complete, save the photo right away
+    if (candidate_frames_ == burst_frames_) {
+      wake();
+    }
+  }
+
+  // Sharpness of the marker region (variance of the Laplacian) weighted by the marker size
+  double score_frame(
+    const sensor_msgs::msg::Image::ConstSharedPtr & image,
+    const aruco_opencv_msgs::msg::MarkerImagePoints & marker)
+  {
+    cv_bridge::CvImageConstPtr cv_ptr;
     try {
-      cv::Mat frame = cv_bridge::toCvShare(msg, "bgr8")->image.clone();
-      
-      // Get marker info from latest detection
-      if (latest_detection_ && !latest_detection_->markers.empty()) {
-        const auto& marker = latest_detection_->markers[0];
-        int id = marker.marker_id;
-        auto [cx, cy, r] = project_marker(marker.pose.position, marker_size_);
-        
-        if (cx >= 0 && cx < frame.cols && cy >= 0 && cy < frame.rows) {
-          cv::circle(frame, cv::Point(cx, cy), r, cv::Scalar(0, 255, 0), 3);
-          cv::putText(frame, "ID " + std::to_string(id),
-                      cv::Point(cx + r + 5, cy),
-                      cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(0, 255, 0), 2);
-          
-          std::filesystem::create_directories("/home/assignments/assignment3/ws/src/plansys_interface/images");
-          std::string filename = "/home/assignments/assignment3/ws/src/plansys_interface/images/" + 
-                                 std::to_string(id) + ".png";
-          cv::imwrite(filename, frame);
-          RCLCPP_INFO(get_logger(), "Saved: %s", filename.c_str());
-          photo_taken_ = true;
-        }
-      } else {
-        return;
-      }
-    } catch (cv_bridge::Exception& e) {
+      cv_ptr = cv_bridge::toCvShare(image);
+    } catch (cv_bridge::Exception & e) {
       RCLCPP_ERROR(get_logger(), "CV Bridge: %s", e.what());
+      return -1.0;
+    }
+
+    float min_x = marker.corners[0].x, max_x = min_x;
+    float min_y = marker.corners[0].y, max_y = min_y;
+    for (const auto & corner : marker.corners) {
+      min_x = std::min(min_x, corner.x);
+      max_x = std::max(max_x, corner.x);
+      min_y = std::min(min_y, corner.y);
+      max_y = std::max(max_y, corner.y);
     }
+    cv::Rect roi = cv::Rect(cv::Point(cvFloor(min_x), cvFloor(min_y)),
+        cv::Point(cvCeil(max_x) + 1, cvCeil(max_y) + 1)) &
+      cv::Rect(0, 0, cv_ptr->image.cols, cv_ptr->image.rows);
+    if (roi.area() == 0) {
+      return -1.0;
+    }
+
+    // Only the marker region is converted, the full frame is never copied here
+    cv::Mat gray;
+    cv::Mat region = cv_ptr->image(roi);
+    if (region.channels() == 1) {
+      gray = region;
+    } else {
+      cv::cvtColor(region, gray, region.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+    }
+    cv::Mat laplacian;
+    cv::Laplacian(gray, laplacian, CV_32F);
+    cv::Scalar mean, stddev;
+    cv::meanStdDev(laplacian, mean, stddev);
+
+    return stddev[0] * stddev[0] * marker.size;
   }
 
-  void do_work() override
+  void on_start() override
   {
     auto args = get_arguments();
     if (args.size() < 3) {
-      finish(false, 0.0, "Insufficient arguments");
+      complete(false, 0.0, "Insufficient arguments");
       return;
     }
-    if(!waiting_for_photo_){
-      photo_start_ = this->now();
-      waiting_for_photo_ = true;
-    }
     std::string marker_name = args[2];
+
     RCLCPP_INFO(get_logger(), "Photograph [%s]", marker_name.c_str());
-    
+    photo_start_ = this->now();
+    start_capture();
+  }
+
+  // Also runs when the action is cancelled
+  void on_stop() override
+  {
+    stop_capture();
+  }
+
+  void step() override
+  {
     auto elapsed = (this->now() - photo_start_).seconds();
-    double progress = elapsed / 60.0;
-    send_feedback(progress, "photographing...");
-      
-    if (photo_taken_) {
-      photo_taken_ = false;
-      waiting_for_photo_ = false;
-      finish(true, 1.0, "Photo saved");
+
+    if (candidate_frames_ >= burst_frames_ && best_image_) {
+      plansys_interface::PhotoJob job;
+      job.image = best_image_;
+      job.marker = best_marker_;
+      job.path = output_dir_ + "/" + std::to_string(best_marker_.marker_id) + "." + image_format_;
+
+      if (!writer_->enqueue(std::move(job))) {
+        RCLCPP_ERROR(get_logger(), "Photo writer queue is full, dropping photo");
+        complete(false, 1.0, "Photo dropped");
+        return;
+      }
+      complete(true, 1.0, "Photo queued");
+      return;
     }
-    
-    if (elapsed > 60.0) {
-      waiting_for_photo_ = false;
-      photo_taken_ = false;
-      finish(false, 1.0, "Photo timeout");
+
+    if (elapsed > photo_timeout_) {
+      complete(false, 1.0, "Photo timeout");
+      return;
     }
-    
-    
+
+    double progress = std::min(elapsed / photo_timeout_, 1.0);
+    set_progress(progress, "photographing...");
   }
-  
-  
-  bool waiting_for_photo_, photo_taken_;
+
+  static constexpr size_t MAX_RECENT_IMAGES = 8;
+
   rclcpp::Time photo_start_;
-  geometry_msgs::msg::Pose start_pose_, current_pose_;
-  aruco_opencv_msgs::msg::ArucoDetection::SharedPtr latest_detection_;
-  double fx_, fy_, cx_, cy_, marker_size_;
-  
-  rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
-  rclcpp::Subscription<aruco_opencv_msgs::msg::ArucoDetection>::SharedPtr detection_sub_;
+  std::string output_dir_;
+  std::string image_format_;
+  int burst_frames_;
+  double photo_timeout_;
+
+  std::deque<sensor_msgs::msg::Image::ConstSharedPtr> recent_images_;
+  sensor_msgs::msg::Image::ConstSharedPtr best_image_;
+  aruco_opencv_msgs::msg::MarkerImagePoints best_marker_;
+  double best_score_ = -1.0;
+  int candidate_frames_ = 0;
+
+  std::unique_ptr<plansys_interface::PhotoWriter> writer_;
+
+  rclcpp::Subscription<aruco_opencv_msgs::msg::ArucoImageDetection>::SharedPtr detection_sub_;
   rclcpp::Subscription<sensor_msgs::msg::Image>::SharedPtr image_sub_;
+
+  rclcpp::TimerBase::SharedPtr startup_timer_;
 };
 
-int main(int argc, char ** argv)
-{
-  rclcpp::init(argc, argv);
-  auto node = std::make_shared<PhotographMarkerAction>();
-  node->set_parameter(rclcpp::Parameter("action_name", "photographmarker"));
-  node->trigger_transition(lifecycle_msgs::msg::Transition::TRANSITION_CONFIGURE);
-  node->trigger_transition(lifecycle_msgs::msg::Transition::TRANSITION_ACTIVATE);
-  rclcpp::spin(node->get_node_base_interface());
-  rclcpp::shutdown();
-  return 0;
-}
+}  // namespace plansys_interface
 
+RCLCPP_COMPONENTS_REGISTER_NODE(plansys_interface::PhotographMarkerAction)
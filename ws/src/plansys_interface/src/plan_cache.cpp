@@ -0,0 +1,131 @@
+#include "plansys_interface/plan_cache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "rclcpp/serialization.hpp"
+#include "rclcpp/serialized_message.hpp"
+
+namespace plansys_interface
+{
+
+static constexpr char PLAN_CACHE_MAGIC[8] = {'P', 'L', 'A', 'N', 'C', 'A', 'C', 'H'};
+
+uint64_t PlanCache::key(const std::string & domain, const std::string & problem)
+{
+  uint64_t hash = 1469598103934665603ull;
+  // The terminating null keeps "ab" + "c" and "a" + "bc" apart
+  for (const std::string * text : {&domain, &problem}) {
+    for (size_t i = 0; i <= text->size(); ++i) {
+      hash ^= static_cast<uint8_t>(text->c_str()[i]);
+      hash *= 1099511628211ull;
+    }
+  }
+  return hash;
+}
+
+std::string PlanCache::path_of(uint64_t key) const
+{
+  char name[64];
+  std::snprintf(name, sizeof(name), "plan_%016llx.bin", static_cast<unsigned long long>(key));
+  return cache_dir_ + "/" + name;
+}
+
+static void write_string(std::ofstream & file, const std::string & text)
+{
+  const uint64_t n = text.size();
+  file.write(reinterpret_cast<const char *>(&n), sizeof(n));
+  file.write(text.data(), text.size());
+}
+
+static bool read_string(std::ifstream & file, std::string & text)
+{
+  uint64_t n = 0;
+  if (!file.read(reinterpret_cast<char *>(&n), sizeof(n)) || n > (1ull << 32)) {
+    return false;
+  }
+  text.resize(n);
+  return static_cast<bool>(file.read(&text[0], n));
+}
+
+bool PlanCache::lookup(
+  const std::string & domain, const std::string & problem,
+  plansys2_msgs::msg::Plan & plan)
+{
+  const uint64_t k = key(domain, problem);
+  auto it = plans_.find(k);
+  if (it != plans_.end() && it->second.domain == domain && it->second.problem == problem) {
+    plan = it->second.plan;
+    return true;
+  }
+  if (cache_dir_.empty()) {
+    return false;
+  }
+
+  std::ifstream file(path_of(k), std::ios::binary);
+  char magic[sizeof(PLAN_CACHE_MAGIC)];
+  std::string cached_domain, cached_problem, data;
+  if (!file.read(magic, sizeof(magic)) ||
+    std::memcmp(magic, PLAN_CACHE_MAGIC, sizeof(magic)) != 0 ||
+    !read_string(file, cached_domain) || !read_string(file, cached_problem) ||
+    !read_string(file, data))
+  {
+    return false;
+  }
+  // The full text is compared, a hash collision must not return a wrong plan
+  if (cached_domain != domain || cached_problem != problem) {
+    return false;
+  }
+
+  rclcpp::SerializedMessage serialized(data.size());
+  auto & raw = serialized.get_rcl_serialized_message();
+  std::memcpy(raw.buffer, data.data(), data.size());
+  raw.buffer_length = data.size();
+  try {
+    rclcpp::Serialization<plansys2_msgs::msg::Plan>().deserialize_message(&serialized, &plan);
+  } catch (const std::exception &) {
+    return false;
+  }
+
+  plans_[k] = Entry{domain, problem, plan};
+  return true;
+}
+
+bool PlanCache::store(
+  const std::string & domain, const std::string & problem,
+  const plansys2_msgs::msg::Plan & plan, std::string & error_message)
+{
+  const uint64_t k = key(domain, problem);
+  plans_[k] = Entry{domain, problem, plan};
+  if (cache_dir_.empty()) {
+    return true;
+  }
+
+  rclcpp::SerializedMessage serialized;
+  rclcpp::Serialization<plansys2_msgs::msg::Plan>().serialize_message(&plan, &serialized);
+  const auto & raw = serialized.get_rcl_serialized_message();
+
+  // Write next to the destination and rename, so readers never see a partial file
+  const std::string path = path_of(k);
+  const std::string tmp_path = path + ".tmp";
+  {
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    file.write(PLAN_CACHE_MAGIC, sizeof(PLAN_CACHE_MAGIC));
+    write_string(file, domain);
+    write_string(file, problem);
+    write_string(file, std::string(reinterpret_cast<const char *>(raw.buffer), raw.buffer_length));
+    if (!file) {
+      error_message = "Failed to write plan cache " + tmp_path;
+      return false;
+    }
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    error_message = "Failed to write plan cache " + path;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace plansys_interface
@@ -1,189 +1,253 @@
-#include "plansys2_executor/ActionExecutorClient.hpp"
+#include "plansys_interface/event_driven_action.hpp"
 #include "rclcpp/rclcpp.hpp"
+#include "rclcpp_components/register_node_macro.hpp"
+#include "plansys_interface/component_startup.hpp"
 #include "rclcpp_action/rclcpp_action.hpp"
 #include "geometry_msgs/msg/twist.hpp"
 #include "geometry_msgs/msg/pose_stamped.hpp"
 #include "nav_msgs/msg/odometry.hpp"
-#include "aruco_opencv_msgs/msg/aruco_detection.hpp"
-#include "plansys2_interface/srv/get_marker_pose.hpp"
+#include "aruco_opencv_msgs/msg/aruco_image_detection.hpp"
+#include "plansys2_interface/msg/detected_markers.hpp"
+#include "plansys_interface/observation_publisher.hpp"
+#include "plansys_interface/scan_scheduler.hpp"
 #include <memory>
 #include <string>
 #include <algorithm>
 #include <cmath>
 #include <chrono>
-#include <mutex>
+#include <map>
+#include <set>
+#include <vector>
 
 using namespace std::chrono_literals;
 
-class RotateAndDetectAction : public plansys2::ActionExecutorClient
+namespace plansys_interface
+{
+
+class RotateAndDetectAction : public EventDrivenActionExecutor
 {
 public:
-  RotateAndDetectAction()
-  : plansys2::ActionExecutorClient("rotateanddetect", 100ms),
-    rotation_active_(false),
-    marker_detected_(false),
-    current_marker_id_(-1),
+  // plansys2::ActionExecutorClient takes no NodeOptions, parameters come from the
+  // process arguments
+  explicit RotateAndDetectAction(const rclcpp::NodeOptions & = rclcpp::NodeOptions())
+  : EventDrivenActionExecutor("rotateanddetect", 100ms),
     detection_start_time_()
   {
+    plansys_interface::ScanConfig config;
+    config.camera_hfov = this->declare_parameter<double>("camera_hfov", config.camera_hfov);
+    config.frames_per_view =
+      this->declare_parameter<int>("frames_per_view", config.frames_per_view);
+    config.max_speed = this->declare_parameter<double>("max_rotation_speed", config.max_speed);
+    config.candidate_speed =
+      this->declare_parameter<double>("candidate_rotation_speed", config.candidate_speed);
+    config.confirm_frames = this->declare_parameter<int>("confirm_frames", config.confirm_frames);
+    config.min_marker_size =
+      this->declare_parameter<double>("min_marker_size", config.min_marker_size);
+    config.max_reprojection_error =
+      this->declare_parameter<double>("max_reprojection_error", config.max_reprojection_error);
+    scheduler_ = plansys_interface::ScanScheduler(config);
+
+    // Keep turning for a full sweep and register every marker seen, instead of the first one
+    scan_all_ = this->declare_parameter<bool>("scan_all", false);
+    scan_timeout_ = this->declare_parameter<double>("scan_timeout", 60.0);
+
     // Publisher for cmd_vel to rotate the robot
     cmd_vel_pub_ = this->create_publisher<geometry_msgs::msg::Twist>("/cmd_vel", 10);
-    
+
     // Subscriber for odometry to get robot pose
     odom_sub_ = this->create_subscription<nav_msgs::msg::Odometry>(
       "/odom", 10,
       std::bind(&RotateAndDetectAction::odom_callback, this, std::placeholders::_1)
     );
-    
-    // Subscriber for marker detection
-    detection_sub_ = this->create_subscription<aruco_opencv_msgs::msg::ArucoDetection>(
-      "/aruco_detections", 10,
+
+    // Per-frame image detections, published for every frame including empty ones
+    detection_sub_ = this->create_subscription<aruco_opencv_msgs::msg::ArucoImageDetection>(
+      "/aruco_image_detections", 10,
       std::bind(&RotateAndDetectAction::detection_callback, this, std::placeholders::_1)
     );
-    
-    // Service client to register markers in world node
-    world_client_ = this->create_client<plansys2_interface::srv::GetMarkerPose>(
-      "/world_node/add_marker"
+
+    // Markers restored by the world node let us skip waypoints that were already scanned
+    known_markers_sub_ = this->create_subscription<plansys2_interface::msg::DetectedMarkers>(
+      "/world_node/detected_markers", rclcpp::QoS(1).reliable().transient_local(),
+      std::bind(&RotateAndDetectAction::known_markers_callback, this, std::placeholders::_1)
     );
-    
+
+    // Markers are streamed to the world node without waiting for it, lost batches are logged
+    marker_publisher_ = std::make_unique<plansys_interface::ObservationPublisher>(this);
+    // A robot launched in a namespace reports under its namespace
+    robot_name_ = std::string(this->get_namespace()).substr(1);
+
     RCLCPP_INFO(get_logger(), "RotateAndDetectAction initialized");
+
+    startup_timer_ = start_action_executor(this, "rotateanddetect", true);
   }
 
 private:
   void odom_callback(const nav_msgs::msg::Odometry::SharedPtr msg)
   {
+    auto lock = lock_state();
     // Store the robot's current pose when marker is detected
     robot_pose_ = msg->pose.pose;
+
+    if (running()) {
+      const auto & q = robot_pose_.orientation;
+      double yaw = std::atan2(2.0 * (q.w * q.z + q.x * q.y), 1.0 - 2.0 * (q.y * q.y + q.z * q.z));
+      bool was_complete = scheduler_.sweep_complete();
+      scheduler_.on_yaw(yaw);
+      // A finished sweep ends the scan, with or without markers
+      if (!was_complete && scheduler_.sweep_complete()) {
+        wake();
+      }
+    }
   }
-  
-  void detection_callback(const aruco_opencv_msgs::msg::ArucoDetection::SharedPtr msg)
+
+  void known_markers_callback(const plansys2_interface::msg::DetectedMarkers::SharedPtr msg)
   {
-    
-    if (!rotation_active_) return;
-    if (msg->markers.empty()) return;
-    
-    // Take the first detected marker
-    const auto& marker = msg->markers[0];
-    RCLCPP_INFO(get_logger(), "Detected marker ID: %d", marker.marker_id);
-    
-    marker_detected_ = true;
-    current_marker_id_ = marker.marker_id;
-    // Store the robot pose (orientation) when marker is detected
-    // The robot_pose_ is updated via odom_callback
-    detected_pose_ = robot_pose_;
-    
-    // Stop rotating
-    geometry_msgs::msg::Twist stop_cmd;
-    cmd_vel_pub_->publish(stop_cmd);
+    auto lock = lock_state();
+    scanned_wps_.clear();
+    for (const auto & marker : msg->markers) {
+      scanned_wps_.insert(marker.wp);
+    }
   }
 
-  void do_work() override
+  void detection_callback(const aruco_opencv_msgs::msg::ArucoImageDetection::SharedPtr msg)
+  {
+    if (!running()) return;
+
+    auto lock = lock_state();
+    observations_.clear();
+    for (const auto & marker : msg->markers) {
+      observations_.push_back({marker.marker_id, marker.size, marker.reprojection_error});
+    }
+
+    auto stamp = rclcpp::Time(msg->header.stamp).seconds();
+    auto newly_confirmed = scheduler_.on_frame(stamp, observations_);
+    for (int marker_id : newly_confirmed) {
+      RCLCPP_INFO(get_logger(), "Detected marker ID: %d", marker_id);
+      // Store the robot pose (orientation) when marker is confirmed
+      detected_poses_[marker_id] = robot_pose_;
+      detected_stamps_[marker_id] = msg->header.stamp;
+    }
+
+    // Slow down as soon as a candidate shows up, without waiting for the next tick
+    publish_rotation(scheduler_.rotation_speed());
+
+    // A confirmation can end the scan, react to it right away
+    if (!newly_confirmed.empty()) {
+      wake();
+    }
+  }
+
+  void publish_rotation(double speed)
+  {
+    geometry_msgs::msg::Twist cmd;
+    cmd.angular.z = speed;
+    cmd_vel_pub_->publish(cmd);
+  }
+
+  void on_start() override
   {
     auto args = get_arguments();
-    
+
     // Expected: rotate-and-detect ?r ?w ?m
     if (args.size() < 3) {
       RCLCPP_ERROR(get_logger(), "Not enough arguments");
-      finish(false, 0.0, "Insufficient arguments");
+      complete(false, 0.0, "Insufficient arguments");
       return;
     }
-    
+
     current_wp_ = args[1];
     std::string marker_name = args[2];
-    
-    RCLCPP_INFO(get_logger(), "Rotate-and-detect at [%s] for [%s]", current_wp_.c_str(), marker_name.c_str());
-    
-    if (!rotation_active_ && !marker_detected_) {
-      rotation_active_ = true;
-      marker_detected_ = false;
-      detection_start_time_ = this->now();
-      
-      // Start rotating
-      geometry_msgs::msg::Twist rotate_cmd;
-      rotate_cmd.linear.x = 0.0;
-      rotate_cmd.angular.z = 0.5;
-      cmd_vel_pub_->publish(rotate_cmd);
-      RCLCPP_INFO(get_logger(), "Started rotating to detect marker...");
+
+    if (scanned_wps_.count(current_wp_)) {
+      RCLCPP_INFO(get_logger(), "Marker at [%s] already known, skipping scan", current_wp_.c_str());
+      complete(true, 1.0, "Marker already known");
+      return;
     }
-    
-    // Check timeout (10 seconds)
+
+    RCLCPP_INFO(get_logger(), "Rotate-and-detect at [%s] for [%s]", current_wp_.c_str(), marker_name.c_str());
+    scheduler_.reset();
+    detected_poses_.clear();
+    detected_stamps_.clear();
+    detection_start_time_ = this->now();
+    RCLCPP_INFO(get_logger(), "Started rotating to detect marker...");
+  }
+
+  // Also runs when the action is cancelled, the robot must not keep turning
+  void on_stop() override
+  {
+    publish_rotation(0.0);
+  }
+
+  void step() override
+  {
+    publish_rotation(scheduler_.rotation_speed());
+
+    const auto & confirmed = scheduler_.confirmed();
+    bool done = scan_all_ ? scheduler_.sweep_complete() : !confirmed.empty();
+
+    // A full turn without a confirmed marker will not find one by turning further
     auto elapsed = (this->now() - detection_start_time_).seconds();
-    
-    if (elapsed > 60) {
-      RCLCPP_WARN(get_logger(), "Detection timeout");
-      geometry_msgs::msg::Twist stop_cmd;
-      cmd_vel_pub_->publish(stop_cmd);
-      rotation_active_ = false;
-      marker_detected_ = false;
-      finish(false, 0.0, "Marker not detected");
+    if (!done && (elapsed > scan_timeout_ || scheduler_.sweep_complete())) {
+      RCLCPP_WARN(get_logger(), "Detection failed after %.1f s (%.0f deg swept)",
+                  elapsed, scheduler_.swept_angle() * 180.0 / M_PI);
+      complete(false, 0.0, "Marker not detected");
       return;
     }
-    
-    double progress = elapsed / 60.0;
-    send_feedback(progress, "Rotating to detect...");
-    
-    {
-      if (marker_detected_) {
-        geometry_msgs::msg::Twist stop_cmd;
-        cmd_vel_pub_->publish(stop_cmd);
-        rotation_active_ = false;
-        marker_detected_ = false;
-        
-        // Register marker in world node
-        register_marker(current_marker_id_);
-        
-        RCLCPP_INFO(get_logger(), "Marker %d detected and registered", current_marker_id_);
-        finish(true, 1.0, "Marker detected");
-      }
+
+    if (!done) {
+      double progress = std::min(scheduler_.swept_angle() / (2.0 * M_PI), 1.0);
+      set_progress(progress, "Rotating to detect...");
+      return;
+    }
+
+    if (confirmed.empty()) {
+      complete(false, 0.0, "Marker not detected");
+      return;
+    }
+
+    // Register markers in world node
+    for (int marker_id : confirmed) {
+      register_marker(marker_id, detected_poses_[marker_id]);
     }
+    marker_publisher_->flush();
+
+    RCLCPP_INFO(get_logger(), "%zu marker(s) detected and registered in %.1f s at %.1f fps",
+                confirmed.size(), elapsed, scheduler_.frame_rate());
+    complete(true, 1.0, "Marker detected");
   }
-  
-  bool register_marker(int marker_id)
+
+  void register_marker(int marker_id, const geometry_msgs::msg::Pose & pose)
   {
-    auto request = std::make_shared<plansys2_interface::srv::GetMarkerPose::Request>();
-    request->marker_id = marker_id;
-    request->wp = current_wp_;
-    
-    if (!world_client_->wait_for_service(1s)) {
-      RCLCPP_WARN(get_logger(), "World node service not available");
-      return false;
-    }
-    
-    auto future = world_client_->async_send_request(request);
-    return true;
-    // auto result = future.get();
-    
-    // if (result->success) {
-    //   RCLCPP_INFO(get_logger(), "Registered marker %d in world node", marker_id);
-    //   return true;
-    // } else {
-    //   RCLCPP_ERROR(get_logger(), "Failed to register marker %d", marker_id);
-    //   return false;
-    // }
+    plansys2_interface::msg::DetectedMarker observation;
+    observation.marker_id = marker_id;
+    observation.wp = current_wp_;
+    observation.robot_pose = pose;
+    observation.robot = robot_name_;
+    observation.stamp = detected_stamps_[marker_id];
+    marker_publisher_->add(observation);
   }
-  
-  bool rotation_active_;
-  bool marker_detected_;
-  int current_marker_id_;
+
+  bool scan_all_;
+  double scan_timeout_;
   rclcpp::Time detection_start_time_;
-  geometry_msgs::msg::Pose detected_pose_;
+  plansys_interface::ScanScheduler scheduler_;
+  std::vector<plansys_interface::MarkerObservation> observations_;
+  std::map<int, geometry_msgs::msg::Pose> detected_poses_;
+  std::map<int, builtin_interfaces::msg::Time> detected_stamps_;
   geometry_msgs::msg::Pose robot_pose_;
-  std::mutex mutex_;
   std::string current_wp_;
+  std::set<std::string> scanned_wps_;
   rclcpp::Publisher<geometry_msgs::msg::Twist>::SharedPtr cmd_vel_pub_;
   rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
-  rclcpp::Subscription<aruco_opencv_msgs::msg::ArucoDetection>::SharedPtr detection_sub_;
-  rclcpp::Client<plansys2_interface::srv::GetMarkerPose>::SharedPtr world_client_;
+  rclcpp::Subscription<aruco_opencv_msgs::msg::ArucoImageDetection>::SharedPtr detection_sub_;
+  rclcpp::Subscription<plansys2_interface::msg::DetectedMarkers>::SharedPtr known_markers_sub_;
+  std::unique_ptr<plansys_interface::ObservationPublisher> marker_publisher_;
+  std::string robot_name_;
+
+  rclcpp::TimerBase::SharedPtr startup_timer_;
 };
 
-int main(int argc, char ** argv)
-{
-  rclcpp::init(argc, argv);
-  auto node = std::make_shared<RotateAndDetectAction>();
-  node->set_parameter(rclcpp::Parameter("action_name", "rotateanddetect"));
-  node->trigger_transition(lifecycle_msgs::msg::Transition::TRANSITION_CONFIGURE);
-  node->trigger_transition(lifecycle_msgs::msg::Transition::TRANSITION_ACTIVATE);
-  rclcpp::spin(node->get_node_base_interface());
-  rclcpp::shutdown();
-  return 0;
-}
+}  // namespace plansys_interface
 
+RCLCPP_COMPONENTS_REGISTER_NODE(plansys_interface::RotateAndDetectAction)
@@ -0,0 +1,145 @@
+#include "plansys_interface/tour_optimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+
+namespace plansys_interface
+{
+
+// Held-Karp dynamic programming over subsets of stops
+static std::vector<size_t> exact_tour(
+  const PathCostMatrix & costs, size_t start, const std::vector<size_t> & stops)
+{
+  const size_t n = stops.size();
+  const size_t subsets = size_t{1} << n;
+  const double inf = std::numeric_limits<double>::infinity();
+
+  // best[mask * n + last]: cheapest path from start through mask, ending at stops[last]
+  std::vector<double> best(subsets * n, inf);
+  std::vector<uint8_t> parent(subsets * n, 0);
+  for (size_t i = 0; i < n; ++i) {
+    best[(size_t{1} << i) * n + i] = costs.cost(start, stops[i]);
+  }
+
+  for (size_t mask = 1; mask < subsets; ++mask) {
+    for (size_t last = 0; last < n; ++last) {
+      const double base = best[mask * n + last];
+      if (!(mask & (size_t{1} << last)) || base == inf) {
+        continue;
+      }
+      for (size_t next = 0; next < n; ++next) {
+        if (mask & (size_t{1} << next)) {
+          continue;
+        }
+        const size_t next_mask = mask | (size_t{1} << next);
+        const double cost = base + costs.cost(stops[last], stops[next]);
+        if (cost < best[next_mask * n + next]) {
+          best[next_mask * n + next] = cost;
+          parent[next_mask * n + next] = static_cast<uint8_t>(last);
+        }
+      }
+    }
+  }
+
+  const size_t full = subsets - 1;
+  size_t last = 0;
+  for (size_t i = 1; i < n; ++i) {
+    if (best[full * n + i] < best[full * n + last]) {
+      last = i;
+    }
+  }
+
+  std::vector<size_t> order(n);
+  size_t mask = full;
+  for (size_t k = n; k-- > 0; ) {
+    order[k] = stops[last];
+    const size_t prev = parent[mask * n + last];
+    mask &= ~(size_t{1} << last);
+    last = prev;
+  }
+  return order;
+}
+
+static std::vector<size_t> heuristic_tour(
+  const PathCostMatrix & costs, size_t start, const std::vector<size_t> & stops)
+{
+  // Nearest neighbour construction
+  std::vector<size_t> remaining = stops;
+  std::vector<size_t> order;
+  order.reserve(stops.size());
+  size_t current = start;
+  while (!remaining.empty()) {
+    auto nearest = std::min_element(remaining.begin(), remaining.end(),
+        [&](size_t a, size_t b) {return costs.cost(current, a) < costs.cost(current, b);});
+    current = *nearest;
+    order.push_back(current);
+    remaining.erase(nearest);
+  }
+
+  // 2-opt on the open path, the start stays fixed
+  bool improved = true;
+  while (improved) {
+    improved = false;
+    for (size_t i = 0; i + 1 < order.size(); ++i) {
+      const size_t before = i == 0 ? start : order[i - 1];
+      for (size_t j = i + 1; j < order.size(); ++j) {
+        const double old_cost = costs.cost(before, order[i]) +
+          (j + 1 < order.size() ? costs.cost(order[j], order[j + 1]) : 0.0);
+        const double new_cost = costs.cost(before, order[j]) +
+          (j + 1 < order.size() ? costs.cost(order[i], order[j + 1]) : 0.0);
+        if (new_cost + 1e-9 < old_cost) {
+          std::reverse(order.begin() + i, order.begin() + j + 1);
+          improved = true;
+        }
+      }
+    }
+  }
+  return order;
+}
+
+bool optimise_tour(
+  const PathCostMatrix & costs, size_t start, const std::vector<size_t> & stops,
+  std::vector<size_t> & order, std::string & error_message)
+{
+  std::vector<size_t> tour;
+  if (stops.size() <= 1) {
+    tour = stops;
+  } else if (stops.size() <= MAX_EXACT_STOPS) {
+    tour = exact_tour(costs, start, stops);
+  } else {
+    tour = heuristic_tour(costs, start, stops);
+  }
+
+  order.clear();
+  // Without a finite tour the reconstruction above is meaningless and may repeat stops
+  if (!std::isfinite(tour_cost(costs, start, tour))) {
+    error_message = "Some stops cannot be reached on the map";
+    return false;
+  }
+  std::vector<size_t> sorted_tour = tour;
+  std::vector<size_t> sorted_stops = stops;
+  std::sort(sorted_tour.begin(), sorted_tour.end());
+  std::sort(sorted_stops.begin(), sorted_stops.end());
+  if (sorted_tour != sorted_stops) {
+    error_message = "Tour does not visit every stop exactly once";
+    return false;
+  }
+  order = std::move(tour);
+  return true;
+}
+
+double tour_cost(const PathCostMatrix & costs, size_t start, const std::vector<size_t> & order)
+{
+  double total = 0.0;
+  size_t current = start;
+  for (size_t stop : order) {
+    total += costs.cost(current, stop);
+    current = stop;
+  }
+  return total;
+}
+
+}  // namespace plansys_interface
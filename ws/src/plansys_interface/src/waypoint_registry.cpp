@@ -0,0 +1,58 @@
+#include "plansys_interface/waypoint_registry.hpp"
+
+#include <utility>
+
+#include "yaml-cpp/yaml.h"
+
+namespace plansys_interface
+{
+
+bool WaypointRegistry::load_from_file(const std::string & path, std::string & error_message)
+{
+  std::vector<Waypoint> waypoints;
+  std::unordered_map<std::string, size_t> index;
+
+  try {
+    YAML::Node root = YAML::LoadFile(path);
+    YAML::Node list = root["waypoints"];
+    if (!list || !list.IsMap()) {
+      error_message = "Failed to load waypoints from " + path + ": missing 'waypoints' map";
+      return false;
+    }
+
+    for (const auto & entry : list) {
+      Waypoint wp;
+      wp.name = entry.first.as<std::string>();
+      wp.x = entry.second["x"].as<double>();
+      wp.y = entry.second["y"].as<double>();
+      wp.yaw = entry.second["yaw"] ? entry.second["yaw"].as<double>() : 0.0;
+
+      if (!index.emplace(wp.name, waypoints.size()).second) {
+        error_message = "Failed to load waypoints from " + path + ": duplicate '" + wp.name + "'";
+        return false;
+      }
+      waypoints.push_back(wp);
+    }
+  } catch (const YAML::Exception & e) {
+    error_message = "Failed to load waypoints from " + path + ": " + e.what();
+    return false;
+  }
+
+  waypoints_ = std::move(waypoints);
+  index_ = std::move(index);
+  return true;
+}
+
+const Waypoint * WaypointRegistry::find(const std::string & name) const
+{
+  auto it = index_.find(name);
+  return it == index_.end() ? nullptr : &waypoints_[it->second];
+}
+
+size_t WaypointRegistry::index_of(const std::string & name) const
+{
+  auto it = index_.find(name);
+  return it == index_.end() ? npos : it->second;
+}
+
+}  // namespace plansys_interface
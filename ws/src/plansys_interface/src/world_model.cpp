@@ -0,0 +1,154 @@
+#include "plansys_interface/world_model.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+namespace plansys_interface
+{
+
+WorldModel::WorldModel(size_t shards)
+: shards_(new Shard[std::max<size_t>(shards, 1)]),
+  shard_count_(std::max<size_t>(shards, 1)),
+  snapshot_(std::make_shared<MarkerStore>())
+{
+}
+
+WorldModel::Shard & WorldModel::shard_for(int marker_id)
+{
+  return shards_[static_cast<uint32_t>(marker_id) % shard_count_];
+}
+
+bool WorldModel::supersedes(const MarkerInfo & a, const MarkerInfo & b)
+{
+  if (a.stamp_ns != b.stamp_ns) {
+    return a.stamp_ns > b.stamp_ns;
+  }
+  if (a.robot != b.robot) {
+    return a.robot < b.robot;
+  }
+  const auto & pa = a.robot_pose.position;
+  const auto & pb = b.robot_pose.position;
+  return std::tie(a.robot_wp, pa.x, pa.y, pa.z) < std::tie(b.robot_wp, pb.x, pb.y, pb.z);
+}
+
+void WorldModel::load(const MarkerStore & store)
+{
+  size_t count = 0;
+  for (size_t i = 0; i < shard_count_; ++i) {
+    std::lock_guard<std::mutex> lock(shards_[i].mutex);
+    shards_[i].markers.clear();
+    shards_[i].changed.clear();
+  }
+  for (const auto & info : store) {
+    auto & shard = shard_for(info.marker_id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.markers[info.marker_id] = info;
+    ++count;
+  }
+  size_ = count;
+  version_.fetch_add(1);
+}
+
+WorldModel::Result WorldModel::report(const MarkerInfo & info, MarkerInfo & kept)
+{
+  auto & shard = shard_for(info.marker_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  auto it = shard.markers.find(info.marker_id);
+  Result result;
+  if (it == shard.markers.end()) {
+    it = shard.markers.emplace(info.marker_id, info).first;
+    size_.fetch_add(1, std::memory_order_relaxed);
+    result = Result::ADDED;
+  } else if (!supersedes(info, it->second)) {
+    kept = it->second;
+    return Result::REJECTED;
+  } else {
+    // A newer stamp or another robot changes the entry as much as a new
+    // location does, so that snapshots and the listener never miss it
+    it->second = info;
+    result = Result::UPDATED;
+  }
+
+  kept = it->second;
+  shard.changed.insert(info.marker_id);
+  version_.fetch_add(1);
+  if (listener_) {
+    listener_(info, false);
+  }
+  return result;
+}
+
+bool WorldModel::remove(int marker_id)
+{
+  auto & shard = shard_for(marker_id);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+
+  auto it = shard.markers.find(marker_id);
+  if (it == shard.markers.end()) {
+    return false;
+  }
+  MarkerInfo info = std::move(it->second);
+  shard.markers.erase(it);
+  size_.fetch_sub(1, std::memory_order_relaxed);
+  shard.changed.insert(marker_id);
+  version_.fetch_add(1);
+  if (listener_) {
+    listener_(info, true);
+  }
+  return true;
+}
+
+std::shared_ptr<const MarkerStore> WorldModel::snapshot() const
+{
+  std::lock_guard<std::mutex> lock(snapshot_mutex_);
+  uint64_t version = version_.load();
+  if (version == snapshot_version_) {
+    return snapshot_;
+  }
+
+  // Changes made while collecting are picked up by the next rebuild
+  std::vector<MarkerInfo> markers;
+  markers.reserve(size());
+  for (size_t i = 0; i < shard_count_; ++i) {
+    std::lock_guard<std::mutex> shard_lock(shards_[i].mutex);
+    for (const auto & entry : shards_[i].markers) {
+      markers.push_back(entry.second);
+    }
+  }
+  std::sort(markers.begin(), markers.end(),
+    [](const MarkerInfo & a, const MarkerInfo & b) {return a.marker_id < b.marker_id;});
+
+  auto store = std::make_shared<MarkerStore>();
+  for (const auto & info : markers) {
+    store->upsert(info);
+  }
+  snapshot_ = std::move(store);
+  snapshot_version_ = version;
+  return snapshot_;
+}
+
+bool WorldModel::take_changes(std::vector<MarkerInfo> & upserted, std::vector<int> & removed)
+{
+  upserted.clear();
+  removed.clear();
+  for (size_t i = 0; i < shard_count_; ++i) {
+    auto & shard = shards_[i];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    for (int marker_id : shard.changed) {
+      auto it = shard.markers.find(marker_id);
+      if (it != shard.markers.end()) {
+        upserted.push_back(it->second);
+      } else {
+        removed.push_back(marker_id);
+      }
+    }
+    shard.changed.clear();
+  }
+  std::sort(upserted.begin(), upserted.end(),
+    [](const MarkerInfo & a, const MarkerInfo & b) {return a.marker_id < b.marker_id;});
+  std::sort(removed.begin(), removed.end());
+  return !upserted.empty() || !removed.empty();
+}
+
+}  // namespace plansys_interface
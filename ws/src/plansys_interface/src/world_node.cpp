@@ -1,138 +1,449 @@
 #include "rclcpp/rclcpp.hpp"
+#include "rclcpp_components/register_node_macro.hpp"
 #include "geometry_msgs/msg/pose.hpp"
 #include "plansys2_interface/srv/get_marker_pose.hpp"
+#include "plansys2_interface/srv/get_marker_range.hpp"
+#include "plansys2_interface/srv/get_nearest_markers.hpp"
+#include "plansys2_interface/srv/get_waypoint_markers.hpp"
 #include "plansys2_interface/msg/detected_markers.hpp"
-#include <unordered_map>
-#include <vector>
+#include "plansys2_interface/msg/detected_markers_delta.hpp"
+#include "plansys2_interface/msg/marker_observations.hpp"
+#include "plansys2_interface/msg/marker_observations_ack.hpp"
+#include "plansys_interface/landmark_log.hpp"
+#include "plansys_interface/marker_store.hpp"
+#include "plansys_interface/world_model.hpp"
 #include <algorithm>
+#include <atomic>
+#include <map>
+#include <set>
+#include <vector>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <chrono>
+#include <cmath>
+#include <utility>
 
 using namespace std::chrono_literals;
+using plansys_interface::LandmarkLog;
+using plansys_interface::MarkerInfo;
+using plansys_interface::MarkerStore;
+using plansys_interface::WorldModel;
 
-struct MarkerInfo {
-  int marker_id;
-  std::string robot_wp;
-};
+namespace plansys_interface
+{
 
+// World model shared by all robots. Every service may run concurrently on a
+// multi-threaded executor; markers live in a sharded WorldModel and the ordered
+// queries read its snapshot.
 class WorldNode : public rclcpp::Node
 {
 public:
-  WorldNode()
-  : Node("world_node")
+  explicit WorldNode(const rclcpp::NodeOptions & options = rclcpp::NodeOptions())
+  : Node("world_node", options),
+    // Marker map shards, each one locked on its own
+    world_(std::max<int64_t>(this->declare_parameter<int64_t>("shards", 16), 1))
   {
+    // Markers are persisted here and restored on startup, empty to keep them in memory only
+    auto store_path = this->declare_parameter<std::string>("landmark_store_path", "");
+    // Flush every change to disk, otherwise changes only survive a crash of this process
+    auto sync_writes = this->declare_parameter<bool>("sync_writes", true);
+    // Robot namespaces; /<robot>/world_node/add_marker registers markers on behalf of <robot>
+    auto robots = this->declare_parameter<std::vector<std::string>>(
+      "robots", std::vector<std::string>());
+
+    if (!store_path.empty()) {
+      std::string err;
+      MarkerStore restored;
+      if (landmark_log_.open(store_path, sync_writes, restored, err)) {
+        world_.load(restored);
+        RCLCPP_INFO(get_logger(), "Restored %zu markers from %s (%lu records)",
+                    restored.size(), store_path.c_str(),
+                    static_cast<unsigned long>(landmark_log_.record_count()));
+      } else {
+        RCLCPP_ERROR(get_logger(), "%s, markers will not be persisted", err.c_str());
+      }
+    }
+    world_.set_listener(std::bind(&WorldNode::persist, this,
+      std::placeholders::_1, std::placeholders::_2));
+
+    services_group_ = this->create_callback_group(rclcpp::CallbackGroupType::Reentrant);
+
     // Service to add a detected marker
     add_marker_srv_ = this->create_service<plansys2_interface::srv::GetMarkerPose>(
       "/world_node/add_marker",
-      std::bind(&WorldNode::add_marker_callback, this,
-                std::placeholders::_1, std::placeholders::_2)
+      std::bind(&WorldNode::add_marker_callback, this, std::string(),
+                std::placeholders::_1, std::placeholders::_2),
+      rclcpp::ServicesQoS(), services_group_
+    );
+
+    for (const auto & robot : robots) {
+      robot_add_marker_srvs_.push_back(
+        this->create_service<plansys2_interface::srv::GetMarkerPose>(
+          "/" + robot + "/world_node/add_marker",
+          std::bind(&WorldNode::add_marker_callback, this, robot,
+                    std::placeholders::_1, std::placeholders::_2),
+          rclcpp::ServicesQoS(), services_group_));
+    }
+
+    // Service to remove a marker from the world model
+    remove_marker_srv_ = this->create_service<plansys2_interface::srv::GetMarkerPose>(
+      "/world_node/remove_marker",
+      std::bind(&WorldNode::remove_marker_callback, this,
+                std::placeholders::_1, std::placeholders::_2),
+      rclcpp::ServicesQoS(), services_group_
     );
-    
+
     // Service to get nth lowest marker by ID
     get_nth_marker_srv_ = this->create_service<plansys2_interface::srv::GetMarkerPose>(
       "/world_node/get_nth_marker",
       std::bind(&WorldNode::get_nth_marker_callback, this,
-                std::placeholders::_1, std::placeholders::_2)
+                std::placeholders::_1, std::placeholders::_2),
+      rclcpp::ServicesQoS(), services_group_
     );
-    
-    // Publisher for all detected markers
+
+    // Service to get a range of markers in ID order in one call
+    get_markers_srv_ = this->create_service<plansys2_interface::srv::GetMarkerRange>(
+      "/world_node/get_markers",
+      std::bind(&WorldNode::get_markers_callback, this,
+                std::placeholders::_1, std::placeholders::_2),
+      rclcpp::ServicesQoS(), services_group_
+    );
+
+    // Spatial queries over the robot poses the markers were detected from
+    get_nearest_markers_srv_ = this->create_service<plansys2_interface::srv::GetNearestMarkers>(
+      "/world_node/get_nearest_markers",
+      std::bind(&WorldNode::get_nearest_markers_callback, this,
+                std::placeholders::_1, std::placeholders::_2),
+      rclcpp::ServicesQoS(), services_group_
+    );
+
+    get_waypoint_markers_srv_ =
+      this->create_service<plansys2_interface::srv::GetWaypointMarkers>(
+      "/world_node/get_waypoint_markers",
+      std::bind(&WorldNode::get_waypoint_markers_callback, this,
+                std::placeholders::_1, std::placeholders::_2),
+      rclcpp::ServicesQoS(), services_group_
+    );
+
+    // Streamed, batched registration, see ObservationPublisher
+    observation_acks_pub_ =
+      this->create_publisher<plansys2_interface::msg::MarkerObservationsAck>(
+      "/world_node/observation_acks", rclcpp::QoS(100).reliable());
+
+    rclcpp::SubscriptionOptions observation_options;
+    observation_options.callback_group = services_group_;
+    observations_sub_ = this->create_subscription<plansys2_interface::msg::MarkerObservations>(
+      "/world_node/observations", rclcpp::QoS(100).reliable(),
+      std::bind(&WorldNode::observations_callback, this, std::placeholders::_1),
+      observation_options);
+
+    // Latched snapshot of all detected markers, only republished when it changes
     detected_markers_pub_ = this->create_publisher<plansys2_interface::msg::DetectedMarkers>(
-      "/world_node/detected_markers", 10);
-    
-    // Timer for periodic publishing
-    timer_ = this->create_wall_timer(500ms, std::bind(&WorldNode::publish_markers_timer, this));
-    
-    RCLCPP_INFO(get_logger(), "WorldNode initialized");
+      "/world_node/detected_markers", rclcpp::QoS(1).reliable().transient_local());
+
+    // Incremental changes, for consumers that keep their own copy
+    marker_updates_pub_ = this->create_publisher<plansys2_interface::msg::DetectedMarkersDelta>(
+      "/world_node/marker_updates", rclcpp::QoS(100).reliable());
+
+    // Changes are coalesced and flushed at most every 100 ms
+    timer_ = this->create_wall_timer(100ms, std::bind(&WorldNode::flush_changes, this));
+
+    publish_snapshot(*world_.snapshot());
+
+    RCLCPP_INFO(get_logger(), "WorldNode initialized for %zu robot namespaces", robots.size());
   }
 
 private:
   void add_marker_callback(
+    const std::string & robot,
     const std::shared_ptr<plansys2_interface::srv::GetMarkerPose::Request> req,
     std::shared_ptr<plansys2_interface::srv::GetMarkerPose::Response> res)
   {
-    int marker_id = req->marker_id;
-    
-    // Store marker info
     MarkerInfo info;
-    info.marker_id = marker_id;
+    info.marker_id = req->marker_id;
     info.robot_wp = req->wp;
-    markers_[marker_id] = info;
-    
-    RCLCPP_INFO(get_logger(), "Added marker ID %d", marker_id);
+    info.robot_pose = req->robot_pose;
+    info.robot = robot;
+    info.stamp_ns = rclcpp::Time(req->stamp).nanoseconds();
+    if (info.stamp_ns == 0) {
+      info.stamp_ns = this->now().nanoseconds();
+    }
+
+    MarkerInfo kept;
+    auto result = world_.report(info, kept);
+    if (result == WorldModel::Result::ADDED) {
+      RCLCPP_INFO(get_logger(), "Added marker ID %d from %s", info.marker_id,
+                  robot.empty() ? "unnamed robot" : robot.c_str());
+    } else if (result == WorldModel::Result::UPDATED) {
+      RCLCPP_DEBUG(get_logger(), "Updated marker ID %d from %s", info.marker_id, robot.c_str());
+    } else if (result == WorldModel::Result::REJECTED) {
+      RCLCPP_DEBUG(get_logger(), "Kept report of marker ID %d from %s over %s",
+                   info.marker_id, kept.robot.c_str(), robot.c_str());
+    }
+
     res->success = true;
-    res->wp = req->wp;
+    res->wp = kept.robot_wp;
   }
-  
+
+  // Batches may arrive more than once and out of order. Reports are applied
+  // idempotently, every copy is acknowledged and gaps in a source's sequence
+  // numbers are logged until the missing batches show up.
+  void observations_callback(const plansys2_interface::msg::MarkerObservations::SharedPtr msg)
+  {
+    bool duplicate = track_sequence(msg->source, msg->sequence);
+
+    plansys2_interface::msg::MarkerObservationsAck ack;
+    ack.source = msg->source;
+    ack.sequence = msg->sequence;
+    if (!duplicate) {
+      MarkerInfo info, kept;
+      for (const auto & observation : msg->observations) {
+        info.marker_id = observation.marker_id;
+        info.robot_wp = observation.wp;
+        info.robot_pose = observation.robot_pose;
+        info.robot = observation.robot;
+        info.stamp_ns = rclcpp::Time(observation.stamp).nanoseconds();
+        auto result = world_.report(info, kept);
+        if (result == WorldModel::Result::ADDED || result == WorldModel::Result::UPDATED) {
+          ++ack.applied;
+        }
+        if (result == WorldModel::Result::ADDED) {
+          RCLCPP_INFO(get_logger(), "Added marker ID %d from %s", info.marker_id,
+                      info.robot.empty() ? "unnamed robot" : info.robot.c_str());
+        }
+      }
+    }
+    observation_acks_pub_->publish(ack);
+  }
+
+  // Returns true if the batch was already received
+  bool track_sequence(const std::string & source, uint64_t sequence)
+  {
+    std::lock_guard<std::mutex> lock(sources_mutex_);
+    auto & state = sources_[source];
+    if (sequence > state.highest) {
+      // Only the latest missing batches are remembered
+      const uint64_t max_tracked = 1024;
+      uint64_t first = std::max(state.highest + 1, sequence - std::min(sequence, max_tracked));
+      for (uint64_t s = first; s < sequence; ++s) {
+        state.missing.insert(s);
+      }
+      while (state.missing.size() > max_tracked) {
+        state.missing.erase(state.missing.begin());
+      }
+      if (sequence > state.highest + 1) {
+        RCLCPP_WARN(get_logger(), "Missing %lu marker batch(es) from %s before batch %lu",
+                    static_cast<unsigned long>(sequence - state.highest - 1), source.c_str(),
+                    static_cast<unsigned long>(sequence));
+      }
+      state.highest = sequence;
+      return false;
+    }
+    if (state.missing.erase(sequence) > 0) {
+      RCLCPP_INFO(get_logger(), "Received missing marker batch %lu from %s, %zu still missing",
+                  static_cast<unsigned long>(sequence), source.c_str(), state.missing.size());
+      return false;
+    }
+    return true;
+  }
+
+  void remove_marker_callback(
+    const std::shared_ptr<plansys2_interface::srv::GetMarkerPose::Request> req,
+    std::shared_ptr<plansys2_interface::srv::GetMarkerPose::Response> res)
+  {
+    res->success = world_.remove(req->marker_id);
+    if (res->success) {
+      RCLCPP_INFO(get_logger(), "Removed marker ID %d", req->marker_id);
+    }
+  }
+
   void get_nth_marker_callback(
     const std::shared_ptr<plansys2_interface::srv::GetMarkerPose::Request> req,
     std::shared_ptr<plansys2_interface::srv::GetMarkerPose::Response> res)
   {
     int n = req->marker_id;  // Use marker_id field as n (nth lowest)
-    
-    if (markers_.empty()) {
+    auto markers = world_.snapshot();
+
+    if (markers->empty()) {
       res->success = false;
       RCLCPP_WARN(get_logger(), "No markers detected");
       return;
     }
-    
-    // Create sorted vector of marker IDs
-    std::vector<int> sorted_ids;
-    for (const auto& [id, info] : markers_) {
-      sorted_ids.push_back(id);
+
+    const MarkerInfo * nth = n < 0 ? nullptr : markers->nth(n);
+    if (nth == nullptr) {
+      res->success = false;
+      RCLCPP_WARN(get_logger(), "Invalid index %d, have %zu markers", n, markers->size());
+      return;
+    }
+
+    res->success = true;
+    res->wp = nth->robot_wp;
+    RCLCPP_INFO(get_logger(), "Nth marker (n=%d): ID %d", n, nth->marker_id);
+  }
+
+  void get_markers_callback(
+    const std::shared_ptr<plansys2_interface::srv::GetMarkerRange::Request> req,
+    std::shared_ptr<plansys2_interface::srv::GetMarkerRange::Response> res)
+  {
+    auto markers = world_.snapshot();
+    res->revision = revision_.load();
+    res->total = static_cast<int>(markers->size());
+    if (req->start < 0 || req->count < 0) {
+      res->success = false;
+      return;
+    }
+
+    size_t start = std::min<size_t>(req->start, markers->size());
+    size_t stop = std::min<size_t>(start + req->count, markers->size());
+    res->markers.reserve(stop - start);
+    for (size_t i = start; i < stop; ++i) {
+      res->markers.push_back(to_msg(*markers->nth(i)));
     }
-    std::sort(sorted_ids.begin(), sorted_ids.end());
-    
-    if (n < 0 || n >= static_cast<int>(sorted_ids.size())) {
+    res->success = true;
+  }
+
+  void get_nearest_markers_callback(
+    const std::shared_ptr<plansys2_interface::srv::GetNearestMarkers::Request> req,
+    std::shared_ptr<plansys2_interface::srv::GetNearestMarkers::Response> res)
+  {
+    if (req->count < 0) {
       res->success = false;
-      RCLCPP_WARN(get_logger(), "Invalid index %d, have %zu markers", n, sorted_ids.size());
       return;
     }
-    
-    int nth_id = sorted_ids[n];
+
+    auto markers = world_.snapshot();
+    std::vector<std::pair<double, const MarkerInfo *>> by_distance;
+    by_distance.reserve(markers->size());
+    for (const auto & info : *markers) {
+      double dx = info.robot_pose.position.x - req->position.x;
+      double dy = info.robot_pose.position.y - req->position.y;
+      double dz = info.robot_pose.position.z - req->position.z;
+      by_distance.emplace_back(dx * dx + dy * dy + dz * dz, &info);
+    }
+
+    size_t count = std::min<size_t>(req->count, by_distance.size());
+    std::partial_sort(by_distance.begin(), by_distance.begin() + count, by_distance.end(),
+      [](const auto & a, const auto & b) {return a.first < b.first;});
+
+    res->markers.reserve(count);
+    res->distances.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+      res->markers.push_back(to_msg(*by_distance[i].second));
+      res->distances.push_back(std::sqrt(by_distance[i].first));
+    }
+    res->success = true;
+  }
+
+  void get_waypoint_markers_callback(
+    const std::shared_ptr<plansys2_interface::srv::GetWaypointMarkers::Request> req,
+    std::shared_ptr<plansys2_interface::srv::GetWaypointMarkers::Response> res)
+  {
+    auto markers = world_.snapshot();
+    for (const auto & info : *markers) {
+      if (info.robot_wp == req->wp) {
+        res->markers.push_back(to_msg(info));
+      }
+    }
     res->success = true;
-    res->wp = markers_[nth_id].robot_wp;
-    RCLCPP_INFO(get_logger(), "Nth marker (n=%d): ID %d", n, nth_id);
   }
-  
-  void publish_markers_timer()
+
+  // Runs with the marker's shard locked, so the log sees the changes of one
+  // marker in the order they were applied
+  void persist(const MarkerInfo & info, bool removed)
+  {
+    std::lock_guard<std::mutex> lock(log_mutex_);
+    if (!landmark_log_.is_open()) {
+      return;
+    }
+    std::string err;
+    if (removed) {
+      if (!landmark_log_.append_remove(info.marker_id, err)) {
+        RCLCPP_ERROR(get_logger(), "Failed to persist removal of marker %d: %s",
+                     info.marker_id, err.c_str());
+      }
+    } else if (!landmark_log_.append_upsert(info, err)) {
+      RCLCPP_ERROR(get_logger(), "Failed to persist marker %d: %s", info.marker_id, err.c_str());
+    }
+  }
+
+  void flush_changes()
+  {
+    plansys2_interface::msg::DetectedMarkersDelta delta;
+    if (!world_.take_changes(changed_, delta.removed)) {
+      return;
+    }
+
+    delta.revision = ++revision_;
+    delta.upserted.reserve(changed_.size());
+    for (const auto & info : changed_) {
+      delta.upserted.push_back(to_msg(info));
+    }
+    marker_updates_pub_->publish(delta);
+
+    publish_snapshot(*world_.snapshot());
+  }
+
+  void publish_snapshot(const MarkerStore & markers)
   {
     plansys2_interface::msg::DetectedMarkers msg;
-    
-    // Create sorted vector of marker IDs
-    std::vector<int> sorted_ids;
-    for (const auto& [id, info] : markers_) {
-      sorted_ids.push_back(id);
-    }
-    std::sort(sorted_ids.begin(), sorted_ids.end());
-    
-    // Add markers in sorted order
-    for (const int& id : sorted_ids) {
-      plansys2_interface::msg::DetectedMarker marker;
-      marker.marker_id = markers_[id].marker_id;
-      marker.wp = markers_[id].robot_wp;
-      msg.markers.push_back(marker);
-    }
-    
+    msg.revision = revision_.load();
+    msg.markers.reserve(markers.size());
+
+    // The store is already sorted by marker ID
+    for (const auto & info : markers) {
+      msg.markers.push_back(to_msg(info));
+    }
+
     detected_markers_pub_->publish(msg);
   }
 
-  
-  // Store detected markers: marker_id -> MarkerInfo
-  std::unordered_map<int, MarkerInfo> markers_;
-  
+  static plansys2_interface::msg::DetectedMarker to_msg(const MarkerInfo & info)
+  {
+    plansys2_interface::msg::DetectedMarker marker;
+    marker.marker_id = info.marker_id;
+    marker.wp = info.robot_wp;
+    marker.robot_pose = info.robot_pose;
+    marker.robot = info.robot;
+    marker.stamp = rclcpp::Time(info.stamp_ns);
+    return marker;
+  }
+
+  // Detected markers of the whole fleet
+  WorldModel world_;
+  LandmarkLog landmark_log_;
+  std::mutex log_mutex_;
+  std::atomic<uint64_t> revision_{0};
+  std::vector<MarkerInfo> changed_;
+
+  struct SourceState
+  {
+    uint64_t highest = 0;
+    std::set<uint64_t> missing;
+  };
+  std::mutex sources_mutex_;
+  std::map<std::string, SourceState> sources_;
+
+  rclcpp::CallbackGroup::SharedPtr services_group_;
   rclcpp::Service<plansys2_interface::srv::GetMarkerPose>::SharedPtr add_marker_srv_;
+  std::vector<rclcpp::Service<plansys2_interface::srv::GetMarkerPose>::SharedPtr>
+    robot_add_marker_srvs_;
+  rclcpp::Service<plansys2_interface::srv::GetMarkerPose>::SharedPtr remove_marker_srv_;
   rclcpp::Service<plansys2_interface::srv::GetMarkerPose>::SharedPtr get_nth_marker_srv_;
+  rclcpp::Service<plansys2_interface::srv::GetMarkerRange>::SharedPtr get_markers_srv_;
+  rclcpp::Service<plansys2_interface::srv::GetNearestMarkers>::SharedPtr
+    get_nearest_markers_srv_;
+  rclcpp::Service<plansys2_interface::srv::GetWaypointMarkers>::SharedPtr
+    get_waypoint_markers_srv_;
+  rclcpp::Subscription<plansys2_interface::msg::MarkerObservations>::SharedPtr observations_sub_;
+  rclcpp::Publisher<plansys2_interface::msg::MarkerObservationsAck>::SharedPtr
+    observation_acks_pub_;
   rclcpp::Publisher<plansys2_interface::msg::DetectedMarkers>::SharedPtr detected_markers_pub_;
+  rclcpp::Publisher<plansys2_interface::msg::DetectedMarkersDelta>::SharedPtr marker_updates_pub_;
   rclcpp::TimerBase::SharedPtr timer_;
 };
 
-int main(int argc, char ** argv)
-{
-  rclcpp::init(argc, argv);
-  auto node = std::make_shared<WorldNode>();
-  rclcpp::spin(node);
-  rclcpp::shutdown();
-  return 0;
-}
+}  // namespace plansys_interface
 
+RCLCPP_COMPONENTS_REGISTER_NODE(plansys_interface::WorldNode)
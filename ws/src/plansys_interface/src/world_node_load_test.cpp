@@ -0,0 +1,247 @@
+#include "rclcpp/rclcpp.hpp"
+#include "plansys2_interface/srv/get_marker_pose.hpp"
+#include "plansys_interface/world_model.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono_literals;
+using GetMarkerPose = plansys2_interface::srv::GetMarkerPose;
+
+// Sustained marker registration load from a simulated fleet. Every robot keeps
+// a number of add_marker requests in flight for random markers, from random
+// poses, for the given duration.
+//
+// Against a running world node, started with robots:=[robot1, ..., robotN]:
+//   world_node_load_test --robots 12 --duration 10
+// Against the marker store alone, one thread per robot:
+//   world_node_load_test --robots 12 --in-process
+struct LoadConfig
+{
+  int robots = 12;
+  int inflight = 4;
+  int markers = 200;
+  double duration = 10.0;
+  std::string prefix = "robot";
+};
+
+struct Counters
+{
+  std::atomic<uint64_t> completed{0};
+  std::atomic<uint64_t> failed{0};
+  std::atomic<uint64_t> latency_ns{0};
+};
+
+static void report(const LoadConfig & config, const Counters & counters, double seconds)
+{
+  uint64_t completed = counters.completed.load();
+  std::printf("%d robots, %.1f s: %lu registrations, %.0f /s", config.robots, seconds,
+    static_cast<unsigned long>(completed), completed / seconds);
+  if (completed > 0 && counters.latency_ns.load() > 0) {
+    std::printf(", mean latency %.3f ms", counters.latency_ns.load() / 1e6 / completed);
+  }
+  std::printf(", %lu failed\n", static_cast<unsigned long>(counters.failed.load()));
+}
+
+static int run_in_process(const LoadConfig & config)
+{
+  plansys_interface::WorldModel world;
+  Counters counters;
+  std::atomic<bool> running{true};
+
+  std::vector<std::thread> threads;
+  for (int r = 0; r < config.robots; ++r) {
+    threads.emplace_back([&, r]() {
+        std::mt19937 rng(r);
+        std::uniform_int_distribution<int> marker(0, config.markers - 1);
+        std::uniform_real_distribution<double> coord(-10.0, 10.0);
+        plansys_interface::MarkerInfo info, kept;
+        info.robot = config.prefix + std::to_string(r + 1);
+        int64_t stamp = 0;
+        while (running.load(std::memory_order_relaxed)) {
+          info.marker_id = marker(rng);
+          info.robot_wp = "wp" + std::to_string(info.marker_id % 16 + 1);
+          info.robot_pose.position.x = coord(rng);
+          info.robot_pose.position.y = coord(rng);
+          info.stamp_ns = ++stamp;
+          world.report(info, kept);
+          counters.completed.fetch_add(1, std::memory_order_relaxed);
+        }
+      });
+  }
+
+  // A reader takes snapshots as the services do
+  std::thread reader([&]() {
+      while (running.load(std::memory_order_relaxed)) {
+        world.snapshot();
+        std::this_thread::sleep_for(1ms);
+      }
+    });
+
+  auto start = std::chrono::steady_clock::now();
+  std::this_thread::sleep_for(std::chrono::duration<double>(config.duration));
+  running = false;
+  for (auto & thread : threads) {
+    thread.join();
+  }
+  reader.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  report(config, counters, seconds);
+  std::printf("%zu markers in the world model\n", world.size());
+  return 0;
+}
+
+// One simulated robot: its own node in its namespace, keeping requests in flight
+class RobotLoad
+{
+public:
+  RobotLoad(const std::string & name, const LoadConfig & config, Counters & counters,
+    std::atomic<bool> & running, unsigned seed)
+  : node_(rclcpp::Node::make_shared("load_test", name)), config_(config), counters_(counters),
+    running_(running), rng_(seed)
+  {
+    client_ = node_->create_client<GetMarkerPose>("world_node/add_marker");
+  }
+
+  rclcpp::Node::SharedPtr node() const {return node_;}
+
+  bool wait_for_service()
+  {
+    return client_->wait_for_service(5s);
+  }
+
+  void start()
+  {
+    for (int i = 0; i < config_.inflight; ++i) {
+      send();
+    }
+  }
+
+private:
+  void send()
+  {
+    auto request = std::make_shared<GetMarkerPose::Request>();
+    {
+      std::lock_guard<std::mutex> lock(rng_mutex_);
+      request->marker_id = std::uniform_int_distribution<int>(0, config_.markers - 1)(rng_);
+      request->robot_pose.position.x = std::uniform_real_distribution<double>(-10, 10)(rng_);
+      request->robot_pose.position.y = std::uniform_real_distribution<double>(-10, 10)(rng_);
+    }
+    request->wp = "wp" + std::to_string(request->marker_id % 16 + 1);
+    request->stamp = node_->now();
+
+    auto sent = std::chrono::steady_clock::now();
+    client_->async_send_request(request,
+      [this, sent](rclcpp::Client<GetMarkerPose>::SharedFuture future) {
+        auto latency = std::chrono::steady_clock::now() - sent;
+        if (future.get()->success) {
+          counters_.completed.fetch_add(1);
+          counters_.latency_ns.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+        } else {
+          counters_.failed.fetch_add(1);
+        }
+        if (running_.load()) {
+          send();
+        }
+      });
+  }
+
+  rclcpp::Node::SharedPtr node_;
+  rclcpp::Client<GetMarkerPose>::SharedPtr client_;
+  const LoadConfig & config_;
+  Counters & counters_;
+  std::atomic<bool> & running_;
+  std::mutex rng_mutex_;
+  std::mt19937 rng_;
+};
+
+static int run_ros(const LoadConfig & config)
+{
+  Counters counters;
+  std::atomic<bool> running{true};
+  rclcpp::executors::MultiThreadedExecutor executor;
+
+  std::vector<std::unique_ptr<RobotLoad>> robots;
+  for (int r = 0; r < config.robots; ++r) {
+    robots.push_back(std::make_unique<RobotLoad>(config.prefix + std::to_string(r + 1), config,
+      counters, running, r));
+    if (!robots.back()->wait_for_service()) {
+      std::fprintf(stderr, "/%s%d/world_node/add_marker is not available, start world_node "
+        "with the robots parameter\n", config.prefix.c_str(), r + 1);
+      return 1;
+    }
+    executor.add_node(robots.back()->node());
+  }
+
+  std::thread spinner([&executor]() {executor.spin();});
+  auto start = std::chrono::steady_clock::now();
+  for (auto & robot : robots) {
+    robot->start();
+  }
+
+  uint64_t last = 0;
+  for (double t = 1.0; t <= config.duration && rclcpp::ok(); t += 1.0) {
+    std::this_thread::sleep_for(1s);
+    uint64_t completed = counters.completed.load();
+    std::printf("%5.0f s: %lu /s\n", t, static_cast<unsigned long>(completed - last));
+    std::fflush(stdout);
+    last = completed;
+  }
+  running = false;
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  report(config, counters, seconds);
+
+  // Let the requests still in flight complete before tearing the clients down
+  std::this_thread::sleep_for(500ms);
+  executor.cancel();
+  spinner.join();
+  return 0;
+}
+
+int main(int argc, char ** argv)
+{
+  auto args = rclcpp::init_and_remove_ros_arguments(argc, argv);
+
+  LoadConfig config;
+  bool in_process = false;
+  for (size_t i = 1; i < args.size(); ++i) {
+    const std::string & arg = args[i];
+    bool has_value = i + 1 < args.size();
+    if (arg == "--in-process") {
+      in_process = true;
+    } else if (arg == "--robots" && has_value) {
+      config.robots = std::atoi(args[++i].c_str());
+    } else if (arg == "--inflight" && has_value) {
+      config.inflight = std::atoi(args[++i].c_str());
+    } else if (arg == "--markers" && has_value) {
+      config.markers = std::atoi(args[++i].c_str());
+    } else if (arg == "--duration" && has_value) {
+      config.duration = std::atof(args[++i].c_str());
+    } else if (arg == "--prefix" && has_value) {
+      config.prefix = args[++i];
+    } else {
+      std::fprintf(stderr, "Usage: %s [--in-process] [--robots N] [--inflight N] [--markers N] "
+        "[--duration S] [--prefix NAME]\n", args[0].c_str());
+      rclcpp::shutdown();
+      return 1;
+    }
+  }
+  if (config.robots < 1 || config.inflight < 1 || config.markers < 1 || config.duration <= 0) {
+    std::fprintf(stderr, "robots, inflight, markers and duration must be positive\n");
+    rclcpp::shutdown();
+    return 1;
+  }
+
+  int status = in_process ? run_in_process(config) : run_ros(config);
+  rclcpp::shutdown();
+  return status;
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "plansys_interface/path_cost_matrix.hpp"
+#include "plansys_interface/tour_optimizer.hpp"
+#include "plansys_interface/waypoint_registry.hpp"
+
+using plansys_interface::GridMap;
+using plansys_interface::PathCostMatrix;
+using plansys_interface::WaypointRegistry;
+
+// 4 m x 2 m open map, split by a wall at x = 3 m that isolates its right end
+class TourOptimizerTest : public ::testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    map_.width = 40;
+    map_.height = 20;
+    map_.resolution = 0.1;
+    map_.free.assign(map_.width * map_.height, 1);
+    for (int y = 0; y < map_.height; ++y) {
+      map_.free[y * map_.width + 30] = 0;
+    }
+
+    path_ = ::testing::TempDir() + "test_tour_optimizer_waypoints.yaml";
+    std::ofstream file(path_);
+    file << "waypoints:\n"
+      "  st: {x: 0.25, y: 1.05}\n"
+      "  far: {x: 2.55, y: 1.05}\n"
+      "  near: {x: 1.05, y: 1.05}\n"
+      "  mid: {x: 1.85, y: 1.05}\n"
+      "  walled: {x: 3.55, y: 1.05}\n";
+    file.close();
+
+    std::string err;
+    ASSERT_TRUE(registry_.load_from_file(path_, err)) << err;
+    ASSERT_TRUE(costs_.compute(registry_, map_, 0.0, 1, err)) << err;
+  }
+
+  void TearDown() override {std::remove(path_.c_str());}
+
+  size_t idx(const std::string & name) const {return registry_.index_of(name);}
+
+  GridMap map_;
+  std::string path_;
+  WaypointRegistry registry_;
+  PathCostMatrix costs_;
+};
+
+TEST_F(TourOptimizerTest, VisitsReachableStopsInCheapestOrder)
+{
+  std::vector<size_t> order;
+  std::string err;
+  ASSERT_TRUE(plansys_interface::optimise_tour(
+      costs_, idx("st"), {idx("far"), idx("near"), idx("mid")}, order, err)) << err;
+  EXPECT_EQ(order, (std::vector<size_t>{idx("near"), idx("mid"), idx("far")}));
+  EXPECT_NEAR(plansys_interface::tour_cost(costs_, idx("st"), order), 2.3, 1e-6);
+}
+
+TEST_F(TourOptimizerTest, FailsWhenAStopIsUnreachable)
+{
+  ASSERT_TRUE(std::isinf(costs_.cost(idx("st"), idx("walled"))));
+
+  std::vector<size_t> order;
+  std::string err;
+  EXPECT_FALSE(plansys_interface::optimise_tour(
+      costs_, idx("st"), {idx("near"), idx("mid"), idx("walled")}, order, err));
+  EXPECT_TRUE(order.empty());
+  EXPECT_FALSE(err.empty());
+}
+
+TEST_F(TourOptimizerTest, HeuristicFailsWhenAStopIsUnreachable)
+{
+  // More stops than the exact search handles, repeating the reachable ones
+  std::vector<size_t> stops;
+  while (stops.size() < plansys_interface::MAX_EXACT_STOPS) {
+    stops.push_back(idx("near"));
+    stops.push_back(idx("mid"));
+  }
+  stops.push_back(idx("walled"));
+
+  std::vector<size_t> order;
+  std::string err;
+  EXPECT_FALSE(plansys_interface::optimise_tour(costs_, idx("st"), stops, order, err));
+  EXPECT_TRUE(order.empty());
+}
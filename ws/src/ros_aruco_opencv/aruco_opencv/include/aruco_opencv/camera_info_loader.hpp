@@ -0,0 +1,45 @@
+// Copyright 2025 Fictionlab sp. z o.o.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <string>
+
+#include "sensor_msgs/msg/camera_info.hpp"
+
+namespace aruco_opencv
+{
+
+class CameraInfoLoader {
+public:
+  /**
+   * @brief Loads camera intrinsics from a calibration file
+   *
+   * The file uses the YAML format written by the ROS camera_calibration tools
+   * (image_width, image_height, camera_matrix, distortion_model, distortion_coefficients,
+   * rectification_matrix, projection_matrix).
+   */
+  static bool load_from_file(
+    const std::string & path,
+    sensor_msgs::msg::CameraInfo & out_cam_info,
+    std::string & error_message);
+};
+
+}  // namespace aruco_opencv
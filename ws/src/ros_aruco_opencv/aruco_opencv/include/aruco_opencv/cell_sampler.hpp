@@ -0,0 +1,71 @@
+// Copyright 2025 Fictionlab sp. z o.o.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace aruco_opencv
+{
+
+/// @brief 8-bit grayscale image read by the cell sampler, rows `step` bytes apart
+struct GrayImageView
+{
+  const uint8_t * data = nullptr;
+  int width = 0;
+  int height = 0;
+  size_t step = 0;
+};
+
+/// @brief Acceptance thresholds of the cell sampler, matching OpenCV's decoding parameters
+struct CellSamplerConfig
+{
+  /// Candidates whose sampled cells vary less than this (grey levels) are flat patches
+  double min_stddev = 5.0;
+  /// White border cells allowed, as a fraction of the number of bits of the marker
+  double max_border_error_rate = 0.35;
+};
+
+/**
+ * @brief Reads the bits of a marker candidate by sampling its cell centres
+ *
+ * The centre of every cell, border included, is mapped through the homography from the unit
+ * square to the candidate and bilinearly sampled. The samples are split into black and white
+ * by Otsu's method and the border cells checked, without warping the candidate to a canonical
+ * image first.
+ * @param image Image the candidate was found in
+ * @param corners The 4 corners as x, y pairs, in the order OpenCV returns them
+ * @param config Acceptance thresholds
+ * @param bits Receives the marker_size * marker_size inner bits row by row, 1 for white
+ * @return Whether the candidate has enough contrast and a valid border
+ */
+using CellSamplerKernel = bool (*)(
+  const GrayImageView & image, const float * corners, const CellSamplerConfig & config,
+  uint8_t * bits);
+
+/**
+ * @brief Returns the kernel specialised at compile time on the marker size
+ * @param marker_size Number of bits per side of the dictionary's markers, without the border
+ * @return The kernel, or nullptr for sizes without a specialisation (outside 4 to 7)
+ */
+CellSamplerKernel get_cell_sampler_kernel(int marker_size);
+
+}  // namespace aruco_opencv
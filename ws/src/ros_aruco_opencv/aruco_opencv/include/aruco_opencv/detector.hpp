@@ -20,6 +20,7 @@
 
 #pragma once
 
+#include <memory>
 #include <mutex>
 #include <string>
 #include <utility>
@@ -31,10 +32,11 @@
 #include "rclcpp/rclcpp.hpp"
 #include "sensor_msgs/msg/camera_info.hpp"
 #include "geometry_msgs/msg/pose.hpp"
+#include "aruco_opencv/cell_sampler.hpp"
+#include "aruco_opencv/dictionary_file.hpp"
+#include "aruco_opencv/frame_context.hpp"
 #include "aruco_opencv/utils.hpp"
 #include "aruco_opencv/parameters.hpp"
-#include "aruco_opencv_msgs/msg/marker_pose.hpp"
-#include "aruco_opencv_msgs/msg/board_pose.hpp"
 
 namespace aruco_opencv
 {
@@ -45,6 +47,14 @@ public:
   explicit ArucoDetector(rclcpp::Logger logger);
 
   void set_dictionary(const std::string & dictionary_name);
+
+  /**
+   * @brief Uses a precompiled dictionary file, memory-mapped and shared read-only
+   * @param path Path to the dictionary file
+   * @param error_message Set to a human readable reason on failure
+   * @return Whether the dictionary was loaded
+   */
+  bool set_dictionary_from_file(const std::string & path, std::string & error_message);
   void set_detector_parameters(const DetectorParams & params);
   void set_aruco_parameters(const cv::Ptr<cv::aruco::DetectorParameters> & params);
   void set_camera_intrinsics(const cv::Mat & camera_matrix, const cv::Mat & dist_coeffs);
@@ -55,44 +65,36 @@ public:
 
   /**
    * @brief Detects markers in the given image
+   *
+   * When a candidate distance range is set and the intrinsics are known, contours whose
+   * perimeter is out of the range a marker can have at those distances are rejected before
+   * perspective removal and decoding, by narrowing the perimeter rates for this frame. Every
+   * `candidate_audit_period` such frames, detection runs again without the range to count the
+   * candidates and markers it removed. With `decode_rejected`, the rejected candidates are
+   * read again by the cell sampler and those matching the dictionary added to the markers.
    * @param image Input image
-   * @param marker_ids Output vector of detected marker IDs
-   * @param marker_corners Output vector of detected marker corners
+   * @param ctx Frame context receiving the IDs and corners of detected markers
+   * @param filter_candidates Whether to apply the candidate distance range
    */
-  void detect(
-    const cv::Mat & image,
-    std::vector<int> & marker_ids,
-    std::vector<std::vector<cv::Point2f>> & marker_corners) const;
+  void detect(const cv::Mat & image, FrameContext & ctx, bool filter_candidates = true) const;
 
   /**
    * @brief Estimates poses of detected markers
-   * @param marker_ids IDs of detected markers
-   * @param marker_corners Corners of detected markers
-   * @param marker_poses Output vector of estimated marker poses
-   * @param rvecs Output rotation vectors of estimated poses
-   * @param tvecs Output translation vectors of estimated poses
+   *
+   * Fills `ctx.detection.markers` and appends the rotation and translation vectors of the
+   * estimated poses to `ctx.rvecs` and `ctx.tvecs`.
+   * @param ctx Frame context holding the detected markers
    */
-  void estimate_marker_poses(
-    const std::vector<int> & marker_ids,
-    const std::vector<std::vector<cv::Point2f>> & marker_corners,
-    std::vector<aruco_opencv_msgs::msg::MarkerPose> & marker_poses,
-    std::vector<cv::Vec3d> & rvecs,
-    std::vector<cv::Vec3d> & tvecs) const;
+  void estimate_marker_poses(FrameContext & ctx) const;
 
   /**
    * @brief Estimates poses of known boards from detected markers
-   * @param marker_ids IDs of detected markers
-   * @param marker_corners Corners of detected markers
-   * @param board_poses Output vector of estimated board poses
-   * @param rvecs Output rotation vectors of estimated board poses
-   * @param tvecs Output translation vectors of estimated board poses
+   *
+   * Fills `ctx.detection.boards` and appends the rotation and translation vectors of the
+   * estimated poses to `ctx.rvecs` and `ctx.tvecs`.
+   * @param ctx Frame context holding the detected markers
    */
-  void estimate_board_poses(
-    const std::vector<int> & marker_ids,
-    const std::vector<std::vector<cv::Point2f>> & marker_corners,
-    std::vector<aruco_opencv_msgs::msg::BoardPose> & board_poses,
-    std::vector<cv::Vec3d> & rvecs,
-    std::vector<cv::Vec3d> & tvecs) const;
+  void estimate_board_poses(FrameContext & ctx) const;
 
 private:
   /**
@@ -100,6 +102,25 @@ private:
    */
   void update_marker_object_points(double marker_size);
 
+  /**
+   * @brief Narrows the perimeter rates of `params` to the configured distance range
+   * @param image_size Size of the image the parameters are used on
+   * @return Whether the rates were narrowed
+   */
+  bool restrict_candidate_size(
+    const cv::Size & image_size, cv::aruco::DetectorParameters & params) const;
+
+  /**
+   * @brief Reads the rejected candidates of `ctx` with the cell sampler
+   *
+   * Candidates matching a marker that was not detected already are moved to the markers,
+   * with their corners rotated the way OpenCV does for identified markers.
+   * @param image Input image
+   * @param ctx Frame context holding the detected markers and rejected candidates
+   * @return Number of markers recovered
+   */
+  size_t decode_rejected(const cv::Mat & image, FrameContext & ctx) const;
+
   /**
    * @brief Selects the best pose from multiple candidates based on the given strategy
    * @param rvecs Rotation vectors of candidate poses
@@ -117,11 +138,18 @@ private:
   rclcpp::Logger logger_;
 
   cv::Ptr<cv::aruco::Dictionary> dictionary_;
+  std::shared_ptr<const MappedDictionary> mapped_dictionary_;
+  /// Cell sampler for the dictionary's marker size, nullptr if there is none
+  CellSamplerKernel cell_sampler_ = nullptr;
   cv::Ptr<cv::aruco::DetectorParameters> aruco_parameters_;
   cv::Mat camera_matrix_;
   cv::Mat distortion_coeffs_;
   cv::Mat marker_obj_points_;
   std::vector<std::pair<std::string, cv::Ptr<cv::aruco::Board>>> boards_;
+  /// Side lengths of the smallest and largest board markers, 0 without boards
+  double min_board_marker_side_ = 0.0;
+  double max_board_marker_side_ = 0.0;
+  bool intrinsics_known_ = false;
 
   DetectorParams params_{};
 
@@ -0,0 +1,95 @@
+// Copyright 2025 Fictionlab sp. z o.o.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <opencv2/aruco.hpp>
+
+namespace aruco_opencv
+{
+
+/// @brief Alignment (in bytes) of the codeword table inside a dictionary file
+constexpr size_t DICTIONARY_FILE_ALIGNMENT = 64;
+
+/// @brief On-disk header of a precompiled dictionary file (little-endian)
+///
+/// The header is followed by a codeword table starting at `table_offset`, which is a multiple of
+/// DICTIONARY_FILE_ALIGNMENT. The table uses the same layout as `cv::aruco::Dictionary::bytesList`
+/// (`marker_count` rows of `bytes_per_rotation` 4-channel bytes, one channel per rotation), so it
+/// can be wrapped by a `cv::Mat` without copying.
+struct DictionaryFileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t marker_size;
+  uint32_t marker_count;
+  uint32_t bytes_per_rotation;
+  uint32_t max_correction_bits;
+  uint32_t min_hamming_distance;
+  uint64_t table_offset;
+  uint64_t table_size;
+  uint8_t reserved[16];
+};
+
+static_assert(sizeof(DictionaryFileHeader) == DICTIONARY_FILE_ALIGNMENT,
+  "DictionaryFileHeader must occupy exactly one cache line");
+
+/**
+ * @brief Read-only memory mapping of a precompiled dictionary file
+ *
+ * Mappings are shared between all users in the process: opening the same file twice returns
+ * the same instance for as long as any reference to it is alive. The page cache is shared
+ * between processes mapping the same file.
+ */
+class MappedDictionary {
+public:
+  MappedDictionary(const MappedDictionary &) = delete;
+  MappedDictionary & operator=(const MappedDictionary &) = delete;
+  ~MappedDictionary();
+
+  /**
+   * @brief Maps the dictionary file at the given path, or returns an existing mapping
+   * @param path Path to the dictionary file
+   * @param error_message Set to a human readable reason on failure
+   * @return The mapping, or nullptr on failure
+   */
+  static std::shared_ptr<const MappedDictionary> open(
+    const std::string & path,
+    std::string & error_message);
+
+  /// @brief Returns a dictionary whose byte list references the mapped memory
+  cv::Ptr<cv::aruco::Dictionary> get_dictionary() const;
+
+  const DictionaryFileHeader & header() const {return *header_;}
+
+private:
+  MappedDictionary() = default;
+
+  void * data_ = nullptr;
+  size_t size_ = 0;
+  const DictionaryFileHeader * header_ = nullptr;
+};
+
+}  // namespace aruco_opencv
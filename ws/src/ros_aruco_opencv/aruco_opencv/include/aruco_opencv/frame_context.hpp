@@ -0,0 +1,193 @@
+// Copyright 2025 Fictionlab sp. z o.o.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/aruco.hpp>
+#include <opencv2/core.hpp>
+
+#include "geometry_msgs/msg/transform_stamped.hpp"
+#include "aruco_opencv_msgs/msg/aruco_detection.hpp"
+#include "aruco_opencv_msgs/msg/aruco_image_detection.hpp"
+
+namespace aruco_opencv
+{
+
+/// @brief Per-marker scratch buffers for the PnP solver
+struct PnPScratch
+{
+  std::vector<cv::Vec3d> rvecs;
+  std::vector<cv::Vec3d> tvecs;
+  std::vector<double> reproj_errors;
+};
+
+/// @brief Counters describing how often the reusable frame buffers had to grow
+struct FrameStats
+{
+  /// Number of frames processed with this context
+  uint64_t frames = 0;
+  /// Number of frames during which at least one buffer had to grow (i.e. allocate)
+  uint64_t frames_with_growth = 0;
+  /// Index of the last frame which required a buffer to grow
+  uint64_t last_growth_frame = 0;
+};
+
+/// @brief Counters of the quad candidates that reached decoding
+struct CandidateStats
+{
+  /// Candidates that passed the geometric filters and were decoded
+  uint64_t decoded = 0;
+  /// Decoded candidates that did not match the dictionary
+  uint64_t rejected = 0;
+  /// Rejected candidates the cell sampler matched to a marker
+  uint64_t recovered = 0;
+
+  /// Frames detected with the candidate distance range applied
+  uint64_t filtered_frames = 0;
+  /// Frames also detected without the range, to measure what it removes
+  uint64_t audited_frames = 0;
+  /// Candidates decoded on the audited frames with and without the range
+  uint64_t audit_decoded_filtered = 0;
+  uint64_t audit_decoded_unfiltered = 0;
+  /// Markers found without the range but not with it on the audited frames
+  uint64_t audit_markers_lost = 0;
+
+  double rejection_rate() const
+  {
+    return decoded > 0 ? static_cast<double>(rejected) / decoded : 0.0;
+  }
+
+  /// Fraction of the candidates that would have been decoded which the distance range removed
+  double size_filter_rate() const
+  {
+    return audit_decoded_unfiltered > audit_decoded_filtered ?
+           1.0 - static_cast<double>(audit_decoded_filtered) / audit_decoded_unfiltered : 0.0;
+  }
+};
+
+/**
+ * @brief Reusable buffers for a single detection pipeline
+ *
+ * All buffers keep their capacity between frames, so once the number of detected markers has
+ * been seen before, processing a frame does not allocate in the tracker's own code.
+ */
+struct FrameContext
+{
+  /// IDs of detected markers
+  std::vector<int> marker_ids;
+  /// Corners of detected markers, as returned by OpenCV
+  std::vector<std::vector<cv::Point2f>> marker_corners;
+  /// Corners of detected markers stored contiguously, 4 per marker
+  std::vector<cv::Point2f> corners;
+  /// Corners of candidates that were decoded but matched no marker
+  std::vector<std::vector<cv::Point2f>> rejected_corners;
+  /// Detector parameters of this frame, with the candidate size range applied
+  cv::Ptr<cv::aruco::DetectorParameters> aruco_parameters;
+  /// Grayscale copy of the frame and bits read by the cell sampler
+  cv::Mat gray;
+  cv::Mat sampled_bits;
+  /// Results of the periodic detection without the candidate size range
+  std::vector<int> audit_ids;
+  std::vector<std::vector<cv::Point2f>> audit_corners;
+  std::vector<std::vector<cv::Point2f>> audit_rejected_corners;
+
+  /// Rotation and translation vectors of estimated marker poses followed by board poses
+  std::vector<cv::Vec3d> rvecs;
+  std::vector<cv::Vec3d> tvecs;
+  std::vector<uint8_t> valid;
+  /// Reprojection error of the selected pose of each detected marker, negative if none
+  std::vector<float> reproj_errors;
+  std::vector<PnPScratch> pnp_scratch;
+
+  /// Snapshot of the detector state used for this frame
+  cv::Mat camera_matrix;
+  cv::Mat distortion_coeffs;
+  cv::Mat marker_obj_points;
+
+  /// Outgoing messages
+  aruco_opencv_msgs::msg::ArucoDetection detection;
+  aruco_opencv_msgs::msg::ArucoImageDetection image_detection;
+  std::vector<geometry_msgs::msg::TransformStamped> transforms;
+
+  FrameStats stats;
+  CandidateStats candidate_stats;
+
+  /// @brief Clears per-frame data while keeping the capacity of all buffers
+  void begin_frame()
+  {
+    capacity_at_begin_ = capacity();
+    marker_ids.clear();
+    corners.clear();
+    rvecs.clear();
+    tvecs.clear();
+    valid.clear();
+    reproj_errors.clear();
+    detection.markers.clear();
+    image_detection.markers.clear();
+  }
+
+  /// @brief Updates the statistics, should be called once the frame has been published
+  /// @return Whether any buffer had to grow during this frame
+  bool end_frame()
+  {
+    ++stats.frames;
+    const bool grew = capacity() > capacity_at_begin_;
+    if (grew) {
+      ++stats.frames_with_growth;
+      stats.last_growth_frame = stats.frames;
+    }
+    return grew;
+  }
+
+private:
+  size_t capacity() const
+  {
+    size_t total = marker_ids.capacity() + marker_corners.capacity() + corners.capacity() +
+      rejected_corners.capacity() + audit_ids.capacity() + audit_corners.capacity() +
+      audit_rejected_corners.capacity() +
+      rvecs.capacity() + tvecs.capacity() + valid.capacity() + reproj_errors.capacity() +
+      pnp_scratch.capacity() + detection.markers.capacity() + detection.boards.capacity() +
+      image_detection.markers.capacity() + transforms.capacity();
+    for (const auto & c : marker_corners) {
+      total += c.capacity();
+    }
+    for (const auto & c : rejected_corners) {
+      total += c.capacity();
+    }
+    for (const auto & c : audit_corners) {
+      total += c.capacity();
+    }
+    for (const auto & c : audit_rejected_corners) {
+      total += c.capacity();
+    }
+    for (const auto & s : pnp_scratch) {
+      total += s.rvecs.capacity() + s.tvecs.capacity() + s.reproj_errors.capacity();
+    }
+    return total;
+  }
+
+  size_t capacity_at_begin_ = 0;
+};
+
+}  // namespace aruco_opencv
@@ -39,12 +39,26 @@ struct CoreParams
   bool image_is_rectified;
   std::string output_frame;
   std::string marker_dict;
+  std::string marker_dict_path;
   bool image_sub_compressed;
   int qos_rel;
   int qos_dur;
   int qos_depth;
   bool publish_tf;
+  bool publish_bounded_detections;
+  bool publish_image_detections;
   std::string board_descriptions_path;
+  std::string camera_info_path;
+  bool warmup;
+  bool blur_gate;
+  int blur_gate_width;
+  double blur_gate_min_ratio;
+  double blur_gate_reference_half_life;
+  double blur_gate_angular_velocity_gain;
+  std::string blur_gate_odom_topic;
+  int num_threads;
+  std::string cpu_affinity;
+  int realtime_priority;
 };
 
 /// @brief Strategy for selecting the best pose among multiple candidates
@@ -69,6 +83,18 @@ struct DetectorParams
 {
   double marker_size;
   PoseSelectorConfig pose_selector{};
+  /// Marker poses are estimated in parallel only from this many markers
+  int min_markers_parallel_pnp = 5;
+  /// Working distance range of the camera (m), candidates too large or too small to be a marker
+  /// in it are rejected before decoding. 0 disables the corresponding bound.
+  double candidate_min_distance = 0.0;
+  double candidate_max_distance = 0.0;
+  /// Every this many filtered frames, detection also runs without the range to count what it
+  /// removes. 0 disables the audit.
+  int candidate_audit_period = 0;
+  /// Re-read the candidates OpenCV rejected with the cell sampler specialised on the marker
+  /// size and match them against the dictionary again
+  bool decode_rejected = false;
 };
 
 void declare_all_parameters(rclcpp_lifecycle::LifecycleNode & node);
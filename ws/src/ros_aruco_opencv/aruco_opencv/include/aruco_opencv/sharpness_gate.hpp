@@ -0,0 +1,105 @@
+// Copyright 2025 Fictionlab sp. z o.o.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <cstdint>
+
+#include <opencv2/core.hpp>
+
+namespace aruco_opencv
+{
+
+/// @brief Configuration of the motion blur gate
+struct SharpnessGateConfig
+{
+  /// Width of the downsampled frame the sharpness is measured on, in pixels
+  int width = 160;
+  /// Frames less sharp than this fraction of the reference are skipped
+  double min_ratio = 0.5;
+  /// Time after which the reference has decayed to half of the sharpest recent frame, in seconds
+  double reference_half_life = 2.0;
+  /// Increase of min_ratio per rad/s of camera angular velocity
+  double angular_velocity_gain = 0.5;
+};
+
+/// @brief Counters of the frames seen by the gate
+struct SharpnessGateStats
+{
+  uint64_t frames = 0;
+  uint64_t skipped = 0;
+
+  double skip_rate() const {return frames > 0 ? static_cast<double>(skipped) / frames : 0.0;}
+};
+
+/**
+ * @brief Decides which frames are sharp enough to be worth running detection on
+ *
+ * The sharpness of a frame is the gradient energy of a small grayscale copy relative to that of
+ * a copy four times smaller, taken along the more blurred image axis. Blur removes the fine
+ * scale first, so the ratio drops with motion blur, while the amount of texture in the scene
+ * cancels out: a sharp view of a bare wall scores like a sharp view of a shelf. Frames with no
+ * structure at the coarse scale score 1 and are always accepted.
+ *
+ * The sharpness is compared with a reference that follows the sharpest recent frames and
+ * decays over time, which adapts the threshold to the camera's optics and noise. When the
+ * camera is known to be rotating, the required ratio is raised further.
+ */
+class SharpnessGate {
+public:
+  explicit SharpnessGate(const SharpnessGateConfig & config = SharpnessGateConfig());
+
+  /**
+   * @brief Measures the sharpness of a frame and updates the reference
+   * @param image 8-bit grayscale, BGR or BGRA frame
+   * @param stamp Capture time of the frame, in seconds
+   * @param angular_velocity Camera angular velocity, in rad/s, 0 if unknown
+   * @return Whether detection should run on this frame
+   */
+  bool accept(const cv::Mat & image, double stamp, double angular_velocity = 0.0);
+
+  /// @brief Sharpness of the last frame passed to accept()
+  double last_sharpness() const {return last_sharpness_;}
+  /// @brief Sharpness below which the last frame would have been skipped
+  double last_threshold() const {return last_threshold_;}
+  const SharpnessGateStats & stats() const {return stats_;}
+
+  /// @brief Forgets the reference, e.g. when the camera stream restarts
+  void reset();
+
+private:
+  double measure(const cv::Mat & image);
+  static double gradient_energy(const cv::Mat & image, int dx, int dy, cv::Mat & gradient);
+
+  SharpnessGateConfig config_;
+  SharpnessGateStats stats_;
+  double reference_ = 0.0;
+  double reference_stamp_ = 0.0;
+  double last_sharpness_ = 0.0;
+  double last_threshold_ = 0.0;
+
+  /// Reused between frames
+  cv::Mat small_;
+  cv::Mat gray_;
+  cv::Mat coarse_;
+  cv::Mat gradient_;
+};
+
+}  // namespace aruco_opencv
@@ -0,0 +1,81 @@
+// Copyright 2025 Fictionlab sp. z o.o.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace aruco_opencv
+{
+
+/**
+ * @brief Threading policy of the detection pipeline
+ *
+ * Controls the size of OpenCV's thread pool, the CPUs that detection may run on and an optional
+ * real-time scheduling priority. The affinity and priority are applied to the threads that run
+ * the pipeline; OpenCV's pthreads pool creates its workers lazily from such a thread, so they
+ * inherit both. With TBB or OpenMP builds of OpenCV only the pool size is honoured.
+ */
+class ThreadPolicy {
+public:
+  /**
+   * @brief Sets up the policy and resizes OpenCV's thread pool
+   * @param num_threads Size of the pool, -1 for OpenCV's default, 0 or 1 to run in the caller
+   * @param cpu_affinity CPU list such as "2-3,6", empty to leave the affinity unchanged
+   * @param realtime_priority SCHED_FIFO priority (1-99), 0 to keep the default scheduler
+   * @param error_message Set to a human readable reason on failure
+   * @return Whether the policy is valid
+   */
+  bool configure(
+    int num_threads, const std::string & cpu_affinity, int realtime_priority,
+    std::string & error_message);
+
+  /**
+   * @brief Applies the affinity and priority to the calling thread
+   *
+   * Each thread is handled once, so it can be called for every frame, also from the threads of
+   * a multi-threaded executor. Safe to call from several threads at once.
+   * @param error_message Set to a human readable reason on failure
+   * @return Whether the policy was applied now; false also if there was nothing to do
+   */
+  bool apply_to_current_thread(std::string & error_message);
+
+  /// @brief Whether the policy changes anything about the calling thread
+  bool pins_threads() const {return !cpus_.empty() || realtime_priority_ > 0;}
+
+  /**
+   * @brief Parses a CPU list such as "0,2-3"
+   * @return Whether the list is valid
+   */
+  static bool parse_cpu_list(
+    const std::string & spec, std::vector<int> & cpus, std::string & error_message);
+
+private:
+  std::vector<int> cpus_;
+  int realtime_priority_ = 0;
+  std::mutex applied_mutex_;
+  std::set<std::thread::id> applied_threads_;
+};
+
+}  // namespace aruco_opencv
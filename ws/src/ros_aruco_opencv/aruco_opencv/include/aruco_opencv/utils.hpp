@@ -28,6 +28,8 @@
 
 #include "geometry_msgs/msg/pose.hpp"
 #include "cv_bridge/cv_bridge.hpp"
+#include "aruco_opencv_msgs/msg/aruco_detection.hpp"
+#include "aruco_opencv_msgs/msg/bounded_aruco_detection.hpp"
 
 #include "aruco_opencv/parameters.hpp"
 
@@ -44,6 +46,16 @@ using ArucoDictType = cv::aruco::PREDEFINED_DICTIONARY_NAME;
 
 extern const std::unordered_map<std::string, ArucoDictType> ARUCO_DICT_MAP;
 
+/**
+ * @brief Copies a detection into its fixed-size variant
+ * @param detection Input detection
+ * @param bounded Output detection, overwritten in place
+ * @return False if the frame ID, the marker or board list, or any board name was truncated
+ */
+bool fill_bounded_detection(
+  const aruco_opencv_msgs::msg::ArucoDetection & detection,
+  aruco_opencv_msgs::msg::BoundedArucoDetection & bounded);
+
 PoseSelectorStrategy parse_selector_strategy(const std::string & name);
 std::string pose_selector_strategy_to_string(PoseSelectorStrategy strategy);
 
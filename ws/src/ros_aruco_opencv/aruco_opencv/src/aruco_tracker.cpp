@@ -18,11 +18,16 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cmath>
 #include <mutex>
 #include <chrono>
 
 #include <opencv2/aruco.hpp>
 #include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
 
 #include "yaml-cpp/yaml.h"
 
@@ -37,14 +42,20 @@
 #include "sensor_msgs/msg/camera_info.hpp"
 #include "sensor_msgs/msg/image.hpp"
 #include "image_transport/camera_common.hpp"
+#include "nav_msgs/msg/odometry.hpp"
 
 #include "aruco_opencv_msgs/msg/aruco_detection.hpp"
+#include "aruco_opencv_msgs/msg/aruco_image_detection.hpp"
 #include "aruco_opencv_msgs/msg/board_pose.hpp"
+#include "aruco_opencv_msgs/msg/bounded_aruco_detection.hpp"
 
 #include "aruco_opencv/utils.hpp"
 #include "aruco_opencv/parameters.hpp"
 #include "aruco_opencv/detector.hpp"
 #include "aruco_opencv/board_loader.hpp"
+#include "aruco_opencv/camera_info_loader.hpp"
+#include "aruco_opencv/sharpness_gate.hpp"
+#include "aruco_opencv/threading.hpp"
 
 using rclcpp_lifecycle::node_interfaces::LifecycleNodeInterface;
 
@@ -64,17 +75,31 @@ class ArucoTracker : public rclcpp_lifecycle::LifecycleNode
   PostSetParametersCallbackHandle::SharedPtr post_set_parameter_callback_handle_;
   rclcpp_lifecycle::LifecyclePublisher<aruco_opencv_msgs::msg::ArucoDetection>::SharedPtr
     detection_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<aruco_opencv_msgs::msg::BoundedArucoDetection>::SharedPtr
+    bounded_detection_pub_;
+  rclcpp_lifecycle::LifecyclePublisher<aruco_opencv_msgs::msg::ArucoImageDetection>::SharedPtr
+    image_detection_pub_;
   rclcpp_lifecycle::LifecyclePublisher<sensor_msgs::msg::Image>::SharedPtr debug_pub_;
   rclcpp::Subscription<sensor_msgs::msg::CameraInfo>::SharedPtr cam_info_sub_;
   rclcpp::Subscription<sensor_msgs::msg::Image>::SharedPtr img_sub_;
   rclcpp::Subscription<sensor_msgs::msg::CompressedImage>::SharedPtr compressed_img_sub_;
+  rclcpp::Subscription<nav_msgs::msg::Odometry>::SharedPtr odom_sub_;
   rclcpp::Time last_msg_stamp_;
   bool cam_info_retrieved_ = false;
+  bool cam_info_from_file_ = false;
+  cv::Size calibrated_image_size_{640, 480};
   rclcpp::Time callback_start_time_;
 
   // Aruco
   std::vector<std::pair<std::string, cv::Ptr<cv::aruco::Board>>> boards_;
   std::unique_ptr<ArucoDetector> detector_;
+  FrameContext frame_ctx_;
+  ThreadPolicy thread_policy_;
+  aruco_opencv_msgs::msg::BoundedArucoDetection bounded_detection_;
+
+  // Motion blur gating
+  std::unique_ptr<SharpnessGate> sharpness_gate_;
+  std::atomic<double> angular_velocity_{0.0};
 
   // Tf2
   std::shared_ptr<tf2_ros::Buffer> tf_buffer_;
@@ -100,13 +125,24 @@ public:
 
     retrieve_parameters();
 
-    if (ARUCO_DICT_MAP.find(params_.marker_dict) == ARUCO_DICT_MAP.end()) {
+    detector_ = std::make_unique<ArucoDetector>(get_logger().get_child("ArucoDetector"));
+
+    if (!params_.marker_dict_path.empty()) {
+      std::string err;
+      if (!detector_->set_dictionary_from_file(params_.marker_dict_path, err)) {
+        RCLCPP_ERROR_STREAM(get_logger(), err);
+        detector_.reset();
+        return LifecycleNodeInterface::CallbackReturn::FAILURE;
+      }
+      RCLCPP_INFO_STREAM(get_logger(),
+          "Using precompiled dictionary from " << params_.marker_dict_path);
+    } else if (ARUCO_DICT_MAP.find(params_.marker_dict) == ARUCO_DICT_MAP.end()) {
       RCLCPP_ERROR_STREAM(get_logger(), "Unsupported dictionary name: " << params_.marker_dict);
+      detector_.reset();
       return LifecycleNodeInterface::CallbackReturn::FAILURE;
+    } else {
+      detector_->set_dictionary(params_.marker_dict);
     }
-
-    detector_ = std::make_unique<ArucoDetector>(get_logger().get_child("ArucoDetector"));
-    detector_->set_dictionary(params_.marker_dict);
     detector_->set_detector_parameters(detector_params_);
     detector_->set_aruco_parameters(aruco_parameters_);
 
@@ -115,6 +151,41 @@ public:
     }
     detector_->set_boards(boards_);
 
+    cam_info_from_file_ = false;
+    if (!params_.camera_info_path.empty()) {
+      load_camera_info();
+    }
+
+    std::string err;
+    if (!thread_policy_.configure(params_.num_threads, params_.cpu_affinity,
+        params_.realtime_priority, err))
+    {
+      RCLCPP_ERROR_STREAM(get_logger(), err);
+      detector_.reset();
+      return LifecycleNodeInterface::CallbackReturn::FAILURE;
+    }
+    RCLCPP_INFO(
+      get_logger(), "OpenCV thread pool size: %d, parallel pose estimation from %d markers",
+      cv::getNumThreads(), detector_params_.min_markers_parallel_pnp);
+    // The warm-up creates the pool's threads, which inherit the policy from this one
+    apply_thread_policy();
+
+    if (params_.warmup) {
+      warm_up();
+    }
+
+    if (params_.blur_gate) {
+      SharpnessGateConfig gate_config;
+      gate_config.width = params_.blur_gate_width;
+      gate_config.min_ratio = params_.blur_gate_min_ratio;
+      gate_config.reference_half_life = params_.blur_gate_reference_half_life;
+      gate_config.angular_velocity_gain = params_.blur_gate_angular_velocity_gain;
+      sharpness_gate_ = std::make_unique<SharpnessGate>(gate_config);
+      RCLCPP_INFO(
+        get_logger(), "Skipping detection on frames less than %.0f %% as sharp as recent ones",
+        gate_config.min_ratio * 100.0);
+    }
+
     if (params_.publish_tf) {
       tf_broadcaster_ = std::make_shared<tf2_ros::TransformBroadcaster>(*this);
     }
@@ -122,6 +193,14 @@ public:
     detection_pub_ = create_publisher<aruco_opencv_msgs::msg::ArucoDetection>(
       "aruco_detections", 5);
     debug_pub_ = create_publisher<sensor_msgs::msg::Image>("~/debug", 5);
+    if (params_.publish_image_detections) {
+      image_detection_pub_ = create_publisher<aruco_opencv_msgs::msg::ArucoImageDetection>(
+        "aruco_image_detections", 5);
+    }
+    if (params_.publish_bounded_detections) {
+      bounded_detection_pub_ = create_publisher<aruco_opencv_msgs::msg::BoundedArucoDetection>(
+        "aruco_detections_bounded", 5);
+    }
 
     return LifecycleNodeInterface::CallbackReturn::SUCCESS;
   }
@@ -139,15 +218,35 @@ public:
 
     detection_pub_->on_activate();
     debug_pub_->on_activate();
+    if (bounded_detection_pub_) {
+      bounded_detection_pub_->on_activate();
+    }
+    if (image_detection_pub_) {
+      image_detection_pub_->on_activate();
+    }
 
     on_set_parameter_callback_handle_ = add_on_set_parameters_callback(
       std::bind(&ArucoTracker::callback_on_set_parameters, this, std::placeholders::_1));
     post_set_parameter_callback_handle_ = add_post_set_parameters_callback(
       std::bind(&ArucoTracker::callback_post_set_parameters, this, std::placeholders::_1));
 
-    RCLCPP_INFO(get_logger(), "Waiting for first camera info...");
+    if (cam_info_from_file_) {
+      RCLCPP_INFO(get_logger(), "Using calibration file until the first camera info arrives");
+    } else {
+      RCLCPP_INFO(get_logger(), "Waiting for first camera info...");
+    }
 
-    cam_info_retrieved_ = false;
+    cam_info_retrieved_ = cam_info_from_file_;
+
+    if (sharpness_gate_) {
+      sharpness_gate_->reset();
+      angular_velocity_ = 0.0;
+      if (!params_.blur_gate_odom_topic.empty()) {
+        odom_sub_ = create_subscription<nav_msgs::msg::Odometry>(
+          params_.blur_gate_odom_topic, 10,
+          std::bind(&ArucoTracker::callback_odometry, this, std::placeholders::_1));
+      }
+    }
 
     std::string image_topic = rclcpp::expand_topic_or_service_name(
       params_.cam_base_topic, this->get_name(), this->get_namespace());
@@ -182,16 +281,25 @@ public:
   {
     RCLCPP_INFO(get_logger(), "Deactivating");
 
+    log_frame_stats();
+
     on_set_parameter_callback_handle_.reset();
     post_set_parameter_callback_handle_.reset();
     cam_info_sub_.reset();
     img_sub_.reset();
     compressed_img_sub_.reset();
+    odom_sub_.reset();
     tf_listener_.reset();
     tf_buffer_.reset();
 
     detection_pub_->on_deactivate();
     debug_pub_->on_deactivate();
+    if (bounded_detection_pub_) {
+      bounded_detection_pub_->on_deactivate();
+    }
+    if (image_detection_pub_) {
+      image_detection_pub_->on_deactivate();
+    }
 
     return LifecycleNodeInterface::CallbackReturn::SUCCESS;
   }
@@ -202,10 +310,14 @@ public:
 
     tf_broadcaster_.reset();
     aruco_parameters_.reset();
+    boards_.clear();
     detector_.reset();
     detection_pub_.reset();
+    bounded_detection_pub_.reset();
+    image_detection_pub_.reset();
     debug_pub_.reset();
-    boards_.clear();
+    frame_ctx_ = FrameContext();
+    sharpness_gate_.reset();
 
     return LifecycleNodeInterface::CallbackReturn::SUCCESS;
   }
@@ -219,14 +331,18 @@ public:
     cam_info_sub_.reset();
     img_sub_.reset();
     compressed_img_sub_.reset();
+    odom_sub_.reset();
     tf_listener_.reset();
     tf_buffer_.reset();
     tf_broadcaster_.reset();
     aruco_parameters_.reset();
+    boards_.clear();
     detector_.reset();
+    sharpness_gate_.reset();
     detection_pub_.reset();
+    bounded_detection_pub_.reset();
+    image_detection_pub_.reset();
     debug_pub_.reset();
-    boards_.clear();
 
     return LifecycleNodeInterface::CallbackReturn::SUCCESS;
   }
@@ -305,6 +421,61 @@ protected:
     }
   }
 
+  void load_camera_info()
+  {
+    RCLCPP_INFO_STREAM(get_logger(),
+        "Trying to load camera calibration from " << params_.camera_info_path);
+    std::string err;
+    sensor_msgs::msg::CameraInfo cam_info;
+    if (!CameraInfoLoader::load_from_file(params_.camera_info_path, cam_info, err)) {
+      RCLCPP_ERROR_STREAM(get_logger(), err);
+      return;
+    }
+    detector_->update_camera_info(cam_info, params_.image_is_rectified);
+    calibrated_image_size_ = cv::Size(cam_info.width, cam_info.height);
+    cam_info_from_file_ = true;
+  }
+
+  /**
+   * @brief Runs the full detection pipeline once on a synthetic frame
+   *
+   * Creates the OpenCV thread pool and performs lazy allocations up front, so that the first
+   * camera frame is processed as fast as the following ones.
+   */
+  void warm_up()
+  {
+    auto start = std::chrono::steady_clock::now();
+
+    const int side = std::min(calibrated_image_size_.width, calibrated_image_size_.height) / 2;
+    cv::Mat frame(calibrated_image_size_, CV_8UC3, cv::Scalar::all(255));
+    cv::Mat marker;
+    #if CV_VERSION_MAJOR > 4 || CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 7
+    cv::aruco::generateImageMarker(*detector_->get_dictionary(), 0, side, marker);
+    #else
+    cv::aruco::drawMarker(detector_->get_dictionary(), 0, side, marker);
+    #endif
+    cv::cvtColor(marker, marker, cv::COLOR_GRAY2BGR);
+    marker.copyTo(frame(cv::Rect(
+        (frame.cols - side) / 2, (frame.rows - side) / 2, side, side)));
+
+    // Running through the pipeline's own frame context also pre-sizes its buffers
+    frame_ctx_.begin_frame();
+    // The synthetic marker is not sized for the candidate distance range, which would reject it
+    detector_->detect(frame, frame_ctx_, false);
+
+    // Pose estimation needs valid intrinsics, which are only known here if loaded from file
+    if (cam_info_from_file_) {
+      detector_->estimate_marker_poses(frame_ctx_);
+      detector_->estimate_board_poses(frame_ctx_);
+    }
+
+    double duration = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
+    RCLCPP_INFO(
+      get_logger(), "Detector warm-up completed in %.4f s (%zu marker(s) detected)", duration,
+      frame_ctx_.marker_ids.size());
+  }
+
   void callback_camera_info(const sensor_msgs::msg::CameraInfo::ConstSharedPtr cam_info)
   {
     detector_->update_camera_info(*cam_info, params_.image_is_rectified);
@@ -315,6 +486,12 @@ protected:
     }
   }
 
+  void callback_odometry(const nav_msgs::msg::Odometry::ConstSharedPtr odom)
+  {
+    const auto & w = odom->twist.twist.angular;
+    angular_velocity_ = std::sqrt(w.x * w.x + w.y * w.y + w.z * w.z);
+  }
+
   void callback_compressed_image(const sensor_msgs::msg::CompressedImage::ConstSharedPtr img_msg)
   {
     if (!should_process_img_msg(img_msg)) {
@@ -362,22 +539,27 @@ protected:
 
   void process_image(const cv_bridge::CvImageConstPtr & cv_ptr)
   {
-    std::vector<int> marker_ids;
-    std::vector<std::vector<cv::Point2f>> marker_corners;
-    detector_->detect(cv_ptr->image, marker_ids, marker_corners);
+    apply_thread_policy();
+
+    if (sharpness_gate_ && !is_sharp(cv_ptr)) {
+      return;
+    }
+
+    auto & ctx = frame_ctx_;
+    ctx.begin_frame();
 
-    int n_markers = marker_ids.size();
-    std::vector<cv::Vec3d> rvec_final, tvec_final;
+    detector_->detect(cv_ptr->image, ctx);
 
-    aruco_opencv_msgs::msg::ArucoDetection detection;
+    auto & detection = ctx.detection;
     detection.header.frame_id = cv_ptr->header.frame_id;
     detection.header.stamp = cv_ptr->header.stamp;
 
-    detector_->estimate_marker_poses(marker_ids, marker_corners, detection.markers, rvec_final,
-        tvec_final);
+    detector_->estimate_marker_poses(ctx);
+    detector_->estimate_board_poses(ctx);
 
-    detector_->estimate_board_poses(marker_ids, marker_corners, detection.boards, rvec_final,
-        tvec_final);
+    if (image_detection_pub_) {
+      publish_image_detection(cv_ptr);
+    }
 
     if (transform_poses_ && (detection.markers.size() > 0 || detection.boards.size() > 0)) {
       detection.header.frame_id = params_.output_frame;
@@ -389,6 +571,8 @@ protected:
           cv_ptr->header.stamp, rclcpp::Duration::from_seconds(1.0));
       } catch (tf2::TransformException & ex) {
         RCLCPP_ERROR_STREAM(get_logger(), ex.what());
+        // The frame still counts towards the frame and buffer growth stats
+        ctx.end_frame();
         return;
       }
       for (auto & marker_pose : detection.markers) {
@@ -400,45 +584,46 @@ protected:
     }
 
     if (params_.publish_tf && detection.markers.size() > 0) {
-      std::vector<geometry_msgs::msg::TransformStamped> transforms;
+      auto & transforms = ctx.transforms;
+      transforms.resize(detection.markers.size() + detection.boards.size());
+      size_t t = 0;
       for (auto & marker_pose : detection.markers) {
-        geometry_msgs::msg::TransformStamped transform;
-        transform.header.stamp = detection.header.stamp;
-        transform.header.frame_id = detection.header.frame_id;
-        transform.child_frame_id = std::string("marker_") + std::to_string(marker_pose.marker_id);
-        tf2::Transform tf_transform;
-        tf2::fromMsg(marker_pose.pose, tf_transform);
-        transform.transform = tf2::toMsg(tf_transform);
-        transforms.push_back(transform);
+        auto & transform = transforms[t++];
+        transform.header = detection.header;
+        transform.child_frame_id.assign("marker_");
+        transform.child_frame_id += std::to_string(marker_pose.marker_id);
+        set_transform_from_pose(marker_pose.pose, transform.transform);
       }
       for (auto & board_pose : detection.boards) {
-        geometry_msgs::msg::TransformStamped transform;
-        transform.header.stamp = detection.header.stamp;
-        transform.header.frame_id = detection.header.frame_id;
-        transform.child_frame_id = std::string("board_") + board_pose.board_name;
-        tf2::Transform tf_transform;
-        tf2::fromMsg(board_pose.pose, tf_transform);
-        transform.transform = tf2::toMsg(tf_transform);
-        transforms.push_back(transform);
+        auto & transform = transforms[t++];
+        transform.header = detection.header;
+        transform.child_frame_id.assign("board_");
+        transform.child_frame_id += board_pose.board_name;
+        set_transform_from_pose(board_pose.pose, transform.transform);
       }
       tf_broadcaster_->sendTransform(transforms);
     }
 
+    // Publishing by reference lets the middleware serialize straight from the pooled message
     detection_pub_->publish(detection);
 
+    if (bounded_detection_pub_) {
+      publish_bounded_detection(detection);
+    }
+
     if (debug_pub_->get_subscription_count() > 0) {
       auto debug_cv_ptr = std::make_shared<cv_bridge::CvImage>();
       debug_cv_ptr->header = cv_ptr->header;
       debug_cv_ptr->encoding = cv_ptr->encoding;
       debug_cv_ptr->image = cv_ptr->image.clone();
-      cv::aruco::drawDetectedMarkers(debug_cv_ptr->image, marker_corners, marker_ids);
+      cv::aruco::drawDetectedMarkers(debug_cv_ptr->image, ctx.marker_corners, ctx.marker_ids);
       {
         cv::Mat camera_matrix, distortion_coeffs;
         detector_->get_intrinsics(camera_matrix, distortion_coeffs);
-        for (size_t i = 0; i < rvec_final.size(); i++) {
+        for (size_t i = 0; i < ctx.rvecs.size(); i++) {
           cv::drawFrameAxes(
-            debug_cv_ptr->image, camera_matrix, distortion_coeffs, rvec_final[i],
-            tvec_final[i], 0.2, 3);
+            debug_cv_ptr->image, camera_matrix, distortion_coeffs, ctx.rvecs[i],
+            ctx.tvecs[i], 0.2, 3);
         }
       }
       std::unique_ptr<sensor_msgs::msg::Image> debug_img =
@@ -447,6 +632,8 @@ protected:
       debug_pub_->publish(std::move(debug_img));
     }
 
+    bool buffers_grew = ctx.end_frame();
+
     auto callback_end_time = get_clock()->now();
     double whole_callback_duration = (callback_end_time - callback_start_time_).seconds();
     double image_send_duration = (callback_start_time_ - cv_ptr->header.stamp).seconds();
@@ -455,6 +642,152 @@ protected:
       get_logger(), "Image callback completed. The callback started %.4f s after the image"
       " frame was grabbed and completed its execution in %.4f s.", image_send_duration,
       whole_callback_duration);
+    RCLCPP_DEBUG(
+      get_logger(), "Frame buffers %s (%" PRIu64 " of %" PRIu64
+      " frames required growing buffers)",
+      buffers_grew ? "grew" : "reused", ctx.stats.frames_with_growth, ctx.stats.frames);
+    RCLCPP_DEBUG(
+      get_logger(), "Decoded %zu candidate(s), %zu matched no marker",
+      ctx.marker_ids.size() + ctx.rejected_corners.size(), ctx.rejected_corners.size());
+  }
+
+  void apply_thread_policy()
+  {
+    std::string err;
+    if (thread_policy_.apply_to_current_thread(err)) {
+      RCLCPP_DEBUG(
+        get_logger(), "Applied threading policy (CPUs '%s', real-time priority %d) to a "
+        "detection thread", params_.cpu_affinity.c_str(), params_.realtime_priority);
+    } else if (!err.empty()) {
+      RCLCPP_WARN_STREAM(get_logger(), err);
+    }
+  }
+
+  /**
+   * @brief Runs the motion blur gate on a frame
+   *
+   * Blurred frames publish nothing at all: an empty detection would tell consumers that no
+   * marker is in view, and corners found in them are too unreliable to be published.
+   */
+  bool is_sharp(const cv_bridge::CvImageConstPtr & cv_ptr)
+  {
+    const double angular_velocity = angular_velocity_;
+    const bool sharp = sharpness_gate_->accept(
+      cv_ptr->image, rclcpp::Time(cv_ptr->header.stamp).seconds(), angular_velocity);
+
+    const auto & stats = sharpness_gate_->stats();
+    RCLCPP_DEBUG(
+      get_logger(), "Frame sharpness %.3f, threshold %.3f at %.2f rad/s: %s",
+      sharpness_gate_->last_sharpness(), sharpness_gate_->last_threshold(), angular_velocity,
+      sharp ? "detecting" : "skipped");
+    RCLCPP_INFO_THROTTLE(
+      get_logger(), *get_clock(), 10000, "Blur gate skipped %" PRIu64 " of %" PRIu64
+      " frames (%.1f %%)", stats.skipped, stats.frames, stats.skip_rate() * 100.0);
+    return sharp;
+  }
+
+  void publish_image_detection(const cv_bridge::CvImageConstPtr & cv_ptr)
+  {
+    auto & ctx = frame_ctx_;
+    auto & image_detection = ctx.image_detection;
+    image_detection.header = cv_ptr->header;
+    image_detection.image_width = cv_ptr->image.cols;
+    image_detection.image_height = cv_ptr->image.rows;
+    image_detection.markers.resize(ctx.marker_ids.size());
+
+    for (size_t i = 0; i < ctx.marker_ids.size(); ++i) {
+      const cv::Point2f * c = &ctx.corners[4 * i];
+      auto & marker = image_detection.markers[i];
+      marker.marker_id = ctx.marker_ids[i];
+
+      float perimeter = 0.0f;
+      for (size_t k = 0; k < 4; ++k) {
+        marker.corners[k].x = c[k].x;
+        marker.corners[k].y = c[k].y;
+        marker.corners[k].z = 0.0f;
+        perimeter += static_cast<float>(cv::norm(c[(k + 1) % 4] - c[k]));
+      }
+      marker.size = perimeter / 4.0f;
+
+      // The projected centre of a square is the intersection of its diagonals
+      const cv::Point2f d1 = c[2] - c[0];
+      const cv::Point2f d2 = c[3] - c[1];
+      const float denom = d1.cross(d2);
+      cv::Point2f center = (c[0] + c[1] + c[2] + c[3]) * 0.25f;
+      if (std::abs(denom) > 1e-6f) {
+        center = c[0] + d1 * ((c[1] - c[0]).cross(d2) / denom);
+      }
+      marker.center.x = center.x;
+      marker.center.y = center.y;
+      marker.center.z = 0.0f;
+
+      marker.reprojection_error = ctx.reproj_errors.empty() ? -1.0f : ctx.reproj_errors[i];
+    }
+
+    image_detection_pub_->publish(image_detection);
+  }
+
+  void publish_bounded_detection(const aruco_opencv_msgs::msg::ArucoDetection & detection)
+  {
+    bool complete;
+    if (bounded_detection_pub_->can_loan_messages()) {
+      // Fill the middleware-owned buffer in place, avoiding serialization on shared memory
+      auto loaned = bounded_detection_pub_->borrow_loaned_message();
+      complete = fill_bounded_detection(detection, loaned.get());
+      bounded_detection_pub_->publish(std::move(loaned));
+    } else {
+      complete = fill_bounded_detection(detection, bounded_detection_);
+      bounded_detection_pub_->publish(bounded_detection_);
+    }
+
+    if (!complete) {
+      RCLCPP_WARN_THROTTLE(
+        get_logger(), *get_clock(), 5000,
+        "Detection does not fit in BoundedArucoDetection, some entries were truncated");
+    }
+  }
+
+  static void set_transform_from_pose(
+    const geometry_msgs::msg::Pose & pose,
+    geometry_msgs::msg::Transform & transform)
+  {
+    transform.translation.x = pose.position.x;
+    transform.translation.y = pose.position.y;
+    transform.translation.z = pose.position.z;
+    transform.rotation = pose.orientation;
+  }
+
+  void log_frame_stats()
+  {
+    const auto & stats = frame_ctx_.stats;
+    RCLCPP_INFO(
+      get_logger(), "Processed %" PRIu64 " frames, %" PRIu64 " of them required growing frame "
+      "buffers (last at frame %" PRIu64 ")", stats.frames, stats.frames_with_growth,
+      stats.last_growth_frame);
+
+    const auto & candidates = frame_ctx_.candidate_stats;
+    RCLCPP_INFO(
+      get_logger(), "Decoded %" PRIu64 " quad candidates, %" PRIu64 " (%.1f %%) matched no "
+      "marker", candidates.decoded, candidates.rejected, candidates.rejection_rate() * 100.0);
+    if (candidates.recovered > 0) {
+      RCLCPP_INFO(
+        get_logger(), "Cell sampler recovered %" PRIu64 " marker(s) from the rejected "
+        "candidates", candidates.recovered);
+    }
+    if (candidates.audited_frames > 0) {
+      RCLCPP_INFO(
+        get_logger(), "Candidate distance range removed %.1f %% of the candidates before "
+        "decoding and %" PRIu64 " marker(s), over %" PRIu64 " audited frames",
+        candidates.size_filter_rate() * 100.0, candidates.audit_markers_lost,
+        candidates.audited_frames);
+    }
+
+    if (sharpness_gate_) {
+      const auto & gate_stats = sharpness_gate_->stats();
+      RCLCPP_INFO(
+        get_logger(), "Blur gate skipped %" PRIu64 " of %" PRIu64 " frames (%.1f %%)",
+        gate_stats.skipped, gate_stats.frames, gate_stats.skip_rate() * 100.0);
+    }
   }
 };
 
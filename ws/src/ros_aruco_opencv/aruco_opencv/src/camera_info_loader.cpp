@@ -0,0 +1,80 @@
+// Copyright 2025 Fictionlab sp. z o.o.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "aruco_opencv/camera_info_loader.hpp"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "yaml-cpp/yaml.h"
+
+namespace aruco_opencv
+{
+
+template<size_t N>
+static void parse_matrix(const YAML::Node & node, std::array<double, N> & out)
+{
+  auto data = node["data"].as<std::vector<double>>();
+  if (data.size() != N) {
+    throw YAML::Exception(node.Mark(),
+            "expected " + std::to_string(N) + " values, got " + std::to_string(data.size()));
+  }
+  std::copy(data.begin(), data.end(), out.begin());
+}
+
+bool CameraInfoLoader::load_from_file(
+  const std::string & path,
+  sensor_msgs::msg::CameraInfo & out_cam_info,
+  std::string & error_message)
+{
+  try {
+    YAML::Node calib = YAML::LoadFile(path);
+
+    out_cam_info.width = calib["image_width"].as<uint32_t>();
+    out_cam_info.height = calib["image_height"].as<uint32_t>();
+    parse_matrix(calib["camera_matrix"], out_cam_info.k);
+
+    if (calib["distortion_model"]) {
+      out_cam_info.distortion_model = calib["distortion_model"].as<std::string>();
+    }
+    if (calib["distortion_coefficients"]) {
+      out_cam_info.d = calib["distortion_coefficients"]["data"].as<std::vector<double>>();
+    }
+    if (calib["rectification_matrix"]) {
+      parse_matrix(calib["rectification_matrix"], out_cam_info.r);
+    }
+    if (calib["projection_matrix"]) {
+      parse_matrix(calib["projection_matrix"], out_cam_info.p);
+    } else {
+      // Without a projection matrix, assume the camera matrix with no translation
+      out_cam_info.p = {
+        out_cam_info.k[0], out_cam_info.k[1], out_cam_info.k[2], 0.0,
+        out_cam_info.k[3], out_cam_info.k[4], out_cam_info.k[5], 0.0,
+        out_cam_info.k[6], out_cam_info.k[7], out_cam_info.k[8], 0.0};
+    }
+  } catch (const YAML::Exception & e) {
+    error_message = std::string("Failed to load camera calibration: ") + e.what();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace aruco_opencv
@@ -0,0 +1,169 @@
+// Copyright 2025 Fictionlab sp. z o.o.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "aruco_opencv/cell_sampler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace aruco_opencv
+{
+
+/// @brief Projective map from the unit square to a quadrilateral
+struct SquareToQuad
+{
+  float a, b, c, d, e, f, g, h;
+
+  /// Maps (u, v) of the unit square, u along corners 0 to 1 and v along corners 0 to 3
+  void apply(float u, float v, float & x, float & y) const
+  {
+    const float w = 1.0f / (g * u + h * v + 1.0f);
+    x = (a * u + b * v + c) * w;
+    y = (d * u + e * v + f) * w;
+  }
+};
+
+/// Closed form of the unit square to quadrilateral homography, no linear solve needed
+static bool square_to_quad(const float * p, SquareToQuad & m)
+{
+  const float x0 = p[0], y0 = p[1], x1 = p[2], y1 = p[3];
+  const float x2 = p[4], y2 = p[5], x3 = p[6], y3 = p[7];
+  const float sx = x0 - x1 + x2 - x3;
+  const float sy = y0 - y1 + y2 - y3;
+  if (sx == 0.0f && sy == 0.0f) {
+    m = {x1 - x0, x3 - x0, x0, y1 - y0, y3 - y0, y0, 0.0f, 0.0f};
+    return true;
+  }
+  const float dx1 = x1 - x2, dx2 = x3 - x2, dy1 = y1 - y2, dy2 = y3 - y2;
+  const float det = dx1 * dy2 - dx2 * dy1;
+  if (std::abs(det) < 1e-9f) {
+    return false;
+  }
+  m.g = (sx * dy2 - dx2 * sy) / det;
+  m.h = (dx1 * sy - sx * dy1) / det;
+  m.a = x1 - x0 + m.g * x1;
+  m.b = x3 - x0 + m.h * x3;
+  m.c = x0;
+  m.d = y1 - y0 + m.g * y1;
+  m.e = y3 - y0 + m.h * y3;
+  m.f = y0;
+  return true;
+}
+
+static inline float sample_bilinear(const GrayImageView & image, float x, float y)
+{
+  x = std::min(std::max(x, 0.0f), static_cast<float>(image.width - 1));
+  y = std::min(std::max(y, 0.0f), static_cast<float>(image.height - 1));
+  const int x0 = std::min(static_cast<int>(x), image.width - 2);
+  const int y0 = std::min(static_cast<int>(y), image.height - 2);
+  const float fx = x - x0;
+  const float fy = y - y0;
+  const uint8_t * row0 = image.data + static_cast<size_t>(y0) * image.step + x0;
+  const uint8_t * row1 = row0 + image.step;
+  const float top = row0[0] + fx * (row0[1] - row0[0]);
+  const float bottom = row1[0] + fx * (row1[1] - row1[0]);
+  return top + fy * (bottom - top);
+}
+
+template<int N>
+static bool sample_cells(
+  const GrayImageView & image, const float * corners, const CellSamplerConfig & config,
+  uint8_t * bits)
+{
+  constexpr int G = N + 2;
+  constexpr int CELLS = G * G;
+
+  SquareToQuad map;
+  if (image.width < 2 || image.height < 2 || !square_to_quad(corners, map)) {
+    return false;
+  }
+
+  std::array<float, CELLS> samples;
+  float sum = 0.0f, sum_sq = 0.0f;
+  for (int r = 0; r < G; ++r) {
+    const float v = (r + 0.5f) / G;
+    for (int c = 0; c < G; ++c) {
+      float x, y;
+      map.apply((c + 0.5f) / G, v, x, y);
+      const float s = sample_bilinear(image, x, y);
+      samples[r * G + c] = s;
+      sum += s;
+      sum_sq += s * s;
+    }
+  }
+
+  const float mean = sum / CELLS;
+  const float variance = std::max(0.0f, sum_sq / CELLS - mean * mean);
+  if (std::sqrt(variance) < config.min_stddev) {
+    return false;
+  }
+
+  // Otsu's threshold over the samples: the split of the sorted values with the largest
+  // between-class variance
+  std::array<float, CELLS> sorted = samples;
+  std::sort(sorted.begin(), sorted.end());
+  float threshold = mean;
+  float best = -1.0f;
+  float below = 0.0f;
+  for (int k = 1; k < CELLS; ++k) {
+    below += sorted[k - 1];
+    const float m0 = below / k;
+    const float m1 = (sum - below) / (CELLS - k);
+    const float between = static_cast<float>(k) * (CELLS - k) * (m1 - m0) * (m1 - m0);
+    if (between > best) {
+      best = between;
+      threshold = 0.5f * (sorted[k - 1] + sorted[k]);
+    }
+  }
+
+  int border_errors = 0;
+  for (int i = 0; i < G; ++i) {
+    border_errors += samples[i] > threshold;
+    border_errors += samples[(G - 1) * G + i] > threshold;
+  }
+  for (int i = 1; i < G - 1; ++i) {
+    border_errors += samples[i * G] > threshold;
+    border_errors += samples[i * G + G - 1] > threshold;
+  }
+  if (border_errors > static_cast<int>(N * N * config.max_border_error_rate)) {
+    return false;
+  }
+
+  for (int r = 0; r < N; ++r) {
+    for (int c = 0; c < N; ++c) {
+      bits[r * N + c] = samples[(r + 1) * G + c + 1] > threshold;
+    }
+  }
+  return true;
+}
+
+CellSamplerKernel get_cell_sampler_kernel(int marker_size)
+{
+  switch (marker_size) {
+    case 4: return &sample_cells<4>;
+    case 5: return &sample_cells<5>;
+    case 6: return &sample_cells<6>;
+    case 7: return &sample_cells<7>;
+    default: return nullptr;
+  }
+}
+
+}  // namespace aruco_opencv
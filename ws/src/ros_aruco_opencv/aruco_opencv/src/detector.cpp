@@ -21,7 +21,11 @@
 #include "aruco_opencv/detector.hpp"
 #include "aruco_opencv/parameters.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 #include <opencv2/calib3d.hpp>
+#include <opencv2/imgproc.hpp>
 
 namespace aruco_opencv
 {
@@ -41,6 +45,23 @@ void ArucoDetector::set_dictionary(const std::string & dictionary_name)
   #else
   dictionary_ = cv::aruco::getPredefinedDictionary(ARUCO_DICT_MAP.at(dictionary_name));
   #endif
+  mapped_dictionary_.reset();
+  cell_sampler_ = get_cell_sampler_kernel(dictionary_->markerSize);
+}
+
+bool ArucoDetector::set_dictionary_from_file(
+  const std::string & path,
+  std::string & error_message)
+{
+  auto mapped = MappedDictionary::open(path, error_message);
+  if (!mapped) {
+    return false;
+  }
+  // Keep the mapping alive for as long as the dictionary references it
+  mapped_dictionary_ = mapped;
+  dictionary_ = mapped->get_dictionary();
+  cell_sampler_ = get_cell_sampler_kernel(dictionary_->markerSize);
+  return true;
 }
 
 void ArucoDetector::set_detector_parameters(const DetectorParams & params)
@@ -70,6 +91,7 @@ void ArucoDetector::set_camera_intrinsics(
   std::lock_guard<std::mutex> lk(intrinsics_mutex_);
   camera_matrix.copyTo(camera_matrix_);
   dist_coeffs.copyTo(distortion_coeffs_);
+  intrinsics_known_ = true;
 }
 
 void ArucoDetector::update_camera_info(
@@ -88,6 +110,7 @@ void ArucoDetector::update_camera_info(
     }
     distortion_coeffs_ = cv::Mat(cam_info.d, true);
   }
+  intrinsics_known_ = true;
 }
 
 void ArucoDetector::get_intrinsics(cv::Mat & camera_matrix, cv::Mat & dist_coeffs) const
@@ -101,7 +124,27 @@ void ArucoDetector::set_boards(
   const std::vector<std::pair<std::string,
   cv::Ptr<cv::aruco::Board>>> & boards)
 {
+  std::lock_guard<std::mutex> lk(intrinsics_mutex_);
   boards_ = boards;
+
+  min_board_marker_side_ = 0.0;
+  max_board_marker_side_ = 0.0;
+  for (const auto & board_desc : boards) {
+    #if CV_VERSION_MAJOR > 4 || CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 7
+    const auto & obj_points = board_desc.second->getObjPoints();
+    #else
+    const auto & obj_points = board_desc.second->objPoints;
+    #endif
+    for (const auto & marker : obj_points) {
+      if (marker.size() < 2) {
+        continue;
+      }
+      const double side = cv::norm(marker[1] - marker[0]);
+      min_board_marker_side_ = min_board_marker_side_ > 0.0 ?
+        std::min(min_board_marker_side_, side) : side;
+      max_board_marker_side_ = std::max(max_board_marker_side_, side);
+    }
+  }
 }
 
 cv::Ptr<cv::aruco::Dictionary> ArucoDetector::get_dictionary()
@@ -110,12 +153,148 @@ cv::Ptr<cv::aruco::Dictionary> ArucoDetector::get_dictionary()
   return dictionary_;
 }
 
-void ArucoDetector::detect(
-  const cv::Mat & image,
-  std::vector<int> & marker_ids,
-  std::vector<std::vector<cv::Point2f>> & marker_corners) const
+bool ArucoDetector::restrict_candidate_size(
+  const cv::Size & image_size, cv::aruco::DetectorParameters & params) const
 {
-  cv::aruco::detectMarkers(image, dictionary_, marker_corners, marker_ids, aruco_parameters_);
+  std::lock_guard<std::mutex> lk(intrinsics_mutex_);
+  const double min_distance = params_.candidate_min_distance;
+  const double max_distance = params_.candidate_max_distance;
+  if (!intrinsics_known_ || (min_distance <= 0.0 && max_distance <= 0.0)) {
+    return false;
+  }
+  const double focal = camera_matrix_.at<double>(0, 0);
+  if (!(focal > 0.0)) {
+    return false;
+  }
+
+  double min_side = params_.marker_size;
+  double max_side = params_.marker_size;
+  if (min_board_marker_side_ > 0.0) {
+    min_side = std::min(min_side, min_board_marker_side_);
+    max_side = std::max(max_side, max_board_marker_side_);
+  }
+
+  // OpenCV compares contour perimeters with the rates times the largest image dimension
+  const double scale = 1.0 / std::max(image_size.width, image_size.height);
+  double min_rate = params.minMarkerPerimeterRate;
+  double max_rate = params.maxMarkerPerimeterRate;
+  if (max_distance > 0.0) {
+    // Seen at 60 degrees, two of the sides appear half as long
+    const double perimeter = 3.0 * focal * min_side / max_distance;
+    min_rate = std::max(min_rate, perimeter * scale);
+  }
+  if (min_distance > 0.0) {
+    // Margin for lens distortion and corner detection near the image border
+    const double perimeter = 5.0 * focal * max_side / min_distance;
+    max_rate = std::min(max_rate, perimeter * scale);
+  }
+  if (min_rate >= max_rate ||
+    (min_rate == params.minMarkerPerimeterRate && max_rate == params.maxMarkerPerimeterRate))
+  {
+    return false;
+  }
+  params.minMarkerPerimeterRate = min_rate;
+  params.maxMarkerPerimeterRate = max_rate;
+  return true;
+}
+
+void ArucoDetector::detect(const cv::Mat & image, FrameContext & ctx, bool filter_candidates) const
+{
+  if (!ctx.aruco_parameters) {
+    #if CV_VERSION_MAJOR > 4 || CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 7
+    ctx.aruco_parameters = cv::makePtr<cv::aruco::DetectorParameters>();
+    #else
+    ctx.aruco_parameters = cv::aruco::DetectorParameters::create();
+    #endif
+  }
+  *ctx.aruco_parameters = *aruco_parameters_;
+  const bool filtered = filter_candidates &&
+    restrict_candidate_size(image.size(), *ctx.aruco_parameters);
+
+  cv::aruco::detectMarkers(image, dictionary_, ctx.marker_corners, ctx.marker_ids,
+    ctx.aruco_parameters, ctx.rejected_corners);
+
+  auto & stats = ctx.candidate_stats;
+  const size_t decoded = ctx.marker_ids.size() + ctx.rejected_corners.size();
+  stats.decoded += decoded;
+  stats.rejected += ctx.rejected_corners.size();
+
+  int audit_period = 0;
+  bool recover_rejected = false;
+  {
+    std::lock_guard<std::mutex> lk(intrinsics_mutex_);
+    audit_period = params_.candidate_audit_period;
+    recover_rejected = params_.decode_rejected;
+  }
+  if (filtered && audit_period > 0 && stats.filtered_frames++ % audit_period == 0) {
+    // The same frame without the range shows what the range kept away from decoding
+    ctx.aruco_parameters->minMarkerPerimeterRate = aruco_parameters_->minMarkerPerimeterRate;
+    ctx.aruco_parameters->maxMarkerPerimeterRate = aruco_parameters_->maxMarkerPerimeterRate;
+    cv::aruco::detectMarkers(image, dictionary_, ctx.audit_corners, ctx.audit_ids,
+      ctx.aruco_parameters, ctx.audit_rejected_corners);
+
+    ++stats.audited_frames;
+    stats.audit_decoded_filtered += decoded;
+    stats.audit_decoded_unfiltered += ctx.audit_ids.size() + ctx.audit_rejected_corners.size();
+    if (ctx.audit_ids.size() > ctx.marker_ids.size()) {
+      stats.audit_markers_lost += ctx.audit_ids.size() - ctx.marker_ids.size();
+    }
+  }
+
+  if (recover_rejected && cell_sampler_) {
+    stats.recovered += decode_rejected(image, ctx);
+  }
+
+  ctx.corners.resize(ctx.marker_corners.size() * 4);
+  for (size_t i = 0; i < ctx.marker_corners.size(); ++i) {
+    std::copy_n(ctx.marker_corners[i].begin(), 4, ctx.corners.begin() + 4 * i);
+  }
+}
+
+size_t ArucoDetector::decode_rejected(const cv::Mat & image, FrameContext & ctx) const
+{
+  if (ctx.rejected_corners.empty()) {
+    return 0;
+  }
+  const cv::Mat * gray = &image;
+  if (image.channels() == 3) {
+    cv::cvtColor(image, ctx.gray, cv::COLOR_BGR2GRAY);
+    gray = &ctx.gray;
+  } else if (image.channels() == 4) {
+    cv::cvtColor(image, ctx.gray, cv::COLOR_BGRA2GRAY);
+    gray = &ctx.gray;
+  }
+  const GrayImageView view{gray->data, gray->cols, gray->rows, gray->step[0]};
+
+  CellSamplerConfig config;
+  config.min_stddev = ctx.aruco_parameters->minOtsuStdDev;
+  config.max_border_error_rate = ctx.aruco_parameters->maxErroneousBitsInBorderRate;
+  ctx.sampled_bits.create(dictionary_->markerSize, dictionary_->markerSize, CV_8UC1);
+
+  size_t recovered = 0;
+  size_t i = 0;
+  while (i < ctx.rejected_corners.size()) {
+    auto & candidate = ctx.rejected_corners[i];
+    int id = -1;
+    int rotation = 0;
+    if (candidate.size() != 4 ||
+      !cell_sampler_(view, &candidate[0].x, config, ctx.sampled_bits.data) ||
+      !dictionary_->identify(
+        ctx.sampled_bits, id, rotation, ctx.aruco_parameters->errorCorrectionRate) ||
+      std::find(ctx.marker_ids.begin(), ctx.marker_ids.end(), id) != ctx.marker_ids.end())
+    {
+      ++i;
+      continue;
+    }
+    std::rotate(candidate.begin(), candidate.begin() + 4 - rotation, candidate.end());
+    ctx.marker_ids.push_back(id);
+    ctx.marker_corners.push_back(candidate);
+    // The order of the rejected candidates carries no meaning
+    std::swap(candidate, ctx.rejected_corners.back());
+    ctx.rejected_corners.pop_back();
+    ++recovered;
+  }
+  return recovered;
 }
 
 ssize_t ArucoDetector::select_pose_from_candidates(
@@ -180,101 +359,111 @@ ssize_t ArucoDetector::select_pose_from_candidates(
   return best_index;
 }
 
-void ArucoDetector::estimate_marker_poses(
-  const std::vector<int> & marker_ids,
-  const std::vector<std::vector<cv::Point2f>> & marker_corners,
-  std::vector<aruco_opencv_msgs::msg::MarkerPose> & marker_poses,
-  std::vector<cv::Vec3d> & rvecs,
-  std::vector<cv::Vec3d> & tvecs) const
+void ArucoDetector::estimate_marker_poses(FrameContext & ctx) const
 {
-  const size_t n_markers = marker_ids.size();
+  const size_t n_markers = ctx.marker_ids.size();
+  auto & marker_poses = ctx.detection.markers;
   marker_poses.resize(n_markers);
-  rvecs.resize(n_markers);
-  tvecs.resize(n_markers);
+  ctx.rvecs.resize(n_markers);
+  ctx.tvecs.resize(n_markers);
+  ctx.valid.assign(n_markers, 0);
+  ctx.reproj_errors.assign(n_markers, -1.0f);
+  if (ctx.pnp_scratch.size() < n_markers) {
+    ctx.pnp_scratch.resize(n_markers);
+  }
 
-  cv::Mat camera_matrix, distortion_coeffs, marker_obj_points;
   PoseSelectorConfig selector_config;
+  int min_markers_parallel = 0;
   {
     std::lock_guard<std::mutex> lk(intrinsics_mutex_);
-    camera_matrix_.copyTo(camera_matrix);
-    distortion_coeffs_.copyTo(distortion_coeffs);
-    marker_obj_points_.copyTo(marker_obj_points);
+    camera_matrix_.copyTo(ctx.camera_matrix);
+    distortion_coeffs_.copyTo(ctx.distortion_coeffs);
+    marker_obj_points_.copyTo(ctx.marker_obj_points);
     selector_config = params_.pose_selector;
+    min_markers_parallel = params_.min_markers_parallel_pnp;
   }
 
-  std::vector<bool> valid(marker_ids.size(), false);
-  cv::parallel_for_(cv::Range(0, static_cast<int>(marker_ids.size())),
-    [&](const cv::Range & range) {
+  auto estimate = [&](const cv::Range & range) {
       for (int i = range.start; i < range.end; ++i) {
-        std::vector<cv::Vec3d> rvecs_tmp, tvecs_tmp;
-        std::vector<double> reproj_errors;
-        cv::solvePnPGeneric(marker_obj_points, marker_corners[i], camera_matrix, distortion_coeffs,
-          rvecs_tmp, tvecs_tmp, false, cv::SOLVEPNP_IPPE_SQUARE, cv::noArray(), cv::noArray(),
-          reproj_errors);
+        auto & scratch = ctx.pnp_scratch[i];
+        const cv::Mat corners(4, 1, CV_32FC2, &ctx.corners[4 * i]);
+        cv::solvePnPGeneric(ctx.marker_obj_points, corners, ctx.camera_matrix,
+          ctx.distortion_coeffs, scratch.rvecs, scratch.tvecs, false, cv::SOLVEPNP_IPPE_SQUARE,
+          cv::noArray(), cv::noArray(), scratch.reproj_errors);
 
         ssize_t pose_index = select_pose_from_candidates(
-          rvecs_tmp, tvecs_tmp, reproj_errors, selector_config);
+          scratch.rvecs, scratch.tvecs, scratch.reproj_errors, selector_config);
 
         if (pose_index == -1) {
           // Failed to select a valid pose; marker will be filtered out in compaction step below
         } else {
-          marker_poses[i].marker_id = marker_ids[i];
-          marker_poses[i].pose = convert_rvec_tvec(rvecs_tmp[pose_index], tvecs_tmp[pose_index]);
-          rvecs[i] = rvecs_tmp[pose_index];
-          tvecs[i] = tvecs_tmp[pose_index];
-          valid[i] = true;
+          marker_poses[i].marker_id = ctx.marker_ids[i];
+          marker_poses[i].pose = convert_rvec_tvec(
+            scratch.rvecs[pose_index], scratch.tvecs[pose_index]);
+          ctx.rvecs[i] = scratch.rvecs[pose_index];
+          ctx.tvecs[i] = scratch.tvecs[pose_index];
+          ctx.valid[i] = 1;
+          ctx.reproj_errors[i] = static_cast<float>(scratch.reproj_errors[pose_index]);
         }
       }
-  });
+    };
+
+  // Waking the thread pool costs more than solving a few markers in place
+  const cv::Range all_markers(0, static_cast<int>(n_markers));
+  if (all_markers.end >= min_markers_parallel) {
+    cv::parallel_for_(all_markers, estimate);
+  } else {
+    estimate(all_markers);
+  }
 
   // Compact outputs to filter invalid entries
   size_t write = 0;
-  for (size_t i = 0; i < marker_ids.size(); ++i) {
-    if (!valid[i]) {
+  for (size_t i = 0; i < n_markers; ++i) {
+    if (!ctx.valid[i]) {
       continue;
     }
     if (write != i) {
       marker_poses[write] = marker_poses[i];
-      rvecs[write] = rvecs[i];
-      tvecs[write] = tvecs[i];
+      ctx.rvecs[write] = ctx.rvecs[i];
+      ctx.tvecs[write] = ctx.tvecs[i];
     }
     ++write;
   }
   marker_poses.resize(write);
-  rvecs.resize(write);
-  tvecs.resize(write);
+  ctx.rvecs.resize(write);
+  ctx.tvecs.resize(write);
 }
 
-void ArucoDetector::estimate_board_poses(
-  const std::vector<int> & marker_ids,
-  const std::vector<std::vector<cv::Point2f>> & marker_corners,
-  std::vector<aruco_opencv_msgs::msg::BoardPose> & board_poses,
-  std::vector<cv::Vec3d> & rvecs,
-  std::vector<cv::Vec3d> & tvecs) const
+void ArucoDetector::estimate_board_poses(FrameContext & ctx) const
 {
-  cv::Mat camera_matrix, distortion_coeffs;
   {
     std::lock_guard<std::mutex> lk(intrinsics_mutex_);
-    camera_matrix_.copyTo(camera_matrix);
-    distortion_coeffs_.copyTo(distortion_coeffs);
+    camera_matrix_.copyTo(ctx.camera_matrix);
+    distortion_coeffs_.copyTo(ctx.distortion_coeffs);
   }
 
+  auto & board_poses = ctx.detection.boards;
+  size_t n_boards = 0;
   for (const auto & board_desc : boards_) {
-    const std::string name = board_desc.first;
+    const std::string & name = board_desc.first;
     auto & board = board_desc.second;
 
     cv::Vec3d rvec, tvec;
-    int valid = cv::aruco::estimatePoseBoard(marker_corners, marker_ids, board,
-                                             camera_matrix, distortion_coeffs, rvec, tvec);
+    int valid = cv::aruco::estimatePoseBoard(ctx.marker_corners, ctx.marker_ids, board,
+                                             ctx.camera_matrix, ctx.distortion_coeffs, rvec,
+                                             tvec);
     if (valid > 0) {
-      aruco_opencv_msgs::msg::BoardPose bpose;
+      if (board_poses.size() <= n_boards) {
+        board_poses.emplace_back();
+      }
+      auto & bpose = board_poses[n_boards++];
       bpose.board_name = name;
       bpose.pose = convert_rvec_tvec(rvec, tvec);
-      board_poses.push_back(bpose);
-      rvecs.push_back(rvec);
-      tvecs.push_back(tvec);
+      ctx.rvecs.push_back(rvec);
+      ctx.tvecs.push_back(tvec);
     }
   }
+  board_poses.resize(n_boards);
 }
 
 }  // namespace aruco_opencv
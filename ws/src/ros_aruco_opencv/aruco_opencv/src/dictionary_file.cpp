@@ -0,0 +1,153 @@
+// Copyright 2025 Fictionlab sp. z o.o.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "aruco_opencv/dictionary_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+namespace aruco_opencv
+{
+
+static const char DICTIONARY_FILE_MAGIC[8] = {'A', 'R', 'U', 'C', 'O', 'D', 'I', 'C'};
+static const uint32_t DICTIONARY_FILE_VERSION = 1;
+
+static bool validate_header(
+  const DictionaryFileHeader & header, size_t file_size,
+  std::string & err)
+{
+  if (std::memcmp(header.magic, DICTIONARY_FILE_MAGIC, sizeof(DICTIONARY_FILE_MAGIC)) != 0) {
+    err = "not a dictionary file (bad magic)";
+    return false;
+  }
+  if (header.version != DICTIONARY_FILE_VERSION) {
+    err = "unsupported dictionary file version " + std::to_string(header.version);
+    return false;
+  }
+  if (header.marker_size == 0 || header.marker_count == 0) {
+    err = "dictionary is empty";
+    return false;
+  }
+  const uint64_t expected_bytes = (header.marker_size * header.marker_size + 7) / 8;
+  if (header.bytes_per_rotation != expected_bytes) {
+    err = "bytes_per_rotation does not match marker_size";
+    return false;
+  }
+  if (header.table_offset % DICTIONARY_FILE_ALIGNMENT != 0) {
+    err = "codeword table is not aligned";
+    return false;
+  }
+  const uint64_t expected_table_size =
+    static_cast<uint64_t>(header.marker_count) * header.bytes_per_rotation * 4;
+  if (header.table_size != expected_table_size ||
+    header.table_offset + header.table_size > file_size)
+  {
+    err = "codeword table size does not match file size";
+    return false;
+  }
+  return true;
+}
+
+MappedDictionary::~MappedDictionary()
+{
+  if (data_ != nullptr) {
+    munmap(data_, size_);
+  }
+}
+
+std::shared_ptr<const MappedDictionary> MappedDictionary::open(
+  const std::string & path,
+  std::string & error_message)
+{
+  static std::mutex registry_mutex;
+  static std::map<std::string, std::weak_ptr<const MappedDictionary>> registry;
+
+  char resolved[PATH_MAX];
+  if (realpath(path.c_str(), resolved) == nullptr) {
+    error_message = "Failed to open dictionary file " + path + ": " + std::strerror(errno);
+    return nullptr;
+  }
+  const std::string key(resolved);
+
+  std::lock_guard<std::mutex> lk(registry_mutex);
+  if (auto existing = registry[key].lock()) {
+    return existing;
+  }
+
+  int fd = ::open(resolved, O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    error_message = "Failed to open dictionary file " + path + ": " + std::strerror(errno);
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(DictionaryFileHeader)) {
+    ::close(fd);
+    error_message = "Failed to load dictionary file " + path + ": file too small";
+    return nullptr;
+  }
+
+  void * data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (data == MAP_FAILED) {
+    error_message = "Failed to map dictionary file " + path + ": " + std::strerror(errno);
+    return nullptr;
+  }
+
+  std::shared_ptr<MappedDictionary> mapped(new MappedDictionary());
+  mapped->data_ = data;
+  mapped->size_ = st.st_size;
+  mapped->header_ = static_cast<const DictionaryFileHeader *>(data);
+
+  std::string err;
+  if (!validate_header(*mapped->header_, mapped->size_, err)) {
+    error_message = "Failed to load dictionary file " + path + ": " + err;
+    return nullptr;
+  }
+
+  madvise(data, st.st_size, MADV_WILLNEED);
+
+  registry[key] = mapped;
+  return mapped;
+}
+
+cv::Ptr<cv::aruco::Dictionary> MappedDictionary::get_dictionary() const
+{
+  // The table is never written to, OpenCV only takes a non-const pointer for the Mat header.
+  auto table = static_cast<uint8_t *>(data_) + header_->table_offset;
+  cv::Mat bytes_list(
+    static_cast<int>(header_->marker_count), static_cast<int>(header_->bytes_per_rotation),
+    CV_8UC4, table);
+
+  return cv::makePtr<cv::aruco::Dictionary>(
+    bytes_list, static_cast<int>(header_->marker_size),
+    static_cast<int>(header_->max_correction_bits));
+}
+
+}  // namespace aruco_opencv
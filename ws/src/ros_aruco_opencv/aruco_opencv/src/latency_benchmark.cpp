@@ -0,0 +1,460 @@
+// Copyright 2025 Fictionlab sp. z o.o.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Measures the per-frame latency of the detection pipeline (marker detection and pose
+// estimation) on a synthetic frame, for several threading policies, with and without CPU
+// contention from busy threads. Prints the mean, standard deviation and tail of the latency.
+// Each policy runs in a fresh process, so that OpenCV's pool workers of one policy do not
+// carry their affinity over to the next.
+//
+// With --decode, compares instead the decoding of perspective-distorted candidates by
+// OpenCV's path (homography, warp to the canonical image, Otsu threshold, cell counts) with
+// the cell sampler, per candidate, and the detection latency with and without the rejected
+// candidates read again by the sampler.
+//
+// Usage: aruco_latency_benchmark [--frames N] [--markers N] [--busy N] [--cpus LIST]
+//                                [--priority P] [--decode N]
+//   --busy     number of busy threads competing for the CPUs (default: one per CPU)
+//   --cpus     additionally run a policy pinned to these CPUs, e.g. "2-3"
+//   --priority SCHED_FIFO priority of the pinned policy (default: 0)
+//   --policy   run only the policy with this index, used for the child processes
+//   --decode   compare the decoding paths on N candidates
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/aruco.hpp>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "rclcpp/rclcpp.hpp"
+
+#include "aruco_opencv/cell_sampler.hpp"
+#include "aruco_opencv/detector.hpp"
+#include "aruco_opencv/frame_context.hpp"
+#include "aruco_opencv/threading.hpp"
+
+using aruco_opencv::ArucoDetector;
+using aruco_opencv::CellSamplerConfig;
+using aruco_opencv::GrayImageView;
+using aruco_opencv::FrameContext;
+using aruco_opencv::ThreadPolicy;
+
+namespace
+{
+
+struct Policy
+{
+  std::string name;
+  int num_threads;
+  int min_markers_parallel_pnp;
+  std::string cpus;
+  int priority;
+};
+
+struct Latency
+{
+  double mean, stddev, p50, p99, max;
+};
+
+// Competes for every CPU, whatever the affinity of the thread that started it
+class BusyThreads {
+public:
+  explicit BusyThreads(int count)
+  {
+    for (int i = 0; i < count; ++i) {
+      threads_.emplace_back([this]() {
+          cpu_set_t all;
+          CPU_ZERO(&all);
+          for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+            CPU_SET(cpu, &all);
+          }
+          pthread_setaffinity_np(pthread_self(), sizeof(all), &all);
+          volatile double x = 1.0;
+          while (!stop_.load(std::memory_order_relaxed)) {
+            x = std::sqrt(x + 1.0);
+          }
+        });
+    }
+  }
+
+  ~BusyThreads()
+  {
+    stop_ = true;
+    for (auto & t : threads_) {
+      t.join();
+    }
+  }
+
+private:
+  std::atomic<bool> stop_{false};
+  std::vector<std::thread> threads_;
+};
+
+cv::Mat make_frame(const cv::Ptr<cv::aruco::Dictionary> & dictionary, int markers)
+{
+  cv::Mat frame(480, 640, CV_8UC3, cv::Scalar::all(200));
+  const int side = 80;
+  const int per_row = 6;
+  for (int i = 0; i < markers; ++i) {
+    cv::Mat marker;
+    #if CV_VERSION_MAJOR > 4 || CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 7
+    cv::aruco::generateImageMarker(*dictionary, i, side, marker);
+    #else
+    cv::aruco::drawMarker(dictionary, i, side, marker);
+    #endif
+    cv::cvtColor(marker, marker, cv::COLOR_GRAY2BGR);
+    const int x = 20 + (i % per_row) * (side + 22);
+    const int y = 20 + (i / per_row) * (side + 22);
+    marker.copyTo(frame(cv::Rect(x, y, side, side)));
+  }
+  cv::Mat noise(frame.size(), frame.type());
+  cv::randn(noise, cv::Scalar::all(0), cv::Scalar::all(4));
+  frame += noise;
+  return frame;
+}
+
+Latency run(ArucoDetector & detector, const cv::Mat & frame, int frames)
+{
+  FrameContext ctx;
+  std::vector<double> samples;
+  samples.reserve(frames);
+  for (int i = 0; i < frames + 10; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    ctx.begin_frame();
+    detector.detect(frame, ctx);
+    detector.estimate_marker_poses(ctx);
+    ctx.end_frame();
+    double ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - start).count();
+    // The first frames still create the pool and grow the buffers
+    if (i >= 10) {
+      samples.push_back(ms);
+    }
+  }
+
+  Latency l{};
+  for (double s : samples) {
+    l.mean += s;
+  }
+  l.mean /= samples.size();
+  for (double s : samples) {
+    l.stddev += (s - l.mean) * (s - l.mean);
+  }
+  l.stddev = std::sqrt(l.stddev / samples.size());
+  std::sort(samples.begin(), samples.end());
+  l.p50 = samples[samples.size() / 2];
+  l.p99 = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+  l.max = samples.back();
+  return l;
+}
+
+std::vector<Policy> make_policies(const std::string & cpus, int priority)
+{
+  std::vector<Policy> policies = {
+    {"parallel PnP", -1, 1, "", 0},
+    {"serial PnP < 5", -1, 5, "", 0},
+    {"single thread", 0, 5, "", 0},
+  };
+  if (!cpus.empty()) {
+    policies.push_back({"pinned " + cpus, -1, 5, cpus, priority});
+  }
+  return policies;
+}
+
+// Runs every policy in a child process started from this executable
+int run_children(int argc, char ** argv, size_t count)
+{
+  int status = 0;
+  for (size_t i = 0; i < count; ++i) {
+    std::vector<std::string> args(argv, argv + argc);
+    args.push_back("--policy");
+    args.push_back(std::to_string(i));
+    std::vector<char *> child_argv;
+    for (auto & arg : args) {
+      child_argv.push_back(&arg[0]);
+    }
+    child_argv.push_back(nullptr);
+
+    std::fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+      std::perror("fork");
+      return 1;
+    }
+    if (pid == 0) {
+      execv("/proc/self/exe", child_argv.data());
+      std::perror("execv");
+      _exit(127);
+    }
+    int child_status = 0;
+    if (waitpid(pid, &child_status, 0) < 0 || !WIFEXITED(child_status) ||
+      WEXITSTATUS(child_status) != 0)
+    {
+      status = 1;
+    }
+  }
+  return status;
+}
+
+struct Candidate
+{
+  cv::Mat image;
+  std::vector<cv::Point2f> corners;
+  int id;
+};
+
+// A marker in a random perspective inside its own small image, corners starting at a random one
+std::vector<Candidate> make_candidates(const cv::aruco::Dictionary & dictionary, int count)
+{
+  cv::RNG rng(1);
+  const int size = 160;
+  const int side = 20 * (dictionary.markerSize + 2);
+  std::vector<Candidate> candidates(count);
+  for (int i = 0; i < count; ++i) {
+    auto & c = candidates[i];
+    c.id = i % dictionary.bytesList.rows;
+    cv::Mat marker;
+    #if CV_VERSION_MAJOR > 4 || CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 7
+    cv::aruco::generateImageMarker(dictionary, c.id, side, marker);
+    #else
+    cv::aruco::drawMarker(cv::makePtr<cv::aruco::Dictionary>(dictionary), c.id, side, marker);
+    #endif
+    const std::vector<cv::Point2f> square = {
+      {0.0f, 0.0f}, {1.0f * side, 0.0f}, {1.0f * side, 1.0f * side}, {0.0f, 1.0f * side}};
+    const std::vector<cv::Point2f> quad = {
+      {rng.uniform(10.0f, 50.0f), rng.uniform(10.0f, 50.0f)},
+      {rng.uniform(110.0f, 150.0f), rng.uniform(10.0f, 50.0f)},
+      {rng.uniform(110.0f, 150.0f), rng.uniform(110.0f, 150.0f)},
+      {rng.uniform(10.0f, 50.0f), rng.uniform(110.0f, 150.0f)}};
+    cv::warpPerspective(marker, c.image, cv::getPerspectiveTransform(square, quad),
+      cv::Size(size, size), cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar::all(255));
+    cv::Mat noise(c.image.size(), CV_16SC1);
+    cv::randn(noise, 0, 6);
+    c.image.convertTo(c.image, CV_16SC1);
+    c.image += noise;
+    c.image.convertTo(c.image, CV_8UC1);
+    const int first = rng.uniform(0, 4);
+    for (int k = 0; k < 4; ++k) {
+      c.corners.push_back(quad[(first + k) % 4]);
+    }
+  }
+  return candidates;
+}
+
+// OpenCV's decoding of a candidate, as in detectMarkers with the default parameters
+bool decode_by_warp(
+  const Candidate & c, const cv::aruco::DetectorParameters & params, cv::Mat & canonical,
+  cv::Mat & bits, int marker_size)
+{
+  const int grid = marker_size + 2;
+  const int cell = params.perspectiveRemovePixelPerCell;
+  const int side = grid * cell;
+  const std::vector<cv::Point2f> square = {
+    {0.0f, 0.0f}, {side - 1.0f, 0.0f}, {side - 1.0f, side - 1.0f}, {0.0f, side - 1.0f}};
+  cv::warpPerspective(c.image, canonical, cv::getPerspectiveTransform(c.corners, square),
+    cv::Size(side, side), cv::INTER_NEAREST);
+
+  cv::Scalar mean, stddev;
+  cv::meanStdDev(canonical, mean, stddev);
+  if (stddev[0] < params.minOtsuStdDev) {
+    return false;
+  }
+  cv::threshold(canonical, canonical, 125, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
+
+  const int margin = static_cast<int>(params.perspectiveRemoveIgnoredMarginPerCell * cell);
+  const int inner = cell - 2 * margin;
+  int border_errors = 0;
+  bits.create(marker_size, marker_size, CV_8UC1);
+  for (int r = 0; r < grid; ++r) {
+    for (int col = 0; col < grid; ++col) {
+      const cv::Rect area(col * cell + margin, r * cell + margin, inner, inner);
+      const bool white = cv::countNonZero(canonical(area)) > inner * inner / 2;
+      if (r == 0 || col == 0 || r == grid - 1 || col == grid - 1) {
+        border_errors += white;
+      } else {
+        bits.at<uint8_t>(r - 1, col - 1) = white;
+      }
+    }
+  }
+  return border_errors <=
+         static_cast<int>(marker_size * marker_size * params.maxErroneousBitsInBorderRate);
+}
+
+int run_decode_comparison(ArucoDetector & detector, int count, int frames, int markers)
+{
+  const cv::Ptr<cv::aruco::Dictionary> dictionary = detector.get_dictionary();
+  const int n = dictionary->markerSize;
+  #if CV_VERSION_MAJOR > 4 || CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 7
+  auto params = cv::makePtr<cv::aruco::DetectorParameters>();
+  #else
+  auto params = cv::aruco::DetectorParameters::create();
+  #endif
+  const auto kernel = aruco_opencv::get_cell_sampler_kernel(n);
+  if (!kernel) {
+    std::fprintf(stderr, "No cell sampler for %dx%d markers\n", n, n);
+    return 1;
+  }
+  CellSamplerConfig config;
+  config.min_stddev = params->minOtsuStdDev;
+  config.max_border_error_rate = params->maxErroneousBitsInBorderRate;
+
+  const std::vector<Candidate> candidates = make_candidates(*dictionary, count);
+  cv::Mat canonical, bits(n, n, CV_8UC1);
+  std::printf("%d candidate(s) of %dx%d markers\n", count, n, n);
+  std::printf("%-14s %12s %8s\n", "decoder", "us/candidate", "read");
+  for (int path = 0; path < 2; ++path) {
+    int read = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const auto & c : candidates) {
+      bool valid = false;
+      if (path == 0) {
+        valid = decode_by_warp(c, *params, canonical, bits, n);
+      } else {
+        const GrayImageView view{c.image.data, c.image.cols, c.image.rows, c.image.step[0]};
+        valid = kernel(view, &c.corners[0].x, config, bits.data);
+      }
+      int id = -1;
+      int rotation = 0;
+      read += valid && dictionary->identify(bits, id, rotation, params->errorCorrectionRate) &&
+        id == c.id;
+    }
+    const double us = std::chrono::duration<double, std::micro>(
+      std::chrono::steady_clock::now() - start).count() / count;
+    std::printf("%-14s %12.2f %5d/%d\n", path == 0 ? "warp (OpenCV)" : "cell sampler", us,
+      read, count);
+  }
+
+  // The whole pipeline, with the rejected candidates of each frame read again or not
+  const cv::Mat frame = make_frame(dictionary, markers);
+  aruco_opencv::DetectorParams detector_params;
+  detector_params.marker_size = 0.1;
+  for (bool recover : {false, true}) {
+    detector_params.decode_rejected = recover;
+    detector.set_detector_parameters(detector_params);
+    const Latency l = run(detector, frame, frames);
+    std::printf("%-22s %8.3f %8.3f %8.3f  (ms mean, p99, max)\n",
+      recover ? "detect + recovery" : "detect", l.mean, l.p99, l.max);
+  }
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  int frames = 300;
+  int markers = 3;
+  int busy = static_cast<int>(std::thread::hardware_concurrency());
+  std::string cpus;
+  int priority = 0;
+  int policy_index = -1;
+  int decode = 0;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string arg = argv[i];
+    if (arg == "--frames") {
+      frames = std::max(1, std::atoi(argv[i + 1]));
+    } else if (arg == "--markers") {
+      markers = std::clamp(std::atoi(argv[i + 1]), 0, 24);
+    } else if (arg == "--busy") {
+      busy = std::max(0, std::atoi(argv[i + 1]));
+    } else if (arg == "--cpus") {
+      cpus = argv[i + 1];
+    } else if (arg == "--priority") {
+      priority = std::atoi(argv[i + 1]);
+    } else if (arg == "--policy") {
+      policy_index = std::atoi(argv[i + 1]);
+    } else if (arg == "--decode") {
+      decode = std::max(0, std::atoi(argv[i + 1]));
+    } else {
+      std::fprintf(stderr, "Unknown argument %s\n", arg.c_str());
+      return 1;
+    }
+  }
+
+  const std::vector<Policy> policies = make_policies(cpus, priority);
+  if (policy_index < 0 && decode == 0) {
+    // Nothing of OpenCV is touched here, its thread pool must not exist before the fork
+    std::printf("%d marker(s), %d frames, %d busy thread(s)\n", markers, frames, busy);
+    std::printf("%-22s %-7s %-6s %8s %8s %8s %8s %8s  (ms)\n",
+      "policy", "threads", "busy", "mean", "stddev", "p50", "p99", "max");
+    return run_children(argc, argv, policies.size());
+  }
+  if (decode == 0 && policy_index >= static_cast<int>(policies.size())) {
+    std::fprintf(stderr, "No policy %d\n", policy_index);
+    return 1;
+  }
+
+  ArucoDetector detector(rclcpp::get_logger("aruco_latency_benchmark"));
+  detector.set_dictionary("4X4_50");
+  #if CV_VERSION_MAJOR > 4 || CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 7
+  detector.set_aruco_parameters(cv::makePtr<cv::aruco::DetectorParameters>());
+  #else
+  detector.set_aruco_parameters(cv::aruco::DetectorParameters::create());
+  #endif
+  cv::Mat camera_matrix = (cv::Mat_<double>(3, 3) << 500, 0, 320, 0, 500, 240, 0, 0, 1);
+  detector.set_camera_intrinsics(camera_matrix, cv::Mat::zeros(4, 1, CV_64F));
+  if (decode > 0) {
+    return run_decode_comparison(detector, decode, frames, markers);
+  }
+  const Policy & policy = policies[policy_index];
+
+  // Applied before the frame is drawn, so that the pool's workers inherit the policy
+  ThreadPolicy thread_policy;
+  std::string err;
+  if (!thread_policy.configure(policy.num_threads, policy.cpus, policy.priority, err)) {
+    std::fprintf(stderr, "%s: %s\n", policy.name.c_str(), err.c_str());
+    return 1;
+  }
+  if (!thread_policy.apply_to_current_thread(err) && !err.empty()) {
+    std::fprintf(stderr, "%s: %s\n", policy.name.c_str(), err.c_str());
+  }
+  aruco_opencv::DetectorParams params;
+  params.marker_size = 0.1;
+  params.min_markers_parallel_pnp = policy.min_markers_parallel_pnp;
+  detector.set_detector_parameters(params);
+  const cv::Mat frame = make_frame(detector.get_dictionary(), markers);
+
+  for (int competing : {0, busy}) {
+    Latency l;
+    {
+      BusyThreads contention(competing);
+      l = run(detector, frame, frames);
+    }
+    std::printf("%-22s %-7d %-6d %8.3f %8.3f %8.3f %8.3f %8.3f\n", policy.name.c_str(),
+      cv::getNumThreads(), competing, l.mean, l.stddev, l.p50, l.p99, l.max);
+    if (busy == 0) {
+      break;
+    }
+  }
+  return 0;
+}
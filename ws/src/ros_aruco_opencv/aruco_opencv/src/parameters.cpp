@@ -101,6 +101,7 @@ void declare_core_parameters(rclcpp_lifecycle::LifecycleNode & node)
   declare_param(node, "image_is_rectified", false, false);
   declare_param(node, "output_frame", std::string(""));
   declare_param(node, "marker_dict", std::string("4X4_50"));
+  declare_param(node, "marker_dict_path", std::string(""));
   declare_param(node, "image_sub_compressed", false);
   declare_param(node, "image_sub_qos.reliability",
       static_cast<int>(RMW_QOS_POLICY_RELIABILITY_BEST_EFFORT));
@@ -108,7 +109,20 @@ void declare_core_parameters(rclcpp_lifecycle::LifecycleNode & node)
       static_cast<int>(RMW_QOS_POLICY_DURABILITY_VOLATILE));
   declare_param(node, "image_sub_qos.depth", 1);
   declare_param(node, "publish_tf", true, true);
+  declare_param(node, "publish_bounded_detections", false);
+  declare_param(node, "publish_image_detections", false);
   declare_param(node, "board_descriptions_path", std::string(""));
+  declare_param(node, "camera_info_path", std::string(""));
+  declare_param(node, "warmup", true);
+  declare_param(node, "blur_gate.enable", false);
+  declare_param_int_range(node, "blur_gate.width", 160, 32, 1920);
+  declare_param_double_range(node, "blur_gate.min_ratio", 0.5, 0.0, 1.0);
+  declare_param_double_range(node, "blur_gate.reference_half_life", 2.0, 0.0, 60.0);
+  declare_param_double_range(node, "blur_gate.angular_velocity_gain", 0.5, 0.0, 10.0);
+  declare_param(node, "blur_gate.odom_topic", std::string(""));
+  declare_param_int_range(node, "threading.num_threads", -1, -1, 256);
+  declare_param(node, "threading.cpu_affinity", std::string(""));
+  declare_param_int_range(node, "threading.realtime_priority", 0, 0, 99);
 }
 
 void declare_aruco_parameters(rclcpp_lifecycle::LifecycleNode & node)
@@ -185,6 +199,11 @@ void declare_detector_parameters(rclcpp_lifecycle::LifecycleNode & node)
   declare_param(node, "marker_size", 0.15, true);
   declare_param(node, "pose_selector.strategy", std::string("REPROJECTION_ERROR"), true);
   declare_param(node, "pose_selector.debug", false, true);
+  declare_param(node, "threading.min_markers_parallel_pnp", 5, true);
+  declare_param(node, "candidate_filter.min_distance", 0.0, true);
+  declare_param(node, "candidate_filter.max_distance", 0.0, true);
+  declare_param(node, "candidate_filter.audit_period", 0, true);
+  declare_param(node, "decoding.recover_rejected", false, true);
 }
 
 CoreParams retrieve_core_parameters(rclcpp_lifecycle::LifecycleNode & node)
@@ -194,12 +213,26 @@ CoreParams retrieve_core_parameters(rclcpp_lifecycle::LifecycleNode & node)
   node.get_parameter("image_is_rectified", out.image_is_rectified);
   node.get_parameter("output_frame", out.output_frame);
   get_param(node, "marker_dict", out.marker_dict, "Marker Dictionary name: ");
+  node.get_parameter("marker_dict_path", out.marker_dict_path);
   node.get_parameter("image_sub_compressed", out.image_sub_compressed);
   node.get_parameter("image_sub_qos.reliability", out.qos_rel);
   node.get_parameter("image_sub_qos.durability", out.qos_dur);
   node.get_parameter("image_sub_qos.depth", out.qos_depth);
   node.get_parameter("publish_tf", out.publish_tf);
+  node.get_parameter("publish_bounded_detections", out.publish_bounded_detections);
+  node.get_parameter("publish_image_detections", out.publish_image_detections);
   node.get_parameter("board_descriptions_path", out.board_descriptions_path);
+  node.get_parameter("camera_info_path", out.camera_info_path);
+  node.get_parameter("warmup", out.warmup);
+  node.get_parameter("blur_gate.enable", out.blur_gate);
+  node.get_parameter("blur_gate.width", out.blur_gate_width);
+  node.get_parameter("blur_gate.min_ratio", out.blur_gate_min_ratio);
+  node.get_parameter("blur_gate.reference_half_life", out.blur_gate_reference_half_life);
+  node.get_parameter("blur_gate.angular_velocity_gain", out.blur_gate_angular_velocity_gain);
+  node.get_parameter("blur_gate.odom_topic", out.blur_gate_odom_topic);
+  node.get_parameter("threading.num_threads", out.num_threads);
+  node.get_parameter("threading.cpu_affinity", out.cpu_affinity);
+  node.get_parameter("threading.realtime_priority", out.realtime_priority);
   return out;
 }
 
@@ -362,6 +395,11 @@ DetectorParams retrieve_detector_parameters(rclcpp_lifecycle::LifecycleNode & no
   node.get_parameter("marker_size", out.marker_size);
   node.get_parameter("pose_selector.strategy", strategy_name);
   node.get_parameter("pose_selector.debug", out.pose_selector.debug);
+  node.get_parameter("threading.min_markers_parallel_pnp", out.min_markers_parallel_pnp);
+  node.get_parameter("candidate_filter.min_distance", out.candidate_min_distance);
+  node.get_parameter("candidate_filter.max_distance", out.candidate_max_distance);
+  node.get_parameter("candidate_filter.audit_period", out.candidate_audit_period);
+  node.get_parameter("decoding.recover_rejected", out.decode_rejected);
   out.pose_selector.strategy = parse_selector_strategy(strategy_name);
   return out;
 }
@@ -393,6 +431,22 @@ rcl_interfaces::msg::SetParametersResult validate_detector_parameters(
       result.reason = "marker_size must be positive";
       return result;
     }
+    if (param.get_name() == "threading.min_markers_parallel_pnp" && param.as_int() < 1) {
+      result.successful = false;
+      result.reason = "threading.min_markers_parallel_pnp must be >= 1";
+      return result;
+    }
+    if (param.get_name() == "candidate_filter.audit_period") {
+      if (param.as_int() < 0) {
+        result.successful = false;
+        result.reason = "candidate_filter.audit_period must not be negative";
+        return result;
+      }
+    } else if (param.get_name().rfind("candidate_filter.", 0) == 0 && param.as_double() < 0.0) {
+      result.successful = false;
+      result.reason = param.get_name() + " must not be negative";
+      return result;
+    }
     if (param.get_name() == "pose_selector.strategy") {
       std::string strategy = param.as_string();
       if (strategy != "REPROJECTION_ERROR" && strategy != "PLANE_NORMAL_PARALLEL") {
@@ -420,6 +474,16 @@ void update_dynamic_parameters(
       detector_params.pose_selector.strategy = parse_selector_strategy(param.as_string());
     } else if (param.get_name() == "pose_selector.debug") {
       detector_params.pose_selector.debug = param.as_bool();
+    } else if (param.get_name() == "threading.min_markers_parallel_pnp") {
+      detector_params.min_markers_parallel_pnp = static_cast<int>(param.as_int());
+    } else if (param.get_name() == "candidate_filter.min_distance") {
+      detector_params.candidate_min_distance = param.as_double();
+    } else if (param.get_name() == "candidate_filter.max_distance") {
+      detector_params.candidate_max_distance = param.as_double();
+    } else if (param.get_name() == "candidate_filter.audit_period") {
+      detector_params.candidate_audit_period = static_cast<int>(param.as_int());
+    } else if (param.get_name() == "decoding.recover_rejected") {
+      detector_params.decode_rejected = param.as_bool();
     } else if (param.get_name().rfind("aruco", 0) == 0) {
       aruco_param_changed = true;
     } else {
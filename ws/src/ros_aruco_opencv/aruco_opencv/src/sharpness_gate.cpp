@@ -0,0 +1,124 @@
+// Copyright 2025 Fictionlab sp. z o.o.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "aruco_opencv/sharpness_gate.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <opencv2/imgproc.hpp>
+
+namespace aruco_opencv
+{
+
+/// Downsampling between the fine and the coarse scale of the sharpness measure
+static const int COARSE_SCALE = 4;
+/// Coarse gradient energy below which an axis is considered to have no structure
+static const double MIN_COARSE_ENERGY = 1e-6;
+
+SharpnessGate::SharpnessGate(const SharpnessGateConfig & config)
+: config_(config)
+{
+}
+
+void SharpnessGate::reset()
+{
+  stats_ = SharpnessGateStats();
+  reference_ = 0.0;
+  reference_stamp_ = 0.0;
+  last_sharpness_ = 0.0;
+  last_threshold_ = 0.0;
+}
+
+bool SharpnessGate::accept(const cv::Mat & image, double stamp, double angular_velocity)
+{
+  ++stats_.frames;
+
+  // Other depths are rare enough not to be worth a conversion, let them through
+  if (image.empty() || image.depth() != CV_8U) {
+    return true;
+  }
+
+  last_sharpness_ = measure(image);
+
+  // The reference holds the sharpest recent frame, halving every reference_half_life
+  if (reference_ > 0.0 && config_.reference_half_life > 0.0) {
+    double dt = std::max(0.0, stamp - reference_stamp_);
+    reference_ *= std::exp2(-dt / config_.reference_half_life);
+  }
+  reference_stamp_ = stamp;
+  // Frames without structure say nothing about the camera, they would only inflate it
+  if (last_sharpness_ < 1.0) {
+    reference_ = std::max(reference_, last_sharpness_);
+  }
+
+  double ratio = config_.min_ratio *
+    (1.0 + config_.angular_velocity_gain * std::abs(angular_velocity));
+  last_threshold_ = std::min(ratio, 0.95) * reference_;
+
+  if (last_sharpness_ < last_threshold_) {
+    ++stats_.skipped;
+    return false;
+  }
+  return true;
+}
+
+double SharpnessGate::measure(const cv::Mat & image)
+{
+  // Downsample first, so the colour conversion and the filter only touch a few pixels
+  const cv::Mat * src = &image;
+  if (config_.width > 0 && image.cols > config_.width) {
+    int height = std::max(1, image.rows * config_.width / image.cols);
+    cv::resize(image, small_, cv::Size(config_.width, height), 0, 0, cv::INTER_AREA);
+    src = &small_;
+  }
+
+  if (src->channels() == 3) {
+    cv::cvtColor(*src, gray_, cv::COLOR_BGR2GRAY);
+    src = &gray_;
+  } else if (src->channels() == 4) {
+    cv::cvtColor(*src, gray_, cv::COLOR_BGRA2GRAY);
+    src = &gray_;
+  }
+
+  const cv::Size coarse_size(
+    std::max(1, src->cols / COARSE_SCALE), std::max(1, src->rows / COARSE_SCALE));
+  cv::resize(*src, coarse_, coarse_size, 0, 0, cv::INTER_AREA);
+
+  // Motion blur along one axis shows up in that axis only, so the lower ratio counts
+  double sharpness = 1.0;
+  for (int axis = 0; axis < 2; ++axis) {
+    const int dx = axis == 0 ? 1 : 0;
+    const int dy = 1 - dx;
+    const double coarse = gradient_energy(coarse_, dx, dy, gradient_);
+    if (coarse > MIN_COARSE_ENERGY) {
+      sharpness = std::min(sharpness, gradient_energy(*src, dx, dy, gradient_) / coarse);
+    }
+  }
+  return std::min(sharpness, 1.0);
+}
+
+double SharpnessGate::gradient_energy(const cv::Mat & image, int dx, int dy, cv::Mat & gradient)
+{
+  cv::Sobel(image, gradient, CV_32F, dx, dy);
+  return cv::norm(gradient, cv::NORM_L2SQR) / static_cast<double>(gradient.total());
+}
+
+}  // namespace aruco_opencv
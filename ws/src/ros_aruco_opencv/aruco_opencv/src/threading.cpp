@@ -0,0 +1,141 @@
+// Copyright 2025 Fictionlab sp. z o.o.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+// THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "aruco_opencv/threading.hpp"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+
+#include <opencv2/core.hpp>
+
+namespace aruco_opencv
+{
+
+static bool parse_cpu(const std::string & str, int & cpu)
+{
+  if (str.empty() || str.find_first_not_of("0123456789") != std::string::npos ||
+    str.size() > 6)
+  {
+    return false;
+  }
+  cpu = std::stoi(str);
+  return true;
+}
+
+bool ThreadPolicy::parse_cpu_list(
+  const std::string & spec, std::vector<int> & cpus, std::string & error_message)
+{
+  cpus.clear();
+  std::stringstream ss(spec);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    if (item.empty()) {
+      continue;
+    }
+    const size_t dash = item.find('-');
+    const std::string first_str = item.substr(0, dash);
+    const std::string last_str = dash == std::string::npos ? first_str : item.substr(dash + 1);
+    int first = 0, last = 0;
+    if (!parse_cpu(first_str, first) || !parse_cpu(last_str, last)) {
+      error_message = "Invalid CPU list entry '" + item + "' in '" + spec + "'";
+      return false;
+    }
+    if (last < first || last >= CPU_SETSIZE) {
+      error_message = "Invalid CPU range '" + item + "' in '" + spec + "'";
+      return false;
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  return true;
+}
+
+bool ThreadPolicy::configure(
+  int num_threads, const std::string & cpu_affinity, int realtime_priority,
+  std::string & error_message)
+{
+  std::vector<int> cpus;
+  if (!parse_cpu_list(cpu_affinity, cpus, error_message)) {
+    return false;
+  }
+  if (realtime_priority < 0 || realtime_priority > 99) {
+    error_message = "Real-time priority must be between 0 and 99";
+    return false;
+  }
+
+  cpus_ = std::move(cpus);
+  realtime_priority_ = realtime_priority;
+  {
+    std::lock_guard<std::mutex> lock(applied_mutex_);
+    applied_threads_.clear();
+  }
+
+  if (num_threads >= 0) {
+    cv::setNumThreads(num_threads);
+  }
+  return true;
+}
+
+bool ThreadPolicy::apply_to_current_thread(std::string & error_message)
+{
+  if (!pins_threads()) {
+    return false;
+  }
+  {
+    // Not retried on failure, the same error would be reported for every frame
+    std::lock_guard<std::mutex> lock(applied_mutex_);
+    if (!applied_threads_.insert(std::this_thread::get_id()).second) {
+      return false;
+    }
+  }
+
+  if (!cpus_.empty()) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus_) {
+      CPU_SET(cpu, &set);
+    }
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) {
+      error_message = std::string("Failed to set CPU affinity: ") + std::strerror(err);
+      return false;
+    }
+  }
+
+  if (realtime_priority_ > 0) {
+    sched_param param{};
+    param.sched_priority = realtime_priority_;
+    int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (err != 0) {
+      error_message = std::string("Failed to set SCHED_FIFO priority ") +
+        std::to_string(realtime_priority_) + ": " + std::strerror(err) +
+        " (needs CAP_SYS_NICE or an rtprio limit)";
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace aruco_opencv
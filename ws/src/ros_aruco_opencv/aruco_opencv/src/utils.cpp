@@ -18,6 +18,9 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>
+#include <array>
+
 #include "tf2/convert.hpp"
 #include "tf2_geometry_msgs/tf2_geometry_msgs.hpp"
 
@@ -48,6 +51,43 @@ geometry_msgs::msg::Pose convert_rvec_tvec(const cv::Vec3d & rvec, const cv::Vec
   return pose_out;
 }
 
+template<size_t N>
+static bool copy_bounded_string(const std::string & in, std::array<uint8_t, N> & out)
+{
+  const size_t len = std::min(in.size(), N - 1);
+  std::copy_n(in.begin(), len, out.begin());
+  std::fill(out.begin() + len, out.end(), 0);
+  return len == in.size();
+}
+
+bool fill_bounded_detection(
+  const aruco_opencv_msgs::msg::ArucoDetection & detection,
+  aruco_opencv_msgs::msg::BoundedArucoDetection & bounded)
+{
+  using BoundedDetection = aruco_opencv_msgs::msg::BoundedArucoDetection;
+
+  bool complete = true;
+  bounded.stamp = detection.header.stamp;
+  complete &= copy_bounded_string(detection.header.frame_id, bounded.frame_id);
+
+  const size_t n_markers =
+    std::min<size_t>(detection.markers.size(), BoundedDetection::MAX_MARKERS);
+  std::copy_n(detection.markers.begin(), n_markers, bounded.markers.begin());
+  bounded.num_markers = n_markers;
+  complete &= n_markers == detection.markers.size();
+
+  const size_t n_boards =
+    std::min<size_t>(detection.boards.size(), BoundedDetection::MAX_BOARDS);
+  for (size_t i = 0; i < n_boards; ++i) {
+    complete &= copy_bounded_string(detection.boards[i].board_name, bounded.boards[i].board_name);
+    bounded.boards[i].pose = detection.boards[i].pose;
+  }
+  bounded.num_boards = n_boards;
+  complete &= n_boards == detection.boards.size();
+
+  return complete;
+}
+
 const std::unordered_map<std::string, ArucoDictType> ARUCO_DICT_MAP = {
   {"4X4_50", ArucoDictType::DICT_4X4_50},
   {"4X4_100", ArucoDictType::DICT_4X4_100},